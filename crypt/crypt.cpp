@@ -6,10 +6,18 @@
  */
 
 #include "crypt.h"
-#include <random>
+#include "drbg.h"
+#include "executor.h"
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <sstream>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SEED_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
 
 // ============================================================================
 // Константы алгоритма SEED
@@ -171,6 +179,116 @@ static constexpr unsigned int KC[16] = {
     0x779b99e3, 0xef3733c6, 0xde6e678d, 0xbcdccf1b
 };
 
+// ============================================================================
+// Многоблочное ядро
+// ============================================================================
+
+namespace {
+    /// Блоков в одном проходе ядра AVX2 (по блоку на 32-битную дорожку)
+    constexpr size_t AVX2_LANES = 8;
+
+    /// Выбранное ядро; AVX2 выбирается, только если процессор его поддерживает
+    std::atomic<BlockKernel> activeKernel{BlockKernel::Scalar};
+
+    bool cpuHasAVX2() {
+#ifdef SEED_HAVE_AVX2_KERNEL
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /// Определение ядра при запуске программы
+    const bool kernelDetected = [] {
+        activeKernel.store(cpuHasAVX2() ? BlockKernel::AVX2 : BlockKernel::Scalar);
+        return true;
+    }();
+
+#ifdef SEED_HAVE_AVX2_KERNEL
+    /**
+     * @brief Функция G для восьми слов сразу: четыре выборки из S-Box через gather
+     */
+    __attribute__((target("avx2"))) inline __m256i gather8(const __m256i x) {
+        const __m256i mask = _mm256_set1_epi32(0xFF);
+        const auto* ss0 = reinterpret_cast<const int*>(SS0);
+        const auto* ss1 = reinterpret_cast<const int*>(SS1);
+        const auto* ss2 = reinterpret_cast<const int*>(SS2);
+        const auto* ss3 = reinterpret_cast<const int*>(SS3);
+        const __m256i g0 = _mm256_i32gather_epi32(ss0, _mm256_srli_epi32(x, 24), 4);
+        const __m256i g1 = _mm256_i32gather_epi32(ss1, _mm256_and_si256(_mm256_srli_epi32(x, 16), mask), 4);
+        const __m256i g2 = _mm256_i32gather_epi32(ss2, _mm256_and_si256(_mm256_srli_epi32(x, 8), mask), 4);
+        const __m256i g3 = _mm256_i32gather_epi32(ss3, _mm256_and_si256(x, mask), 4);
+        return _mm256_xor_si256(_mm256_xor_si256(g0, g1), _mm256_xor_si256(g2, g3));
+    }
+
+    /**
+     * @brief Шифрует или расшифровывает восемь блоков (128 байт) на месте
+     *
+     * Дорожка i регистра хранит слово блока i: слова собираются из блоков
+     * gather-загрузкой и переводятся из big-endian перестановкой байт, раунды
+     * повторяют SeedCryptor::encryptBlock/decryptBlock, результат
+     * транспонируется обратно в блоки.
+     */
+    __attribute__((target("avx2"))) void transform8(unsigned char* blocks, const unsigned* roundKeys,
+                                                    const bool decrypt) {
+        const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m256i offsets = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+        const auto* base = reinterpret_cast<const int*>(blocks);
+        __m256i L0 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(base + 0, offsets, 1), swap);
+        __m256i L1 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(base + 1, offsets, 1), swap);
+        __m256i R0 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(base + 2, offsets, 1), swap);
+        __m256i R1 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(base + 3, offsets, 1), swap);
+
+        for (int round = 0; round < 16; ++round) {
+            const int i = decrypt ? 15 - round : round;
+            __m256i T0 = _mm256_xor_si256(R0, _mm256_set1_epi32(static_cast<int>(roundKeys[2 * i])));
+            __m256i T1 = _mm256_xor_si256(R1, _mm256_set1_epi32(static_cast<int>(roundKeys[2 * i + 1])));
+            T1 = gather8(_mm256_xor_si256(T1, T0));
+            T0 = gather8(_mm256_add_epi32(T0, T1));
+            T1 = gather8(_mm256_add_epi32(T1, T0));
+            const __m256i f = _mm256_add_epi32(T0, T1);
+
+            const __m256i nextR0 = _mm256_xor_si256(L0, f);
+            const __m256i nextR1 = _mm256_xor_si256(L1, f);
+            L0 = R0;
+            L1 = R1;
+            R0 = nextR0;
+            R1 = nextR1;
+        }
+
+        // Финальная перестановка: блок = R0, R1, L0, L1; транспонирование 4x8 слов
+        const __m256i w0 = _mm256_shuffle_epi8(R0, swap);
+        const __m256i w1 = _mm256_shuffle_epi8(R1, swap);
+        const __m256i w2 = _mm256_shuffle_epi8(L0, swap);
+        const __m256i w3 = _mm256_shuffle_epi8(L1, swap);
+        const __m256i t0 = _mm256_unpacklo_epi32(w0, w1);
+        const __m256i t1 = _mm256_unpackhi_epi32(w0, w1);
+        const __m256i t2 = _mm256_unpacklo_epi32(w2, w3);
+        const __m256i t3 = _mm256_unpackhi_epi32(w2, w3);
+        const __m256i b04 = _mm256_unpacklo_epi64(t0, t2);
+        const __m256i b15 = _mm256_unpackhi_epi64(t0, t2);
+        const __m256i b26 = _mm256_unpacklo_epi64(t1, t3);
+        const __m256i b37 = _mm256_unpackhi_epi64(t1, t3);
+        auto* out = reinterpret_cast<__m256i*>(blocks);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(b04, b15, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(b26, b37, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(b04, b15, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(b26, b37, 0x31));
+    }
+#endif
+}
+
+BlockKernel SeedCryptor::blockKernel() {
+    return activeKernel.load(std::memory_order_relaxed);
+}
+
+BlockKernel SeedCryptor::setBlockKernel(const BlockKernel kernel) {
+    activeKernel.store(kernel == BlockKernel::AVX2 && !cpuHasAVX2() ? BlockKernel::Scalar : kernel);
+    return blockKernel();
+}
+
 // ============================================================================
 // SeedKey реализация
 // ============================================================================
@@ -187,14 +305,7 @@ SeedKey::SeedKey(const std::string& filePath) : _keyData{} {
 
 SeedKey SeedKey::generateRandom() {
     SeedKey key;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<unsigned short> dist(0, 255);
-
-    for (size_t i = 0; i < KEY_SIZE; ++i) {
-        key._keyData[i] = static_cast<unsigned char>(dist(gen));
-    }
-
+    Drbg::fill(key._keyData.data(), KEY_SIZE);
     return key;
 }
 
@@ -247,12 +358,18 @@ bool SeedKey::operator!=(const SeedKey& other) const {
 // SeedCryptor реализация
 // ============================================================================
 
-SeedCryptor::SeedCryptor(const SeedKey& key) : _key(key), _roundKeys{} {
+SeedCryptor::SeedCryptor(const SeedKey& key, const std::uint16_t keyId) : _key(key), _roundKeys{}, _keyId(keyId) {
     generateRoundKeys();
+    deriveMacCryptor();
 }
 
 SeedCryptor::SeedCryptor(const std::string& keyFilePath) : _key(keyFilePath), _roundKeys{} {
     generateRoundKeys();
+    deriveMacCryptor();
+}
+
+SeedCryptor::SeedCryptor(const SeedKey& key, MacKeyTag) : _key(key), _roundKeys{} {
+    generateRoundKeys();
 }
 
 const SeedKey& SeedCryptor::getKey() const {
@@ -262,6 +379,7 @@ const SeedKey& SeedCryptor::getKey() const {
 void SeedCryptor::setKey(const SeedKey& key) {
     _key = key;
     generateRoundKeys();
+    deriveMacCryptor();
 }
 
 unsigned int SeedCryptor::G(unsigned int x) {
@@ -323,7 +441,7 @@ void SeedCryptor::generateRoundKeys() {
     }
 }
 
-void SeedCryptor::encryptBlock(std::array<unsigned char, BLOCK_SIZE>& block) {
+void SeedCryptor::encryptBlock(unsigned char* block) const {
     // Преобразуем блок в 4 32-битных слова (big-endian)
     unsigned int L0 = (static_cast<unsigned int>(block[0]) << 24) |
                   (static_cast<unsigned int>(block[1]) << 16) |
@@ -375,7 +493,7 @@ void SeedCryptor::encryptBlock(std::array<unsigned char, BLOCK_SIZE>& block) {
     block[15] = L1 & 0xFF;
 }
 
-void SeedCryptor::decryptBlock(std::array<unsigned char, BLOCK_SIZE>& block) {
+void SeedCryptor::decryptBlock(unsigned char* block) const {
     // Преобразуем блок в 4 32-битных слова (big-endian)
     unsigned int L0 = (static_cast<unsigned int>(block[0]) << 24) |
                   (static_cast<unsigned int>(block[1]) << 16) |
@@ -426,138 +544,1054 @@ void SeedCryptor::decryptBlock(std::array<unsigned char, BLOCK_SIZE>& block) {
     block[15] = L1 & 0xFF;
 }
 
-void SeedCryptor::addPadding(std::vector<unsigned char>& data) {
-    // PKCS7 паддинг
-    size_t paddingSize = BLOCK_SIZE - (data.size() % BLOCK_SIZE);
-    if (paddingSize == 0) {
-        paddingSize = BLOCK_SIZE;
-    }
-
-    for (size_t i = 0; i < paddingSize; ++i) {
-        data.push_back(static_cast<unsigned char>(paddingSize));
-    }
-}
-
-void SeedCryptor::removePadding(std::vector<unsigned char>& data) {
-    if (data.empty()) {
+size_t SeedCryptor::unpaddedSize(const unsigned char* data, const size_t size) {
+    if (size == 0) {
         throw std::runtime_error("Данные пусты, невозможно удалить паддинг");
     }
 
-    unsigned char paddingSize = data.back();
+    const unsigned char paddingSize = data[size - 1];
 
-    if (paddingSize == 0 || paddingSize > BLOCK_SIZE || paddingSize > data.size()) {
+    if (paddingSize == 0 || paddingSize > BLOCK_SIZE || paddingSize > size) {
         throw std::runtime_error("Неверный паддинг PKCS7");
     }
 
     // Проверяем корректность паддинга
-    for (size_t i = data.size() - paddingSize; i < data.size(); ++i) {
+    for (size_t i = size - paddingSize; i < size; ++i) {
         if (data[i] != paddingSize) {
             throw std::runtime_error("Неверный паддинг PKCS7");
         }
     }
 
-    data.resize(data.size() - paddingSize);
+    return size - paddingSize;
 }
 
 std::array<unsigned char, SeedCryptor::BLOCK_SIZE> SeedCryptor::generateIV() {
-    std::array<unsigned char, BLOCK_SIZE> iv;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<unsigned short> dist(0, 255);
-
-    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
-        iv[i] = static_cast<unsigned char>(dist(gen));
-    }
-
-    return iv;
+    return Drbg::bytes<BLOCK_SIZE>();
 }
 
-std::string SeedCryptor::encrypt(const std::string& plaintext) {
+std::string SeedCryptor::encrypt(const std::string& plaintext) const {
     std::vector<unsigned char> data(plaintext.begin(), plaintext.end());
     return encrypt(data);
 }
 
-std::string SeedCryptor::encrypt(const std::vector<unsigned char>& plainData) {
-    std::vector<unsigned char> data = plainData;
-    addPadding(data);
+std::string SeedCryptor::encrypt(const std::vector<unsigned char>& plainData) const {
+    std::string result(encryptedSize(plainData.size()), '\0');
+    encryptInto(std::as_bytes(std::span(plainData)), std::as_writable_bytes(std::span(result)));
+    return result;
+}
 
-    // Генерируем IV
-    auto iv = generateIV();
+void SeedCryptor::encryptCBC(const unsigned char* in, unsigned char* out, const size_t size,
+                             std::array<unsigned char, BLOCK_SIZE>& chain) const {
+    const unsigned char* previous = chain.data();
+    for (size_t i = 0; i < size; i += BLOCK_SIZE) {
+        unsigned char* block = out + i;
+        // XOR с предыдущим блоком шифротекста (или IV для первого блока)
+        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+            block[j] = in[i + j] ^ previous[j];
+        }
+        encryptBlock(block);
+        previous = block;
+    }
+    if (size > 0) {
+        std::copy(out + size - BLOCK_SIZE, out + size, chain.begin());
+    }
+}
 
-    // Результат: IV + шифротекст
-    std::vector<unsigned char> result(iv.begin(), iv.end());
+void SeedCryptor::encryptBlocks(unsigned char* blocks, const size_t count) const {
+    size_t i = 0;
+#ifdef SEED_HAVE_AVX2_KERNEL
+    if (blockKernel() == BlockKernel::AVX2) {
+        for (; i + AVX2_LANES <= count; i += AVX2_LANES) {
+            transform8(blocks + i * BLOCK_SIZE, _roundKeys.data(), false);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        encryptBlock(blocks + i * BLOCK_SIZE);
+    }
+}
 
-    std::array<unsigned char, BLOCK_SIZE> previousBlock = iv;
+void SeedCryptor::decryptBlocks(unsigned char* blocks, const size_t count) const {
+    size_t i = 0;
+#ifdef SEED_HAVE_AVX2_KERNEL
+    if (blockKernel() == BlockKernel::AVX2) {
+        for (; i + AVX2_LANES <= count; i += AVX2_LANES) {
+            transform8(blocks + i * BLOCK_SIZE, _roundKeys.data(), true);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        decryptBlock(blocks + i * BLOCK_SIZE);
+    }
+}
 
-    // Шифрование в режиме CBC
-    for (size_t i = 0; i < data.size(); i += BLOCK_SIZE) {
-        std::array<unsigned char, BLOCK_SIZE> block;
-        std::copy(data.begin() + i, data.begin() + i + BLOCK_SIZE, block.begin());
+void SeedCryptor::decryptCBC(const unsigned char* in, unsigned char* out, const size_t size,
+                             std::array<unsigned char, BLOCK_SIZE>& chain) const {
+    // Блоки расшифровываются пачками через многоблочное ядро; шифротекст пачки
+    // сохраняется заранее: он нужен для XOR, а out может перекрывать in
+    std::array<unsigned char, CBC_BATCH_BLOCKS * BLOCK_SIZE> cipherBatch;
+    for (size_t first = 0; first < size; first += cipherBatch.size()) {
+        const size_t length = std::min(cipherBatch.size(), size - first);
+        std::copy(in + first, in + first + length, cipherBatch.begin());
+        unsigned char* block = out + first;
+        std::copy(cipherBatch.begin(), cipherBatch.begin() + static_cast<std::ptrdiff_t>(length), block);
+        decryptBlocks(block, length / BLOCK_SIZE);
 
-        // XOR с предыдущим блоком (или IV для первого блока)
+        // XOR с предыдущим блоком шифротекста
         for (size_t j = 0; j < BLOCK_SIZE; ++j) {
-            block[j] ^= previousBlock[j];
+            block[j] ^= chain[j];
+        }
+        for (size_t i = BLOCK_SIZE; i < length; ++i) {
+            block[i] ^= cipherBatch[i - BLOCK_SIZE];
         }
+        std::copy(cipherBatch.begin() + static_cast<std::ptrdiff_t>(length - BLOCK_SIZE),
+                  cipherBatch.begin() + static_cast<std::ptrdiff_t>(length), chain.begin());
+    }
+}
 
-        encryptBlock(block);
+void SeedCryptor::decryptCBCParallel(const unsigned char* in, unsigned char* out, const size_t size,
+                                     std::array<unsigned char, BLOCK_SIZE>& chain) const {
+    Executor& executor = Executor::global();
+    const bool overlaps = in != out && out < in + size && in < out + size;
+    if (size < PARALLEL_RANGE_SIZE * 2 || executor.concurrency() == 1 || overlaps) {
+        decryptCBC(in, out, size, chain);
+        return;
+    }
 
-        result.insert(result.end(), block.begin(), block.end());
-        previousBlock = block;
+    // Блок, предшествующий каждому участку, читается до того, как расшифровка
+    // на месте затрёт его открытыми данными
+    const size_t ranges = (size + PARALLEL_RANGE_SIZE - 1) / PARALLEL_RANGE_SIZE;
+    std::vector<std::array<unsigned char, BLOCK_SIZE>> chains(ranges);
+    chains[0] = chain;
+    for (size_t r = 1; r < ranges; ++r) {
+        const unsigned char* previous = in + r * PARALLEL_RANGE_SIZE - BLOCK_SIZE;
+        std::copy(previous, previous + BLOCK_SIZE, chains[r].begin());
     }
+    std::copy(in + size - BLOCK_SIZE, in + size, chain.begin());
 
-    return std::string(result.begin(), result.end());
+    parallelFor(0, ranges, [&](const size_t r) {
+        const size_t first = r * PARALLEL_RANGE_SIZE;
+        const size_t length = std::min(PARALLEL_RANGE_SIZE, size - first);
+        decryptCBC(in + first, out + first, length, chains[r]);
+    }, 1, executor);
+}
+
+size_t SeedCryptor::encryptInto(const std::span<const std::byte> plain, const std::span<std::byte> out) const {
+    const size_t total = encryptedSize(plain.size());
+    if (out.size() < total) {
+        throw std::invalid_argument("Недостаточный размер буфера для шифрования");
+    }
+    const auto* in = reinterpret_cast<const unsigned char*>(plain.data());
+    auto* dst = reinterpret_cast<unsigned char*>(out.data());
+
+    auto chain = generateIV();
+    std::copy(chain.begin(), chain.end(), dst);
+
+    // Целые блоки шифруются прямо из plain
+    const size_t whole = plain.size() / BLOCK_SIZE * BLOCK_SIZE;
+    encryptCBC(in, dst + BLOCK_SIZE, whole, chain);
+
+    // Последний блок: хвост открытых данных с паддингом PKCS7
+    std::array<unsigned char, BLOCK_SIZE> last;
+    const size_t tail = plain.size() - whole;
+    std::copy(in + whole, in + plain.size(), last.begin());
+    std::fill(last.begin() + static_cast<std::ptrdiff_t>(tail), last.end(),
+              static_cast<unsigned char>(BLOCK_SIZE - tail));
+    encryptCBC(last.data(), dst + BLOCK_SIZE + whole, BLOCK_SIZE, chain);
+    return total;
 }
 
-std::string SeedCryptor::decrypt(const std::vector<unsigned char>& cipherData) {
+size_t SeedCryptor::encryptInPlace(const std::span<std::byte> buffer, const size_t plainSize) const {
+    if (buffer.size() < encryptedSize(plainSize)) {
+        throw std::invalid_argument("Недостаточный размер буфера для шифрования");
+    }
+    return encryptInto(buffer.subspan(BLOCK_SIZE, plainSize), buffer);
+}
+
+/**
+ * Для CTR и Chunked шифротекст сначала переносится в out (memmove допускает
+ * перекрытие) и расшифровывается там на месте; записи индекса Chunked лежат
+ * после шифротекста и переносом не затрагиваются.
+ */
+size_t SeedCryptor::decryptInto(const std::span<const std::byte> cipher, const std::span<std::byte> out) const {
+    const auto* in = reinterpret_cast<const unsigned char*>(cipher.data());
+    auto* dst = reinterpret_cast<unsigned char*>(out.data());
+    const CipherMode mode = detectMode(cipher);
+    if (mode == CipherMode::Chunked) {
+        if (cipher.size() < CHUNKED_HEADER_SIZE + CHUNKED_TRAILER_SIZE) {
+            throw std::runtime_error("Данные слишком короткие для расшифрования");
+        }
+        const ChunkedLayout layout = chunkedLayout(in, in + cipher.size() - CHUNKED_TRAILER_SIZE, cipher.size());
+        checkKeyId(layout.keyId);
+        const auto size = static_cast<size_t>(layout.plainSize);
+        if (out.size() < size) {
+            throw std::invalid_argument("Недостаточный размер буфера для расшифрования");
+        }
+        std::memmove(dst, in + CHUNKED_HEADER_SIZE, size);
+        openChunks(macCryptor(), layout, 0, static_cast<size_t>(layout.chunkCount), in + CHUNKED_HEADER_SIZE + size,
+                   dst, true);
+        return size;
+    }
+    if (mode == CipherMode::CTR) {
+        if (cipher.size() < CTR_OVERHEAD) {
+            throw std::runtime_error("Данные слишком короткие для расшифрования");
+        }
+        checkKeyId(keyIdOf(cipher));
+        const size_t size = cipher.size() - CTR_OVERHEAD;
+        if (out.size() < size) {
+            throw std::invalid_argument("Недостаточный размер буфера для расшифрования");
+        }
+        std::array<unsigned char, BLOCK_SIZE> counter;
+        std::copy(in + HEADER_SIZE, in + CTR_OVERHEAD, counter.begin());
+        std::memmove(dst, in + CTR_OVERHEAD, size);
+        transformCTR(std::as_bytes(std::span(dst, size)), std::as_writable_bytes(std::span(dst, size)), counter);
+        return size;
+    }
+
+    if (cipher.size() < BLOCK_SIZE * 2) {
+        throw std::runtime_error("Данные слишком короткие для расшифрования");
+    }
+
+    if ((cipher.size() - BLOCK_SIZE) % BLOCK_SIZE != 0) {
+        throw std::runtime_error("Неверный размер зашифрованных данных");
+    }
+
+    const size_t size = cipher.size() - BLOCK_SIZE;
+    if (out.size() < size) {
+        throw std::invalid_argument("Недостаточный размер буфера для расшифрования");
+    }
+
+    // Извлекаем IV до записи в out: out может начинаться с него
+    std::array<unsigned char, BLOCK_SIZE> chain;
+    std::copy(in, in + BLOCK_SIZE, chain.begin());
+    decryptCBCParallel(in + BLOCK_SIZE, dst, size, chain);
+
+    return unpaddedSize(dst, size);
+}
+
+std::span<std::byte> SeedCryptor::decryptInPlace(const std::span<std::byte> buffer) const {
+    // Открытые данные остаются на месте шифротекста: после IV, заголовка CTR или заголовка Chunked
+    size_t start = BLOCK_SIZE;
+    if (const CipherMode mode = detectMode(buffer); mode == CipherMode::CTR) {
+        start = CTR_OVERHEAD;
+    } else if (mode == CipherMode::Chunked) {
+        start = CHUNKED_HEADER_SIZE;
+    }
+    const auto plain = buffer.subspan(std::min(buffer.size(), start));
+    return plain.first(decryptInto(buffer, plain));
+}
+
+std::string SeedCryptor::decrypt(const std::vector<unsigned char>& cipherData) const {
     auto decrypted = decryptToBytes(cipherData);
     return std::string(decrypted.begin(), decrypted.end());
 }
 
-std::string SeedCryptor::decrypt(const std::string& cipherData) {
+std::string SeedCryptor::decrypt(const std::string& cipherData) const {
     std::vector<unsigned char> data(cipherData.begin(), cipherData.end());
     return decrypt(data);
 }
 
-std::vector<unsigned char> SeedCryptor::decryptToBytes(const std::string& cipherData) {
+std::vector<unsigned char> SeedCryptor::decryptToBytes(const std::string& cipherData) const {
     std::vector<unsigned char> data(cipherData.begin(), cipherData.end());
     return decryptToBytes(data);
 }
 
-std::vector<unsigned char> SeedCryptor::decryptToBytes(const std::vector<unsigned char>& cipherData) {
-    if (cipherData.size() < BLOCK_SIZE * 2) {
+std::vector<unsigned char> SeedCryptor::decryptToBytes(const std::vector<unsigned char>& cipherData) const {
+    // Открытые данные любого формата не длиннее шифротекста
+    std::vector<unsigned char> result(cipherData.size());
+    result.resize(decryptInto(std::as_bytes(std::span(cipherData)), std::as_writable_bytes(std::span(result))));
+    return result;
+}
+
+// ============================================================================
+// Потоковое шифрование
+// ============================================================================
+
+namespace {
+    /**
+     * @brief Читает из in до size байт (меньше — только в конце потока)
+     * @throws std::runtime_error при ошибке чтения
+     */
+    size_t readFully(std::istream& in, unsigned char* data, const size_t size) {
+        in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+        if (in.bad()) {
+            throw std::runtime_error("Ошибка чтения входного потока");
+        }
+        return static_cast<size_t>(in.gcount());
+    }
+
+    /**
+     * @brief Записывает size байт в out
+     * @throws std::runtime_error при ошибке записи
+     */
+    void writeFully(std::ostream& out, const unsigned char* data, const size_t size) {
+        out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!out) {
+            throw std::runtime_error("Ошибка записи выходного потока");
+        }
+    }
+}
+
+namespace {
+    /**
+     * @brief Шифрует in порциями по bufferSize байт через writer и записывает в out
+     * @return Количество прочитанных байт открытых данных
+     */
+    std::uint64_t encryptThrough(SeedStreamEncryptor& writer, std::istream& in, std::ostream& out,
+                                 const size_t bufferSize) {
+        std::vector<unsigned char> buffer(bufferSize);
+        while (true) {
+            const size_t got = readFully(in, buffer.data(), buffer.size());
+            const auto cipher = writer.update(std::span<const unsigned char>(buffer.data(), got));
+            writeFully(out, cipher.data(), cipher.size());
+            if (got < buffer.size()) {
+                break;
+            }
+        }
+        const auto tail = writer.finish();
+        writeFully(out, tail.data(), tail.size());
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Ошибка записи выходного потока");
+        }
+        return writer.plainSize();
+    }
+}
+
+std::uint64_t SeedCryptor::encryptStream(std::istream& in, std::ostream& out, const CipherMode mode) const {
+    if (mode == CipherMode::Chunked) {
+        return encryptChunked(in, out);
+    }
+    SeedStreamEncryptor writer(*this, mode);
+    return encryptThrough(writer, in, out, STREAM_CHUNK_SIZE);
+}
+
+std::uint64_t SeedCryptor::decryptStream(std::istream& in, std::ostream& out) const {
+    SeedStreamDecryptor reader(*this, in);
+    std::uint64_t total = 0;
+    for (auto plain = reader.next(); !plain.empty(); plain = reader.next()) {
+        writeFully(out, plain.data(), plain.size());
+        total += plain.size();
+    }
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Ошибка записи выходного потока");
+    }
+    return total;
+}
+
+// ============================================================================
+// Режим CTR
+// ============================================================================
+
+namespace {
+    /// Сигнатура версионированного формата
+    constexpr std::array<unsigned char, 4> CONTAINER_MAGIC = {'S', 'E', 'E', 'D'};
+
+    /// Блоков ключевого потока, шифруемых за один вызов encryptBlocks
+    constexpr size_t KEYSTREAM_BATCH = 64;
+
+    /**
+     * @brief Записывает в out значение counter + index (128-битное сложение, big-endian)
+     */
+    void counterBlock(const std::array<unsigned char, 16>& counter, std::uint64_t index, unsigned char* out) {
+        unsigned carry = 0;
+        for (size_t i = 16; i-- > 0;) {
+            const unsigned sum = counter[i] + static_cast<unsigned>(index & 0xFF) + carry;
+            out[i] = static_cast<unsigned char>(sum);
+            carry = sum >> 8;
+            index >>= 8;
+        }
+    }
+}
+
+void SeedCryptor::writeHeader(unsigned char* out, const CipherMode mode, const std::uint16_t keyId) {
+    std::copy(CONTAINER_MAGIC.begin(), CONTAINER_MAGIC.end(), out);
+    out[4] = keyId == 0 ? FORMAT_VERSION : KEYED_FORMAT_VERSION;
+    out[5] = static_cast<unsigned char>(mode);
+    out[6] = static_cast<unsigned char>(keyId);
+    out[7] = static_cast<unsigned char>(keyId >> 8);
+}
+
+void SeedCryptor::checkKeyId(const std::uint16_t keyId) const {
+    if (keyId != 0 && keyId != _keyId) {
+        throw std::runtime_error("Данные зашифрованы ключом с ID " + std::to_string(keyId));
+    }
+}
+
+bool SeedCryptor::hasFormatHeader(const std::span<const std::byte> head) {
+    return detectMode(head) != CipherMode::CBC;
+}
+
+CipherMode SeedCryptor::detectMode(const std::span<const std::byte> head) {
+    if (head.size() < HEADER_SIZE) {
+        return CipherMode::CBC;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(head.data());
+    // Случайный IV файла CBC совпадает с заголовком с вероятностью 2^-64 (2^-48 для заголовка с ID ключа)
+    const bool keyed = data[6] != 0 || data[7] != 0;
+    if (!std::equal(CONTAINER_MAGIC.begin(), CONTAINER_MAGIC.end(), data) ||
+        data[4] != (keyed ? KEYED_FORMAT_VERSION : FORMAT_VERSION) ||
+        (data[5] != static_cast<unsigned char>(CipherMode::CTR) &&
+         data[5] != static_cast<unsigned char>(CipherMode::Chunked))) {
+        return CipherMode::CBC;
+    }
+    return static_cast<CipherMode>(data[5]);
+}
+
+std::uint16_t SeedCryptor::keyIdOf(const std::span<const std::byte> head) {
+    if (detectMode(head) == CipherMode::CBC) {
+        return 0;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(head.data());
+    return static_cast<std::uint16_t>(data[6] | data[7] << 8);
+}
+
+
+void SeedCryptor::transformCTRSerial(const unsigned char* in, unsigned char* out, const size_t size,
+                                     const std::array<unsigned char, BLOCK_SIZE>& counter,
+                                     const std::uint64_t offset) const {
+    std::array<unsigned char, KEYSTREAM_BATCH * BLOCK_SIZE> keystream;
+    std::uint64_t block = offset / BLOCK_SIZE;
+    size_t skip = offset % BLOCK_SIZE;
+    for (size_t done = 0; done < size;) {
+        // Ключевой поток для следующей пачки блоков
+        const size_t count = std::min(KEYSTREAM_BATCH, (skip + size - done + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        for (size_t i = 0; i < count; ++i) {
+            counterBlock(counter, block + i, keystream.data() + i * BLOCK_SIZE);
+        }
+        encryptBlocks(keystream.data(), count);
+
+        const size_t length = std::min(count * BLOCK_SIZE - skip, size - done);
+        for (size_t i = 0; i < length; ++i) {
+            out[done + i] = in[done + i] ^ keystream[skip + i];
+        }
+        done += length;
+        block += count;
+        skip = 0;
+    }
+}
+
+void SeedCryptor::transformCTR(const std::span<const std::byte> in, const std::span<std::byte> out,
+                               const std::array<unsigned char, BLOCK_SIZE>& counter,
+                               const std::uint64_t offset) const {
+    const auto* src = reinterpret_cast<const unsigned char*>(in.data());
+    auto* dst = reinterpret_cast<unsigned char*>(out.data());
+    const size_t size = std::min(in.size(), out.size());
+    Executor& executor = Executor::global();
+    if (size < PARALLEL_RANGE_SIZE * 2 || executor.concurrency() == 1) {
+        transformCTRSerial(src, dst, size, counter, offset);
+        return;
+    }
+
+    // Блоки ключевого потока независимы: участки обрабатываются параллельно
+    const size_t ranges = (size + PARALLEL_RANGE_SIZE - 1) / PARALLEL_RANGE_SIZE;
+    parallelFor(0, ranges, [&](const size_t r) {
+        const size_t first = r * PARALLEL_RANGE_SIZE;
+        const size_t length = std::min(PARALLEL_RANGE_SIZE, size - first);
+        transformCTRSerial(src + first, dst + first, length, counter, offset + first);
+    }, 1, executor);
+}
+
+size_t SeedCryptor::encryptCTRInto(const std::span<const std::byte> plain, const std::span<std::byte> out) const {
+    if (out.size() < CTR_OVERHEAD + plain.size()) {
+        throw std::invalid_argument("Недостаточный размер буфера для шифрования");
+    }
+    auto* dst = reinterpret_cast<unsigned char*>(out.data());
+    writeHeader(dst, CipherMode::CTR, _keyId);
+    const auto counter = generateIV();
+    std::copy(counter.begin(), counter.end(), dst + HEADER_SIZE);
+    transformCTR(plain, out.subspan(CTR_OVERHEAD, plain.size()), counter);
+    return CTR_OVERHEAD + plain.size();
+}
+
+std::string SeedCryptor::encryptCTR(const std::string& plaintext) const {
+    std::string result(CTR_OVERHEAD + plaintext.size(), '\0');
+    encryptCTRInto(std::as_bytes(std::span(plaintext)), std::as_writable_bytes(std::span(result)));
+    return result;
+}
+
+std::vector<unsigned char> SeedCryptor::decryptRange(std::istream& in, const std::uint64_t offset, const size_t length) const {
+    std::array<unsigned char, CTR_OVERHEAD> head;
+    in.clear();
+    in.seekg(0);
+    if (readFully(in, head.data(), HEADER_SIZE) == HEADER_SIZE &&
+        detectMode(std::as_bytes(std::span(head.data(), HEADER_SIZE))) == CipherMode::Chunked) {
+        return decryptRangeChunked(in, offset, length);
+    }
+    in.clear();
+    in.seekg(0);
+    if (readFully(in, head.data(), CTR_OVERHEAD) != CTR_OVERHEAD ||
+        detectMode(std::as_bytes(std::span(head))) != CipherMode::CTR) {
+        throw std::runtime_error("Произвольный доступ поддерживается только для форматов CTR и Chunked");
+    }
+    checkKeyId(keyIdOf(std::as_bytes(std::span(head))));
+    std::array<unsigned char, BLOCK_SIZE> counter;
+    std::copy(head.begin() + HEADER_SIZE, head.end(), counter.begin());
+
+    // Диапазон за концом данных обрезается
+    in.seekg(0, std::ios::end);
+    const auto end = in.tellg();
+    if (!in || end < static_cast<std::streamoff>(CTR_OVERHEAD)) {
+        throw std::runtime_error("Ошибка чтения входного потока");
+    }
+    const auto plainSize = static_cast<std::uint64_t>(end) - CTR_OVERHEAD;
+    if (offset >= plainSize) {
+        return {};
+    }
+    std::vector<unsigned char> result(static_cast<size_t>(std::min<std::uint64_t>(length, plainSize - offset)));
+    in.seekg(static_cast<std::streamoff>(CTR_OVERHEAD + offset));
+    if (readFully(in, result.data(), result.size()) != result.size()) {
+        throw std::runtime_error("Ошибка чтения входного потока");
+    }
+    transformCTR(std::as_bytes(std::span(result)), std::as_writable_bytes(std::span(result)), counter, offset);
+    return result;
+}
+
+// ============================================================================
+// Формат с порциями и SEED-CMAC
+// ============================================================================
+
+namespace {
+    /// Размер начала сообщения CMAC порции: заголовок, номер и признак последней порции, IV
+    constexpr size_t CHUNK_MAC_PREFIX = 48;
+
+    void putLE(unsigned char* out, std::uint64_t value, const size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i, value >>= 8) {
+            out[i] = static_cast<unsigned char>(value);
+        }
+    }
+
+    std::uint64_t getLE(const unsigned char* data, const size_t bytes) {
+        std::uint64_t value = 0;
+        for (size_t i = bytes; i-- > 0;) {
+            value = value << 8 | data[i];
+        }
+        return value;
+    }
+
+    /// Удвоение в GF(2^128) для подключей CMAC
+    std::array<unsigned char, 16> doubleBlock(const std::array<unsigned char, 16>& block) {
+        std::array<unsigned char, 16> result;
+        for (size_t i = 0; i < 16; ++i) {
+            result[i] = static_cast<unsigned char>(block[i] << 1 | (i + 1 < 16 ? block[i + 1] >> 7 : 0));
+        }
+        if (block[0] & 0x80) {
+            result[15] ^= 0x87;
+        }
+        return result;
+    }
+
+    /// Заголовок файла формата Chunked
+    void chunkedHeader(unsigned char* out, const std::uint32_t chunkSize, const std::uint16_t keyId) {
+        std::copy(CONTAINER_MAGIC.begin(), CONTAINER_MAGIC.end(), out);
+        out[4] = keyId == 0 ? SeedCryptor::FORMAT_VERSION : SeedCryptor::KEYED_FORMAT_VERSION;
+        out[5] = static_cast<unsigned char>(CipherMode::Chunked);
+        putLE(out + 6, keyId, 2);
+        putLE(out + 8, chunkSize, 4);
+        putLE(out + 12, 0, 4);
+    }
+
+    /// Начало сообщения CMAC порции number
+    void chunkMacPrefix(unsigned char* out, const std::uint32_t chunkSize, const std::uint16_t keyId,
+                        const std::uint64_t number, const bool last, const unsigned char* iv) {
+        chunkedHeader(out, chunkSize, keyId);
+        putLE(out + 16, number, 8);
+        out[24] = last ? 1 : 0;
+        std::fill(out + 25, out + 32, 0);
+        std::copy(iv, iv + 16, out + 32);
+    }
+
+    /// Порций в одной пачке при шифровании и чтении
+    size_t chunkBatch(const Executor& executor) {
+        return static_cast<size_t>(executor.concurrency()) * 2;
+    }
+}
+
+std::array<unsigned char, SeedCryptor::BLOCK_SIZE> SeedCryptor::cmac(const unsigned char* head, const size_t headSize,
+                                                                      const unsigned char* body, const size_t bodySize) const {
+    // Подключи K1, K2 из L = E(0)
+    std::array<unsigned char, BLOCK_SIZE> k1{};
+    encryptBlock(k1.data());
+    k1 = doubleBlock(k1);
+    const auto k2 = doubleBlock(k1);
+
+    std::array<unsigned char, BLOCK_SIZE> x{};
+    const auto absorb = [&](const unsigned char* block) {
+        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+            x[j] ^= block[j];
+        }
+        encryptBlock(x.data());
+    };
+
+    // Последний блок сообщения — полный блок head, если body пусто
+    const size_t headBlocks = headSize / BLOCK_SIZE - (bodySize == 0 ? 1 : 0);
+    for (size_t i = 0; i < headBlocks; ++i) {
+        absorb(head + i * BLOCK_SIZE);
+    }
+
+    std::array<unsigned char, BLOCK_SIZE> last{};
+    const std::array<unsigned char, BLOCK_SIZE>* subkey = &k1;
+    if (bodySize == 0) {
+        std::copy(head + headSize - BLOCK_SIZE, head + headSize, last.begin());
+    } else {
+        const size_t full = (bodySize - 1) / BLOCK_SIZE;
+        for (size_t i = 0; i < full; ++i) {
+            absorb(body + i * BLOCK_SIZE);
+        }
+        const size_t rest = bodySize - full * BLOCK_SIZE;
+        std::copy(body + full * BLOCK_SIZE, body + bodySize, last.begin());
+        if (rest < BLOCK_SIZE) {
+            last[rest] = 0x80;
+            subkey = &k2;
+        }
+    }
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+        last[j] ^= (*subkey)[j];
+    }
+    absorb(last.data());
+    return x;
+}
+
+void SeedCryptor::deriveMacCryptor() {
+    // Ключ CMAC — зашифрованная основным ключом константа
+    std::array<unsigned char, SeedKey::KEY_SIZE> macKey = {'S', 'E', 'E', 'D', '-', 'C', 'M', 'A', 'C', '-', 'K', 'E', 'Y'};
+    encryptBlock(macKey.data());
+    _mac = std::shared_ptr<const SeedCryptor>(new SeedCryptor(SeedKey(macKey), MacKeyTag{}));
+}
+
+const SeedCryptor& SeedCryptor::macCryptor() const {
+    return *_mac;
+}
+
+std::uint64_t SeedCryptor::encryptChunked(std::istream& in, std::ostream& out, const size_t chunkSize) const {
+    // Пачка порций за одно чтение: шифруются и подписываются параллельно
+    SeedStreamEncryptor writer(*this, CipherMode::Chunked, chunkSize);
+    return encryptThrough(writer, in, out, chunkBatch(Executor::global()) * chunkSize);
+}
+
+std::string SeedCryptor::encryptChunked(const std::string& plaintext, const size_t chunkSize) const {
+    std::istringstream in(plaintext);
+    std::ostringstream out;
+    encryptChunked(in, out, chunkSize);
+    return out.str();
+}
+
+ChunkedLayout SeedCryptor::readChunkedLayout(std::istream& in) {
+    in.clear();
+    in.seekg(0, std::ios::end);
+    const auto end = in.tellg();
+    if (!in || end < 0) {
+        throw std::runtime_error("Формат с порциями читается только из потока с позиционированием");
+    }
+    if (end < static_cast<std::streamoff>(CHUNKED_HEADER_SIZE + CHUNKED_TRAILER_SIZE)) {
         throw std::runtime_error("Данные слишком короткие для расшифрования");
     }
+    const auto fileSize = static_cast<std::uint64_t>(end);
+
+    std::array<unsigned char, CHUNKED_HEADER_SIZE> header;
+    std::array<unsigned char, CHUNKED_TRAILER_SIZE> trailer;
+    in.seekg(0);
+    const bool headerRead = readFully(in, header.data(), header.size()) == header.size();
+    in.seekg(static_cast<std::streamoff>(fileSize - CHUNKED_TRAILER_SIZE));
+    if (!headerRead || readFully(in, trailer.data(), trailer.size()) != trailer.size()) {
+        throw std::runtime_error("Данные не в формате с порциями");
+    }
+    return chunkedLayout(header.data(), trailer.data(), fileSize);
+}
 
-    if ((cipherData.size() - BLOCK_SIZE) % BLOCK_SIZE != 0) {
+ChunkedLayout SeedCryptor::chunkedLayout(const unsigned char* header, const unsigned char* trailer,
+                                         const std::uint64_t fileSize) {
+    if (detectMode(std::as_bytes(std::span(header, CHUNKED_HEADER_SIZE))) != CipherMode::Chunked) {
+        throw std::runtime_error("Данные не в формате с порциями");
+    }
+    ChunkedLayout layout;
+    layout.chunkSize = static_cast<std::uint32_t>(getLE(header + 8, 4));
+    layout.plainSize = getLE(trailer, 8);
+    layout.chunkCount = getLE(trailer + 8, 8);
+    layout.keyId = keyIdOf(std::as_bytes(std::span(header, CHUNKED_HEADER_SIZE)));
+    const std::uint64_t overhead = CHUNKED_HEADER_SIZE + CHUNKED_TRAILER_SIZE;
+    if (fileSize < overhead) {
+        throw std::runtime_error("Данные слишком короткие для расшифрования");
+    }
+    if (layout.chunkSize == 0 || layout.chunkSize % BLOCK_SIZE != 0 || getLE(header + 12, 4) != 0 ||
+        layout.plainSize > fileSize || layout.chunkCount > fileSize / CHUNK_ENTRY_SIZE ||
+        layout.chunkCount != std::max<std::uint64_t>(1, (layout.plainSize + layout.chunkSize - 1) / layout.chunkSize) ||
+        overhead + layout.plainSize + layout.chunkCount * CHUNK_ENTRY_SIZE != fileSize) {
         throw std::runtime_error("Неверный размер зашифрованных данных");
     }
+    return layout;
+}
 
-    // Извлекаем IV
-    std::array<unsigned char, BLOCK_SIZE> iv;
-    std::copy(cipherData.begin(), cipherData.begin() + BLOCK_SIZE, iv.begin());
+void SeedCryptor::openChunks(const SeedCryptor& mac, const ChunkedLayout& layout, const std::uint64_t first,
+                             const size_t count, const unsigned char* entries, unsigned char* data,
+                             const bool decrypt) const {
+    const size_t chunkSize = layout.chunkSize;
+    parallelFor(0, count, [&](const size_t k) {
+        const std::uint64_t number = first + k;
+        const unsigned char* entry = entries + k * CHUNK_ENTRY_SIZE;
+        unsigned char* chunk = data + k * chunkSize;
+        const auto size = static_cast<size_t>(std::min<std::uint64_t>(chunkSize, layout.plainSize - number * chunkSize));
+
+        std::array<unsigned char, CHUNK_MAC_PREFIX> prefix;
+        chunkMacPrefix(prefix.data(), layout.chunkSize, layout.keyId, number, number + 1 == layout.chunkCount, entry);
+        const auto tag = mac.cmac(prefix.data(), prefix.size(), chunk, size);
+        // Сравнение без раннего выхода
+        unsigned char diff = 0;
+        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+            diff |= tag[j] ^ entry[BLOCK_SIZE + j];
+        }
+        if (diff != 0) {
+            throw std::runtime_error("Порция " + std::to_string(number) + " не прошла проверку целостности");
+        }
 
-    std::vector<unsigned char> result;
-    std::array<unsigned char, BLOCK_SIZE> previousBlock = iv;
+        if (decrypt) {
+            std::array<unsigned char, BLOCK_SIZE> iv;
+            std::copy(entry, entry + BLOCK_SIZE, iv.begin());
+            transformCTRSerial(chunk, chunk, size, iv, 0);
+        }
+    }, 1, Executor::global());
+}
 
-    // Расшифрование в режиме CBC
-    for (size_t i = BLOCK_SIZE; i < cipherData.size(); i += BLOCK_SIZE) {
-        std::array<unsigned char, BLOCK_SIZE> block;
-        std::copy(cipherData.begin() + i, cipherData.begin() + i + BLOCK_SIZE, block.begin());
+namespace {
+    /// Размер открытых данных порций [first, first + count) файла формата Chunked
+    size_t chunksSize(const ChunkedLayout& layout, const std::uint64_t first, const std::uint64_t count) {
+        const std::uint64_t end = std::min<std::uint64_t>(layout.plainSize, (first + count) * layout.chunkSize);
+        return static_cast<size_t>(end - first * layout.chunkSize);
+    }
 
-        std::array<unsigned char, BLOCK_SIZE> cipherBlock = block;
+    /// Читает записи индекса и шифротекст порций [first, first + count) в data (chunksSize байт)
+    void readChunks(std::istream& in, const ChunkedLayout& layout, const std::uint64_t first, const size_t count,
+                    std::vector<unsigned char>& entries, unsigned char* data) {
+        entries.resize(count * SeedCryptor::CHUNK_ENTRY_SIZE);
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(SeedCryptor::CHUNKED_HEADER_SIZE + layout.plainSize +
+                                             first * SeedCryptor::CHUNK_ENTRY_SIZE));
+        const bool entriesRead = readFully(in, entries.data(), entries.size()) == entries.size();
+        in.seekg(static_cast<std::streamoff>(SeedCryptor::CHUNKED_HEADER_SIZE + first * layout.chunkSize));
+        const size_t size = chunksSize(layout, first, count);
+        if (!entriesRead || readFully(in, data, size) != size) {
+            throw std::runtime_error("Ошибка чтения входного потока");
+        }
+    }
 
-        decryptBlock(block);
+    /// Читает записи индекса и шифротекст порций [first, first + count) файла формата Chunked
+    void readChunks(std::istream& in, const ChunkedLayout& layout, const std::uint64_t first, const size_t count,
+                    std::vector<unsigned char>& entries, std::vector<unsigned char>& data) {
+        data.resize(chunksSize(layout, first, count));
+        readChunks(in, layout, first, count, entries, data.data());
+    }
+}
 
-        // XOR с предыдущим блоком шифротекста
-        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
-            block[j] ^= previousBlock[j];
+void SeedCryptor::verifyChunked(std::istream& in) const {
+    const ChunkedLayout layout = readChunkedLayout(in);
+    checkKeyId(layout.keyId);
+    const SeedCryptor& mac = macCryptor();
+    const size_t batch = chunkBatch(Executor::global());
+    std::vector<unsigned char> entries;
+    std::vector<unsigned char> data;
+    for (std::uint64_t first = 0; first < layout.chunkCount; first += batch) {
+        const auto count = static_cast<size_t>(std::min<std::uint64_t>(batch, layout.chunkCount - first));
+        readChunks(in, layout, first, count, entries, data);
+        openChunks(mac, layout, first, count, entries.data(), data.data(), false);
+    }
+}
+
+std::vector<unsigned char> SeedCryptor::decryptRangeChunked(std::istream& in, const std::uint64_t offset,
+                                                            const size_t length) const {
+    const ChunkedLayout layout = readChunkedLayout(in);
+    checkKeyId(layout.keyId);
+    if (offset >= layout.plainSize || length == 0) {
+        return {};
+    }
+    // length == SIZE_MAX означает «до конца»: offset + length переполнился бы
+    const std::uint64_t end = offset + std::min<std::uint64_t>(length, layout.plainSize - offset);
+    const std::uint64_t first = offset / layout.chunkSize;
+    const auto count = static_cast<size_t>((end - 1) / layout.chunkSize + 1 - first);
+
+    // Проверяются и расшифровываются только порции, покрывающие диапазон
+    std::vector<unsigned char> entries;
+    std::vector<unsigned char> data;
+    readChunks(in, layout, first, count, entries, data);
+    openChunks(macCryptor(), layout, first, count, entries.data(), data.data(), true);
+
+    const std::uint64_t skip = offset - first * layout.chunkSize;
+    return std::vector<unsigned char>(data.begin() + static_cast<std::ptrdiff_t>(skip),
+                                      data.begin() + static_cast<std::ptrdiff_t>(skip + end - offset));
+}
+
+// ============================================================================
+// SeedStreamDecryptor реализация
+// ============================================================================
+
+SeedStreamDecryptor::SeedStreamDecryptor(const SeedCryptor& cryptor, std::istream& in)
+    : _cryptor(cryptor), _in(in) {
+    constexpr size_t BLOCK = SeedCryptor::BLOCK_SIZE;
+    constexpr size_t HEADER = SeedCryptor::HEADER_SIZE;
+    // Первые HEADER_SIZE байт — либо заголовок, либо начало IV исходного формата CBC
+    if (readFully(in, _chain.data(), HEADER) != HEADER) {
+        throw std::runtime_error("Данные слишком короткие для расшифрования");
+    }
+    _mode = SeedCryptor::detectMode(std::as_bytes(std::span(_chain.data(), HEADER)));
+    cryptor.checkKeyId(SeedCryptor::keyIdOf(std::as_bytes(std::span(_chain.data(), HEADER))));
+
+    if (_mode == CipherMode::Chunked) {
+        _layout = SeedCryptor::readChunkedLayout(in);
+        _mac = &cryptor.macCryptor();
+        return;
+    }
+    const size_t headRead = _mode == CipherMode::CTR ? 0 : HEADER;
+    if (readFully(in, _chain.data() + headRead, BLOCK - headRead) != BLOCK - headRead) {
+        throw std::runtime_error("Данные слишком короткие для расшифрования");
+    }
+    if (_mode == CipherMode::CBC) {
+        _input.resize(SeedCryptor::STREAM_CHUNK_SIZE + BLOCK * 2);
+    }
+}
+
+std::span<const unsigned char> SeedStreamDecryptor::next() {
+    while (_position == _output.size()) {
+        if (_finished) {
+            return {};
         }
+        refill();
+    }
+    const std::span<const unsigned char> plain(_output.data() + _position, _output.size() - _position);
+    _position = _output.size();
+    return plain;
+}
 
-        result.insert(result.end(), block.begin(), block.end());
-        previousBlock = cipherBlock;
+size_t SeedStreamDecryptor::read(unsigned char* out, const size_t size) {
+    if (_position == _output.size() && !_finished) {
+        if (const size_t direct = readDirect(out, size); direct > 0 || _finished) {
+            return direct;
+        }
+    }
+    while (_position == _output.size()) {
+        if (_finished) {
+            return 0;
+        }
+        refill();
     }
+    const size_t count = std::min(size, _output.size() - _position);
+    std::copy(_output.begin() + static_cast<std::ptrdiff_t>(_position),
+              _output.begin() + static_cast<std::ptrdiff_t>(_position + count), out);
+    _position += count;
+    return count;
+}
 
-    removePadding(result);
-    return result;
+/**
+ * CTR расшифровывается на месте в out. Chunked — если в out помещается
+ * хотя бы одна порция: шифротекст целых порций читается в out и там же
+ * проверяется и расшифровывается. CBC идёт через _output: последний блок
+ * удерживается до конца данных, чтобы снять паддинг.
+ */
+size_t SeedStreamDecryptor::readDirect(unsigned char* out, const size_t size) {
+    if (_mode == CipherMode::CTR) {
+        const size_t got = readFully(_in, out, size);
+        _cryptor.transformCTR(std::as_bytes(std::span(out, got)), std::as_writable_bytes(std::span(out, got)),
+                              _chain, _offset);
+        _offset += got;
+        _finished = got < size;
+        return got;
+    }
+    if (_mode != CipherMode::Chunked) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(
+        std::min<std::uint64_t>(chunkBatch(Executor::global()), _layout.chunkCount - _nextChunk));
+    while (count > 0 && chunksSize(_layout, _nextChunk, count) > size) {
+        --count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    readChunks(_in, _layout, _nextChunk, count, _entries, out);
+    _cryptor.openChunks(*_mac, _layout, _nextChunk, count, _entries.data(), out, true);
+    const size_t plain = chunksSize(_layout, _nextChunk, count);
+    _nextChunk += count;
+    _finished = _nextChunk == _layout.chunkCount;
+    return plain;
 }
 
+void SeedStreamDecryptor::refill() {
+    constexpr size_t BLOCK = SeedCryptor::BLOCK_SIZE;
+    constexpr size_t CHUNK = SeedCryptor::STREAM_CHUNK_SIZE;
+    _position = 0;
+
+    if (_mode == CipherMode::Chunked) {
+        const auto count = static_cast<size_t>(
+            std::min<std::uint64_t>(chunkBatch(Executor::global()), _layout.chunkCount - _nextChunk));
+        readChunks(_in, _layout, _nextChunk, count, _entries, _output);
+        _cryptor.openChunks(*_mac, _layout, _nextChunk, count, _entries.data(), _output.data(), true);
+        _nextChunk += count;
+        _finished = _nextChunk == _layout.chunkCount;
+        return;
+    }
+
+    if (_mode == CipherMode::CTR) {
+        _output.resize(CHUNK);
+        const size_t got = readFully(_in, _output.data(), CHUNK);
+        _output.resize(got);
+        _cryptor.transformCTR(std::as_bytes(std::span(_output)), std::as_writable_bytes(std::span(_output)),
+                              _chain, _offset);
+        _offset += got;
+        _finished = got < CHUNK;
+        return;
+    }
+
+    // CBC: в начале _input — удержанные с прошлой порции байты (хвост, не кратный блоку, и последний блок)
+    const size_t got = readFully(_in, _input.data() + _held, CHUNK);
+    const size_t available = _held + got;
+    if (got == 0) {
+        if (available == 0) {
+            throw std::runtime_error("Данные слишком короткие для расшифрования");
+        }
+        if (available % BLOCK != 0) {
+            throw std::runtime_error("Неверный размер зашифрованных данных");
+        }
+        // Последний блок: расшифровываем и снимаем паддинг
+        _output.resize(available);
+        _cryptor.decryptCBC(_input.data(), _output.data(), available, _chain);
+        _output.resize(SeedCryptor::unpaddedSize(_output.data(), available));
+        _finished = true;
+        return;
+    }
+    // Расшифровываем все целые блоки, кроме последнего: он может оказаться паддингом
+    const size_t whole = available / BLOCK * BLOCK;
+    const size_t ready = whole >= BLOCK ? whole - BLOCK : 0;
+    _output.resize(ready);
+    _cryptor.decryptCBCParallel(_input.data(), _output.data(), ready, _chain);
+    _held = available - ready;
+    std::copy(_input.begin() + static_cast<std::ptrdiff_t>(ready),
+              _input.begin() + static_cast<std::ptrdiff_t>(available), _input.begin());
+}
+
+// ============================================================================
+// SeedStreamEncryptor реализация
+// ============================================================================
+
+SeedStreamEncryptor::SeedStreamEncryptor(const SeedCryptor& cryptor, const CipherMode mode, const size_t chunkSize)
+    : _cryptor(cryptor), _mode(mode), _chunkSize(chunkSize) {
+    if (mode == CipherMode::Chunked) {
+        if (chunkSize == 0 || chunkSize % SeedCryptor::BLOCK_SIZE != 0 || chunkSize > (size_t(1) << 31)) {
+            throw std::invalid_argument("Недопустимый размер порции");
+        }
+        _mac = &cryptor.macCryptor();
+    } else {
+        _chain = SeedCryptor::generateIV();
+    }
+}
+
+void SeedStreamEncryptor::start() {
+    if (_started) {
+        return;
+    }
+    _started = true;
+    if (_mode == CipherMode::Chunked) {
+        _output.resize(SeedCryptor::CHUNKED_HEADER_SIZE);
+        chunkedHeader(_output.data(), static_cast<std::uint32_t>(_chunkSize), _cryptor.keyId());
+        return;
+    }
+    if (_mode == CipherMode::CTR) {
+        _output.resize(SeedCryptor::HEADER_SIZE);
+        SeedCryptor::writeHeader(_output.data(), _mode, _cryptor.keyId());
+    }
+    _output.insert(_output.end(), _chain.begin(), _chain.end());
+}
+
+std::span<const unsigned char> SeedStreamEncryptor::update(const std::span<const unsigned char> plain) {
+    if (_finished) {
+        throw std::logic_error("Шифрование уже завершено");
+    }
+    _output.clear();
+    start();
+    const std::uint64_t offset = _total;
+    _total += plain.size();
+
+    if (_mode == CipherMode::CTR) {
+        const size_t at = _output.size();
+        _output.insert(_output.end(), plain.begin(), plain.end());
+        const auto cipher = std::span(_output).subspan(at);
+        _cryptor.transformCTR(std::as_bytes(cipher), std::as_writable_bytes(cipher), _chain, offset);
+        return _output;
+    }
+
+    _pending.insert(_pending.end(), plain.begin(), plain.end());
+    if (_mode == CipherMode::CBC) {
+        const size_t whole = _pending.size() / SeedCryptor::BLOCK_SIZE * SeedCryptor::BLOCK_SIZE;
+        const size_t at = _output.size();
+        _output.resize(at + whole);
+        _cryptor.encryptCBC(_pending.data(), _output.data() + at, whole, _chain);
+        _pending.erase(_pending.begin(), _pending.begin() + static_cast<std::ptrdiff_t>(whole));
+        return _output;
+    }
+
+    // Порция, на которой данные могут закончиться, удерживается до finish()
+    if (_pending.size() > _chunkSize) {
+        sealChunks((_pending.size() - 1) / _chunkSize, false);
+    }
+    return _output;
+}
+
+std::span<const unsigned char> SeedStreamEncryptor::finish() {
+    if (_finished) {
+        throw std::logic_error("Шифрование уже завершено");
+    }
+    _output.clear();
+    start();
+    _finished = true;
+
+    if (_mode == CipherMode::CBC) {
+        // Хвост (возможно, пустой) дополняется PKCS7 до целого блока
+        const size_t tail = _pending.size();
+        const size_t padded = (tail / SeedCryptor::BLOCK_SIZE + 1) * SeedCryptor::BLOCK_SIZE;
+        _pending.resize(padded, static_cast<unsigned char>(padded - tail));
+        const size_t at = _output.size();
+        _output.resize(at + padded);
+        _cryptor.encryptCBC(_pending.data(), _output.data() + at, padded, _chain);
+    } else if (_mode == CipherMode::Chunked) {
+        // Последняя порция (возможно, пустая) и индекс
+        sealChunks(1, true);
+        _output.insert(_output.end(), _index.begin(), _index.end());
+        std::array<unsigned char, SeedCryptor::CHUNKED_TRAILER_SIZE> trailer;
+        putLE(trailer.data(), _total, 8);
+        putLE(trailer.data() + 8, _nextChunk, 8);
+        _output.insert(_output.end(), trailer.begin(), trailer.end());
+    }
+    _pending.clear();
+    _pending.shrink_to_fit();
+    return _output;
+}
+
+void SeedStreamEncryptor::sealChunks(const size_t count, const bool last) {
+    constexpr size_t BLOCK = SeedCryptor::BLOCK_SIZE;
+    const size_t bytes = std::min(_pending.size(), count * _chunkSize);
+    const size_t at = _output.size();
+    _output.insert(_output.end(), _pending.begin(), _pending.begin() + static_cast<std::ptrdiff_t>(bytes));
+
+    // IV генерируются последовательно, шифрование и CMAC — параллельно
+    const size_t entriesAt = _index.size();
+    _index.resize(entriesAt + count * SeedCryptor::CHUNK_ENTRY_SIZE);
+    for (size_t k = 0; k < count; ++k) {
+        const auto iv = SeedCryptor::generateIV();
+        std::copy(iv.begin(), iv.end(), _index.begin() + static_cast<std::ptrdiff_t>(entriesAt + k * SeedCryptor::CHUNK_ENTRY_SIZE));
+    }
+    const auto size32 = static_cast<std::uint32_t>(_chunkSize);
+    parallelFor(0, count, [&](const size_t k) {
+        unsigned char* entry = _index.data() + entriesAt + k * SeedCryptor::CHUNK_ENTRY_SIZE;
+        unsigned char* data = _output.data() + at + k * _chunkSize;
+        const size_t size = std::min(_chunkSize, bytes - std::min(bytes, k * _chunkSize));
+        std::array<unsigned char, BLOCK> iv;
+        std::copy(entry, entry + BLOCK, iv.begin());
+        _cryptor.transformCTRSerial(data, data, size, iv, 0);
+
+        std::array<unsigned char, CHUNK_MAC_PREFIX> prefix;
+        chunkMacPrefix(prefix.data(), size32, _cryptor.keyId(), _nextChunk + k, last && k + 1 == count, entry);
+        const auto tag = _mac->cmac(prefix.data(), prefix.size(), data, size);
+        std::copy(tag.begin(), tag.end(), entry + BLOCK);
+    }, 1);
+
+    _pending.erase(_pending.begin(), _pending.begin() + static_cast<std::ptrdiff_t>(bytes));
+    _nextChunk += count;
+}
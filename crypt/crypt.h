@@ -12,7 +12,12 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
 
 /**
  * @class SeedKey
@@ -48,7 +53,7 @@ public:
 
     /**
      * @brief Генерирует случайный 128-битный ключ
-     * @return Новый объект SeedKey со случайным ключом
+     * @return Новый объект SeedKey со случайным ключом (байты из Drbg)
      */
     static SeedKey generateRandom();
 
@@ -102,23 +107,99 @@ private:
     std::array<unsigned char, KEY_SIZE> _keyData; ///< Данные ключа (128 бит)
 };
 
+/**
+ * @brief Режим шифрования зашифрованного файла
+ */
+enum class CipherMode : std::uint8_t {
+    CBC = 1, ///< IV + шифротекст CBC с паддингом PKCS7, без заголовка (исходный формат)
+    CTR = 2, ///< Заголовок + начальный счётчик + шифротекст CTR той же длины, что и данные
+    Chunked = 3 ///< Заголовок + порции CTR + индекс (IV и CMAC каждой порции) + размеры
+};
+
+/**
+ * @brief Размеры зашифрованного файла с порциями (CipherMode::Chunked)
+ */
+struct ChunkedLayout {
+    std::uint32_t chunkSize = 0;  ///< Размер порции открытых данных
+    std::uint64_t plainSize = 0;  ///< Размер открытых данных
+    std::uint64_t chunkCount = 0; ///< Количество порций (не меньше одной)
+    std::uint16_t keyId = 0;      ///< ID ключа из заголовка (0 — не указан)
+};
+
+/**
+ * @brief Реализация шифрования нескольких независимых блоков
+ */
+enum class BlockKernel {
+    Scalar, ///< По одному блоку
+    AVX2    ///< По восемь блоков: S-Box через gather AVX2
+};
+
 /**
  * @class SeedCryptor
  * @brief Класс для шифрования и расшифрования данных по алгоритму SEED
  *
- * Реализует симметричное блочное шифрование SEED с режимом CBC
- * (Cipher Block Chaining) и паддингом PKCS7
+ * Реализует симметричное блочное шифрование SEED в режимах CBC
+ * (Cipher Block Chaining) с паддингом PKCS7 и CTR (счётчик).
+ *
+ * Формат файла CTR: заголовок из HEADER_SIZE байт ("SEED", версия формата,
+ * режим, ID ключа u16 LE), затем 16 байт начального значения счётчика,
+ * затем шифротекст. Файлы CBC заголовка не имеют и отличаются от CTR по
+ * его отсутствию. ID ключа задаётся при создании криптора (см. KeyManager):
+ * с нулевым ID пишется заголовок версии FORMAT_VERSION с двумя нулевыми
+ * байтами, как в файлах прежних версий, с ненулевым — версии
+ * KEYED_FORMAT_VERSION.
+ *
+ * Формат файла с порциями (Chunked): заголовок из CHUNKED_HEADER_SIZE байт
+ * (заголовок формата, размер порции u32 LE, четыре нулевых байта), затем
+ * шифротекст порций подряд, затем индекс — по CHUNK_ENTRY_SIZE байт на
+ * порцию (IV и SEED-CMAC), затем CHUNKED_TRAILER_SIZE байт (размер
+ * открытых данных и число порций, u64 LE). Каждая порция зашифрована в
+ * режиме CTR со своим IV; CMAC на отдельном ключе, выведенном из основного,
+ * вычисляется по заголовку, номеру порции, признаку последней порции, IV и
+ * шифротексту. Поэтому подмена, перестановка или отсечение порций
+ * обнаруживаются, а любую порцию можно проверить и расшифровать отдельно.
  */
 class SeedCryptor {
 public:
     /// Размер блока SEED в байтах (128 бит)
     static constexpr size_t BLOCK_SIZE = 16;
 
+    /// Размер порции потокового шифрования и расшифрования (кратен BLOCK_SIZE)
+    static constexpr size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+    /// Размер участка, обрабатываемого одной задачей при параллельной работе (кратен BLOCK_SIZE)
+    static constexpr size_t PARALLEL_RANGE_SIZE = 1 << 18;
+
+    /// Размер заголовка версионированного формата
+    static constexpr size_t HEADER_SIZE = 8;
+
+    /// Версия формата заголовка
+    static constexpr unsigned char FORMAT_VERSION = 1;
+
+    /// Версия формата заголовка с ненулевым ID ключа
+    static constexpr unsigned char KEYED_FORMAT_VERSION = 2;
+
+    /// Накладные расходы формата CTR: заголовок и начальный счётчик
+    static constexpr size_t CTR_OVERHEAD = HEADER_SIZE + BLOCK_SIZE;
+
+    /// Размер порции формата Chunked по умолчанию
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 18;
+
+    /// Размер заголовка формата Chunked
+    static constexpr size_t CHUNKED_HEADER_SIZE = 16;
+
+    /// Размер записи индекса формата Chunked: IV и CMAC порции
+    static constexpr size_t CHUNK_ENTRY_SIZE = BLOCK_SIZE * 2;
+
+    /// Размер завершающей записи формата Chunked
+    static constexpr size_t CHUNKED_TRAILER_SIZE = 16;
+
     /**
      * @brief Конструктор с ключом
      * @param key Объект SeedKey с ключом шифрования
+     * @param keyId ID ключа, записываемый в заголовок CTR и Chunked (0 — без ID)
      */
-    explicit SeedCryptor(const SeedKey& key);
+    explicit SeedCryptor(const SeedKey& key, std::uint16_t keyId = 0);
 
     /**
      * @brief Конструктор, читающий ключ из файла
@@ -132,14 +213,14 @@ public:
      * @param plaintext Исходная строка для шифрования
      * @return Строка с зашифрованными данными (IV + шифротекст)
      */
-    std::string encrypt(const std::string& plaintext);
+    std::string encrypt(const std::string& plaintext) const;
 
     /**
      * @brief Шифрует вектор байтов
      * @param plainData Исходные данные для шифрования
      * @return Строка с зашифрованными данными (IV + шифротекст)
      */
-    std::string encrypt(const std::vector<unsigned char>& plainData);
+    std::string encrypt(const std::vector<unsigned char>& plainData) const;
 
     /**
      * @brief Расшифровывает данные из вектора байтов в строку
@@ -147,7 +228,7 @@ public:
      * @return Расшифрованная строка
      * @throws std::runtime_error при ошибке расшифрования
      */
-    std::string decrypt(const std::vector<unsigned char>& cipherData);
+    std::string decrypt(const std::vector<unsigned char>& cipherData) const;
 
     /**
      * @brief Расшифровывает данные из строки в строку
@@ -155,15 +236,18 @@ public:
      * @return Расшифрованная строка
      * @throws std::runtime_error при ошибке расшифрования
      */
-    std::string decrypt(const std::string& cipherData);
+    std::string decrypt(const std::string& cipherData) const;
 
     /**
      * @brief Расшифровывает данные из вектора байтов в вектор байтов
-     * @param cipherData Зашифрованные данные (IV + шифротекст)
+     *
+     * Режим (CBC или CTR) определяется по заголовку, см. detectMode.
+     *
+     * @param cipherData Зашифрованные данные
      * @return Вектор расшифрованных байтов
      * @throws std::runtime_error при ошибке расшифрования
      */
-    std::vector<unsigned char> decryptToBytes(const std::vector<unsigned char>& cipherData);
+    std::vector<unsigned char> decryptToBytes(const std::vector<unsigned char>& cipherData) const;
 
     /**
      * @brief Расшифровывает данные из строки в вектор байтов
@@ -171,7 +255,224 @@ public:
      * @return Вектор расшифрованных байтов
      * @throws std::runtime_error при ошибке расшифрования
      */
-    std::vector<unsigned char> decryptToBytes(const std::string& cipherData);
+    std::vector<unsigned char> decryptToBytes(const std::string& cipherData) const;
+
+    /**
+     * @brief Размер зашифрованных данных для plainSize байт открытых данных
+     * @return IV + шифротекст с паддингом PKCS7
+     */
+    static constexpr size_t encryptedSize(size_t plainSize) {
+        return BLOCK_SIZE + (plainSize / BLOCK_SIZE + 1) * BLOCK_SIZE;
+    }
+
+    /**
+     * @brief Шифрует данные в буфер вызывающего без промежуточных выделений памяти
+     *
+     * Блоки шифруются прямо из plain в out. Шифротекст может занимать
+     * место открытых данных: out.data() + BLOCK_SIZE == plain.data()
+     * (см. encryptInPlace).
+     *
+     * @param plain Открытые данные
+     * @param out Буфер не меньше encryptedSize(plain.size()) байт
+     * @return Количество записанных байт (encryptedSize(plain.size()))
+     * @throws std::invalid_argument если out слишком мал
+     */
+    size_t encryptInto(std::span<const std::byte> plain, std::span<std::byte> out) const;
+
+    /**
+     * @brief Шифрует данные на месте
+     *
+     * Буфер: BLOCK_SIZE байт под IV, затем plainSize байт открытых данных,
+     * затем запас под паддинг. После вызова буфер содержит IV + шифротекст.
+     *
+     * @param buffer Буфер не меньше encryptedSize(plainSize) байт
+     * @param plainSize Размер открытых данных после IV
+     * @return Размер зашифрованных данных
+     * @throws std::invalid_argument если буфер слишком мал
+     */
+    size_t encryptInPlace(std::span<std::byte> buffer, size_t plainSize) const;
+
+    /**
+     * @brief Расшифровывает данные в буфер вызывающего без промежуточных выделений памяти
+     *
+     * Формат определяется по заголовку (detectMode): CBC, CTR или Chunked
+     * (порции проверяются по CMAC). out может начинаться в cipher не дальше
+     * cipher.data() + BLOCK_SIZE или совпадать с началом открытых данных в
+     * cipher (см. decryptInPlace).
+     *
+     * @param cipher Зашифрованные данные любого формата
+     * @param out Буфер не меньше размера открытых данных (достаточно cipher.size() байт)
+     * @return Размер открытых данных в начале out
+     * @throws std::runtime_error при неверном размере, паддинге, CMAC или чужом ID ключа
+     * @throws std::invalid_argument если out слишком мал
+     */
+    size_t decryptInto(std::span<const std::byte> cipher, std::span<std::byte> out) const;
+
+    /**
+     * @brief Расшифровывает данные на месте
+     * @param buffer Зашифрованные данные любого формата
+     * @return Открытые данные внутри buffer (сразу после IV или заголовка формата)
+     * @throws std::runtime_error как decryptInto
+     */
+    std::span<std::byte> decryptInPlace(std::span<std::byte> buffer) const;
+
+    /**
+     * @brief Шифрует поток целиком с постоянным расходом памяти
+     *
+     * Читает in порциями по STREAM_CHUNK_SIZE байт, шифрует каждую порцию
+     * через SeedStreamEncryptor и записывает в out. Паддинг PKCS7 добавляется
+     * только к последней порции. В режиме CBC результат совпадает по формату с
+     * encrypt(), в режиме CTR — с encryptCTR(); порции CTR шифруются на
+     * нескольких потоках.
+     *
+     * @param in Поток с открытыми данными (двоичный режим)
+     * @param out Поток для зашифрованных данных (двоичный режим)
+     * @param mode Режим шифрования
+     * @return Количество прочитанных байт открытых данных
+     * @throws std::runtime_error при ошибке чтения или записи
+     */
+    std::uint64_t encryptStream(std::istream& in, std::ostream& out, CipherMode mode = CipherMode::CBC) const;
+
+    /**
+     * @brief Расшифровывает поток целиком с постоянным расходом памяти
+     *
+     * Данные читаются через SeedStreamDecryptor и записываются порциями
+     * по мере расшифровки.
+     *
+     * @param in Поток с зашифрованными данными
+     * @param out Поток для расшифрованных данных
+     * @return Количество записанных байт открытых данных
+     * @throws std::runtime_error при ошибке ввода-вывода, неверном размере или паддинге.
+     * Часть данных к этому моменту может быть уже записана в out.
+     */
+    std::uint64_t decryptStream(std::istream& in, std::ostream& out) const;
+
+    /**
+     * @brief Начинаются ли данные с заголовка формата (CTR или Chunked)
+     *
+     * Формат CBC заголовка не имеет, и по содержимому его от текста не
+     * отличить надёжно (текст может быть в любой кодировке), поэтому для
+     * него возвращается false: о том, что данные зашифрованы, должен
+     * сообщить вызывающий (см. --encrypted-input).
+     *
+     * @param head Первые байты данных (не меньше HEADER_SIZE)
+     */
+    static bool hasFormatHeader(std::span<const std::byte> head);
+
+    /**
+     * @brief Определяет режим зашифрованных данных по их началу
+     * @param head Первые байты данных (не меньше HEADER_SIZE для распознавания заголовка)
+     * @return Режим из корректного заголовка, иначе CBC (исходный формат без заголовка)
+     */
+    static CipherMode detectMode(std::span<const std::byte> head);
+
+    /**
+     * @brief ID ключа, которым зашифрованы данные
+     * @param head Первые байты данных (не меньше HEADER_SIZE)
+     * @return ID из заголовка; 0 — ID не указан (в том числе для CBC)
+     */
+    static std::uint16_t keyIdOf(std::span<const std::byte> head);
+
+    /**
+     * @brief Шифрует данные в режиме CTR
+     * @param plaintext Открытые данные
+     * @return Заголовок + начальный счётчик + шифротекст (CTR_OVERHEAD + plaintext.size() байт)
+     */
+    std::string encryptCTR(const std::string& plaintext) const;
+
+    /**
+     * @brief Шифрует данные в режиме CTR в буфер вызывающего
+     * @param plain Открытые данные
+     * @param out Буфер не меньше CTR_OVERHEAD + plain.size() байт
+     * @return Количество записанных байт
+     * @throws std::invalid_argument если out слишком мал
+     */
+    size_t encryptCTRInto(std::span<const std::byte> plain, std::span<std::byte> out) const;
+
+    /**
+     * @brief Накладывает ключевой поток CTR на данные (шифрование и расшифрование совпадают)
+     *
+     * Блок ключевого потока с номером i — зашифрованное значение counter + i
+     * (128-битное сложение, big-endian). Данные размером больше двух
+     * участков PARALLEL_RANGE_SIZE обрабатываются на общем исполнителе.
+     *
+     * @param in Входные данные
+     * @param out Выходные данные того же размера (может совпадать с in)
+     * @param counter Начальное значение счётчика
+     * @param offset Смещение in от начала потока в байтах (не обязательно кратно BLOCK_SIZE)
+     */
+    void transformCTR(std::span<const std::byte> in, std::span<std::byte> out,
+                      const std::array<unsigned char, BLOCK_SIZE>& counter, std::uint64_t offset = 0) const;
+
+    /**
+     * @brief Расшифровывает произвольный диапазон открытых данных файла CTR или Chunked
+     *
+     * Читает только заголовок и нужный участок шифротекста (через seekg),
+     * поэтому время не зависит от размера файла. В формате Chunked
+     * читаются и проверяются (параллельно) только порции, покрывающие
+     * диапазон. Поток можно использовать для нескольких вызовов подряд.
+     *
+     * @param in Поток с зашифрованными данными (с поддержкой позиционирования)
+     * @param offset Смещение диапазона в открытых данных
+     * @param length Длина диапазона; обрезается по концу данных
+     * @return Открытые данные диапазона
+     * @throws std::runtime_error если формат не CTR/Chunked, при ошибке чтения
+     * или если порция не прошла проверку CMAC
+     */
+    std::vector<unsigned char> decryptRange(std::istream& in, std::uint64_t offset, size_t length) const;
+
+    /**
+     * @brief Шифрует поток в формат с порциями (CipherMode::Chunked)
+     *
+     * Порции шифруются и подписываются пачками на общем исполнителе; память —
+     * O(пачка порций + индекс), поток вывода не обязан поддерживать позиционирование.
+     *
+     * @param in Поток с открытыми данными
+     * @param out Поток для зашифрованных данных
+     * @param chunkSize Размер порции (кратен BLOCK_SIZE, не больше 2^31)
+     * @return Количество прочитанных байт открытых данных
+     * @throws std::invalid_argument при недопустимом chunkSize
+     * @throws std::runtime_error при ошибке ввода-вывода
+     */
+    std::uint64_t encryptChunked(std::istream& in, std::ostream& out, size_t chunkSize = DEFAULT_CHUNK_SIZE) const;
+
+    /**
+     * @brief Шифрует строку в формат с порциями
+     * @see encryptChunked(std::istream&, std::ostream&, size_t)
+     */
+    std::string encryptChunked(const std::string& plaintext, size_t chunkSize = DEFAULT_CHUNK_SIZE) const;
+
+    /**
+     * @brief Читает размеры файла формата Chunked
+     * @param in Поток с зашифрованными данными (с поддержкой позиционирования)
+     * @return Размер порции, размер открытых данных и число порций
+     * @throws std::runtime_error если формат не Chunked или размеры не согласованы с длиной файла
+     */
+    static ChunkedLayout readChunkedLayout(std::istream& in);
+
+    /**
+     * @brief Проверяет CMAC всех порций файла формата Chunked, не сохраняя открытые данные
+     *
+     * Порции проверяются пачками на общем исполнителе.
+     *
+     * @param in Поток с зашифрованными данными (с поддержкой позиционирования)
+     * @throws std::runtime_error с номером испорченной порции
+     */
+    void verifyChunked(std::istream& in) const;
+
+    /**
+     * @brief Ядро, которым шифруются пачки независимых блоков (CTR, расшифровка CBC)
+     *
+     * При запуске выбирается AVX2, если процессор его поддерживает, иначе Scalar.
+     */
+    static BlockKernel blockKernel();
+
+    /**
+     * @brief Выбирает ядро (для сравнения и тестов)
+     * @param kernel Желаемое ядро; AVX2 без поддержки процессором заменяется на Scalar
+     * @return Фактически выбранное ядро
+     */
+    static BlockKernel setBlockKernel(BlockKernel kernel);
 
     /**
      * @brief Возвращает текущий ключ
@@ -179,6 +480,9 @@ public:
      */
     [[nodiscard]] const SeedKey& getKey() const;
 
+    /// ID ключа, записываемый в заголовки (0 — без ID)
+    [[nodiscard]] std::uint16_t keyId() const { return _keyId; }
+
     /**
      * @brief Устанавливает новый ключ
      * @param key Новый ключ шифрования
@@ -186,8 +490,23 @@ public:
     void setKey(const SeedKey& key);
 
 private:
+    friend class SeedStreamDecryptor;
+    friend class SeedStreamEncryptor;
+
     SeedKey _key; ///< Ключ шифрования
     std::array<unsigned int, 32> _roundKeys; ///< Раундовые ключи
+    std::uint16_t _keyId = 0; ///< ID ключа для заголовков
+    /// Криптор CMAC: его раундовые ключи разворачиваются вместе с основными (у самого криптора CMAC — nullptr)
+    std::shared_ptr<const SeedCryptor> _mac;
+
+    /// Тег конструктора криптора CMAC
+    struct MacKeyTag {};
+
+    /// Криптор CMAC без собственного криптора CMAC
+    SeedCryptor(const SeedKey& key, MacKeyTag);
+
+    /// Блоков в пачке расшифровки CBC
+    static constexpr size_t CBC_BATCH_BLOCKS = 64;
 
     /**
      * @brief Генерирует раундовые ключи из основного ключа
@@ -196,38 +515,291 @@ private:
 
     /**
      * @brief Шифрует один 128-битный блок
-     * @param block Массив из 16 байт для шифрования (модифицируется на месте)
+     * @param block 16 байт для шифрования (модифицируются на месте)
      */
-    void encryptBlock(std::array<unsigned char, BLOCK_SIZE>& block);
+    void encryptBlock(unsigned char* block) const;
 
     /**
      * @brief Расшифровывает один 128-битный блок
-     * @param block Массив из 16 байт для расшифрования (модифицируется на месте)
+     * @param block 16 байт для расшифрования (модифицируются на месте)
+     */
+    void decryptBlock(unsigned char* block) const;
+
+    /**
+     * @brief Шифрует в режиме CBC участок, кратный BLOCK_SIZE
+     *
+     * out может совпадать с in или начинаться раньше него: каждый блок
+     * читается до того, как записывается.
+     *
+     * @param in Открытые данные
+     * @param out Буфер для шифротекста
+     * @param size Размер в байтах (кратен BLOCK_SIZE)
+     * @param chain Предыдущий блок шифротекста (или IV); заменяется последним блоком участка
+     */
+    void encryptCBC(const unsigned char* in, unsigned char* out, size_t size,
+                    std::array<unsigned char, BLOCK_SIZE>& chain) const;
+
+    /**
+     * @brief Расшифровывает в режиме CBC участок, кратный BLOCK_SIZE
+     *
+     * out может совпадать с in или начинаться раньше него.
+     *
+     * @param in Шифротекст
+     * @param out Буфер для открытых данных
+     * @param size Размер в байтах (кратен BLOCK_SIZE)
+     * @param chain Предыдущий блок шифротекста (или IV); заменяется последним блоком участка
+     */
+    void decryptCBC(const unsigned char* in, unsigned char* out, size_t size,
+                    std::array<unsigned char, BLOCK_SIZE>& chain) const;
+
+    /**
+     * @brief Расшифровывает в режиме CBC участок, кратный BLOCK_SIZE, на нескольких потоках
+     *
+     * Каждый блок открытых данных зависит только от своего и предыдущего
+     * блока шифротекста, поэтому шифротекст делится на участки по
+     * PARALLEL_RANGE_SIZE байт, которые расшифровываются независимо на общем
+     * исполнителе; блоки на границах участков запоминаются до запуска задач.
+     * Если данных меньше двух участков, исполнитель однопоточный или out
+     * перекрывает in со сдвигом, выполняется decryptCBC.
+     *
+     * @param in Шифротекст
+     * @param out Буфер для открытых данных (совпадает с in или не перекрывает его)
+     * @param size Размер в байтах (кратен BLOCK_SIZE)
+     * @param chain Предыдущий блок шифротекста (или IV); заменяется последним блоком участка
+     */
+    void decryptCBCParallel(const unsigned char* in, unsigned char* out, size_t size,
+                            std::array<unsigned char, BLOCK_SIZE>& chain) const;
+
+    /**
+     * @brief Накладывает ключевой поток CTR на участок в одном потоке
+     * @see transformCTR
+     */
+    void transformCTRSerial(const unsigned char* in, unsigned char* out, size_t size,
+                            const std::array<unsigned char, BLOCK_SIZE>& counter, std::uint64_t offset) const;
+
+    /**
+     * @brief Шифрует count блоков подряд на месте
+     * @param blocks count * BLOCK_SIZE байт
+     * @param count Количество блоков
+     */
+    void encryptBlocks(unsigned char* blocks, size_t count) const;
+
+    /**
+     * @brief Расшифровывает count блоков подряд на месте
+     * @param blocks count * BLOCK_SIZE байт
+     * @param count Количество блоков
      */
-    void decryptBlock(std::array<unsigned char, BLOCK_SIZE>& block);
+    void decryptBlocks(unsigned char* blocks, size_t count) const;
+
+    /// Расшифровывает диапазон открытых данных файла Chunked (см. decryptRange)
+    std::vector<unsigned char> decryptRangeChunked(std::istream& in, std::uint64_t offset, size_t length) const;
 
     /**
-     * @brief Добавляет PKCS7 паддинг к данным
-     * @param data Данные для дополнения
+     * @brief Вычисляет SEED-CMAC (RFC 4493) сообщения head || body
+     * @param head Начало сообщения (размер кратен BLOCK_SIZE и больше нуля)
+     * @param headSize Размер head
+     * @param body Остаток сообщения
+     * @param bodySize Размер body
      */
-    void addPadding(std::vector<unsigned char>& data);
+    std::array<unsigned char, BLOCK_SIZE> cmac(const unsigned char* head, size_t headSize,
+                                               const unsigned char* body, size_t bodySize) const;
+
+    /// Разворачивает криптор CMAC с ключом, выведенным из основного
+    void deriveMacCryptor();
+
+    /// Криптор CMAC (создан вместе с криптором, не пересчитывается)
+    [[nodiscard]] const SeedCryptor& macCryptor() const;
 
     /**
-     * @brief Удаляет PKCS7 паддинг из данных
+     * @brief Проверяет и расшифровывает на месте порции [first, first + count) формата Chunked
+     *
+     * Порции обрабатываются параллельно на общем исполнителе.
+     *
+     * @param mac Криптор CMAC (см. macCryptor)
+     * @param layout Размеры файла
+     * @param first Номер первой порции
+     * @param count Количество порций
+     * @param entries Записи индекса этих порций
+     * @param data Шифротекст этих порций подряд
+     * @param decrypt Расшифровать (иначе только проверить)
+     * @throws std::runtime_error если порция не прошла проверку
+     */
+    void openChunks(const SeedCryptor& mac, const ChunkedLayout& layout, std::uint64_t first, size_t count, const unsigned char* entries, unsigned char* data,
+                    bool decrypt) const;
+
+    /**
+     * @brief Размеры файла формата Chunked по его заголовку и концевику
+     * @param header CHUNKED_HEADER_SIZE байт начала файла
+     * @param trailer CHUNKED_TRAILER_SIZE байт конца файла
+     * @param fileSize Размер файла
+     * @throws std::runtime_error как readChunkedLayout
+     */
+    static ChunkedLayout chunkedLayout(const unsigned char* header, const unsigned char* trailer, std::uint64_t fileSize);
+
+    /// Записывает заголовок формата для режима mode с ID ключа keyId
+    static void writeHeader(unsigned char* out, CipherMode mode, std::uint16_t keyId);
+
+    /**
+     * @brief Проверяет, что данные с ID ключа keyId можно расшифровать этим криптором
+     * @throws std::runtime_error если ID указан и отличается от ID криптора
+     */
+    void checkKeyId(std::uint16_t keyId) const;
+
+    /**
+     * @brief Проверяет PKCS7 паддинг и возвращает размер данных без него
      * @param data Данные с паддингом
+     * @param size Размер данных
      * @throws std::runtime_error при неверном паддинге
      */
-    void removePadding(std::vector<unsigned char>& data);
+    static size_t unpaddedSize(const unsigned char* data, size_t size);
 
     /**
      * @brief Генерирует случайный вектор инициализации (IV)
-     * @return Массив из BLOCK_SIZE случайных байт
+     * @return Массив из BLOCK_SIZE случайных байт (из Drbg)
      */
-    std::array<unsigned char, BLOCK_SIZE> generateIV();
+    static std::array<unsigned char, BLOCK_SIZE> generateIV();
 
     // Вспомогательные функции алгоритма SEED
     static unsigned int G(unsigned int x);
     static unsigned int F(unsigned int Ki0, unsigned int Ki1, unsigned int R0, unsigned int R1);
 };
 
+/**
+ * @class SeedStreamDecryptor
+ * @brief Расшифровка потока по запросу: каждый вызов выдаёт следующие открытые данные
+ *
+ * Режим определяется по заголовку (см. SeedCryptor::detectMode). Данные
+ * читаются и расшифровываются порциями по SeedCryptor::STREAM_CHUNK_SIZE
+ * (в формате Chunked — пачками порций, каждая проверяется по CMAC до
+ * выдачи), поэтому память не зависит от размера файла. В режиме CBC
+ * последний блок удерживается до конца потока, чтобы снять паддинг PKCS7.
+ * Для формата Chunked поток должен поддерживать позиционирование (индекс
+ * в конце файла).
+ *
+ * Используется там, где потребитель сам забирает данные: например, как
+ * источник байтов потоковой загрузки датасета.
+ */
+class SeedStreamDecryptor {
+public:
+    /**
+     * @brief Читает заголовок и подготавливает расшифровку
+     * @param cryptor Криптор с ключом (должен жить дольше расшифровщика)
+     * @param in Поток с зашифрованными данными (двоичный режим)
+     * @throws std::runtime_error если данные слишком короткие или формат не согласован
+     */
+    SeedStreamDecryptor(const SeedCryptor& cryptor, std::istream& in);
+
+    /**
+     * @brief Следующая расшифрованная порция без копирования
+     * @return Открытые данные (действительны до следующего вызова); пусто — конец данных
+     * @throws std::runtime_error при ошибке чтения, неверном размере, паддинге или CMAC
+     */
+    std::span<const unsigned char> next();
+
+    /**
+     * @brief Записывает в out до size следующих байт открытых данных
+     *
+     * CTR и целые порции Chunked расшифровываются прямо в out, без
+     * промежуточного буфера; CBC и порции, не помещающиеся в out,
+     * расшифровываются во внутренний буфер и копируются.
+     *
+     * @return Количество записанных байт; 0 — конец данных
+     * @throws std::runtime_error как next()
+     */
+    size_t read(unsigned char* out, size_t size);
+
+    /// Режим зашифрованных данных
+    [[nodiscard]] CipherMode mode() const { return _mode; }
+
+private:
+    /// Расшифровывает следующую порцию в _output
+    void refill();
+
+    /// Расшифровывает следующую порцию прямо в out; 0 — не помещается или режим CBC
+    size_t readDirect(unsigned char* out, size_t size);
+
+    const SeedCryptor& _cryptor;
+    std::istream& _in;
+    CipherMode _mode;
+    std::array<unsigned char, SeedCryptor::BLOCK_SIZE> _chain{}; ///< CBC: предыдущий блок шифротекста; CTR: начальный счётчик
+    std::vector<unsigned char> _input;  ///< CBC: шифротекст, удержанный с прошлой порции, и новая порция
+    size_t _held = 0;                   ///< CBC: удержанных байт в начале _input
+    std::uint64_t _offset = 0;          ///< CTR: смещение следующей порции в открытых данных
+    ChunkedLayout _layout;              ///< Chunked: размеры файла
+    std::uint64_t _nextChunk = 0;       ///< Chunked: номер следующей порции
+    const SeedCryptor* _mac = nullptr; ///< Chunked: криптор CMAC (принадлежит криптору)
+    std::vector<unsigned char> _entries; ///< Chunked: записи индекса текущей пачки
+    std::vector<unsigned char> _output; ///< Расшифрованная порция
+    size_t _position = 0;               ///< Выдано байт из _output
+    bool _finished = false;             ///< Последняя порция расшифрована
+};
+
+/**
+ * @class SeedStreamEncryptor
+ * @brief Шифрование по мере поступления данных: каждый вызов возвращает готовый шифротекст
+ *
+ * Обратная сторона SeedStreamDecryptor для случаев, когда данные
+ * производятся порциями (строки прогноза), а не читаются из потока.
+ * Шифруются только те байты, формат которых уже определён: в режиме CBC
+ * удерживается хвост короче блока (паддинг добавляет finish()), в формате
+ * Chunked — последняя порция (признак последней порции входит в её CMAC),
+ * в режиме CTR данные шифруются сразу. Поэтому память ограничена одной
+ * порцией и индексом, а не размером данных. Результат совпадает по формату
+ * с SeedCryptor::encryptStream и расшифровывается любым способом.
+ *
+ * Шифровщики независимы: несколько шифровщиков с общим криптором можно
+ * использовать из разных потоков одновременно.
+ */
+class SeedStreamEncryptor {
+public:
+    /**
+     * @param cryptor Криптор с ключом (должен жить дольше шифровщика)
+     * @param mode Режим шифрования
+     * @param chunkSize Размер порции формата Chunked (кратен BLOCK_SIZE, не больше 2^31)
+     * @throws std::invalid_argument при недопустимом chunkSize
+     */
+    explicit SeedStreamEncryptor(const SeedCryptor& cryptor, CipherMode mode = CipherMode::Chunked,
+                                 size_t chunkSize = SeedCryptor::DEFAULT_CHUNK_SIZE);
+
+    /**
+     * @brief Шифрует очередные открытые данные
+     * @return Готовый шифротекст (действителен до следующего вызова); может быть пустым
+     * @throws std::logic_error после finish()
+     */
+    std::span<const unsigned char> update(std::span<const unsigned char> plain);
+
+    /**
+     * @brief Завершает шифрование: удержанный хвост, паддинг или индекс порций
+     * @return Остаток шифротекста (действителен до уничтожения шифровщика)
+     * @throws std::logic_error при повторном вызове
+     */
+    std::span<const unsigned char> finish();
+
+    /// Принято байт открытых данных
+    [[nodiscard]] std::uint64_t plainSize() const { return _total; }
+
+    /// Режим шифрования
+    [[nodiscard]] CipherMode mode() const { return _mode; }
+
+private:
+    /// Дописывает в _output заголовок и IV перед первым шифротекстом
+    void start();
+
+    /// Шифрует и подписывает в _output первые count порций _pending; last — последняя из них завершает данные
+    void sealChunks(size_t count, bool last);
+
+    const SeedCryptor& _cryptor;
+    CipherMode _mode;
+    size_t _chunkSize;
+    std::array<unsigned char, SeedCryptor::BLOCK_SIZE> _chain{}; ///< CBC: предыдущий блок шифротекста; CTR: начальный счётчик
+    const SeedCryptor* _mac = nullptr; ///< Chunked: криптор CMAC (принадлежит криптору)
+    std::vector<unsigned char> _pending; ///< Удержанные открытые данные
+    std::vector<unsigned char> _index;  ///< Chunked: IV и CMAC записанных порций
+    std::vector<unsigned char> _output; ///< Шифротекст последнего вызова
+    std::uint64_t _total = 0;           ///< Принято байт открытых данных
+    std::uint64_t _nextChunk = 0;       ///< Chunked: номер следующей порции
+    bool _started = false;              ///< Заголовок уже выдан
+    bool _finished = false;             ///< finish() уже вызван
+};
+
 #endif
\ No newline at end of file
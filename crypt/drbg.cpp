@@ -0,0 +1,181 @@
+/**
+ * @file drbg.cpp
+ * @brief Реализация генератора случайных байт на ChaCha20
+ */
+
+#include "drbg.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <pthread.h>
+#include <sys/random.h>
+#else
+#include <random>
+#endif
+
+namespace {
+    constexpr size_t CHACHA_BLOCK_SIZE = 64;
+    constexpr size_t KEY_BYTES = 32;
+    static_assert(Drbg::REFILL_SIZE % CHACHA_BLOCK_SIZE == 0 && Drbg::REFILL_SIZE > KEY_BYTES);
+
+    /// Поколение состояний: меняется в дочернем процессе после fork()
+    std::atomic<std::uint64_t> generation{1};
+
+#ifdef __linux__
+    /// Регистрируется при загрузке: после fork() дочерний процесс засевает состояния заново
+    [[maybe_unused]] const int forkHandler = pthread_atfork(nullptr, nullptr, [] {
+        generation.fetch_add(1, std::memory_order_relaxed);
+    });
+#endif
+
+    /**
+     * @brief Состояние генератора одного потока
+     */
+    struct ThreadState {
+        std::array<std::uint32_t, 8> key{};
+        std::uint64_t generation = 0; ///< 0 — ещё не засеяно
+        std::array<unsigned char, Drbg::REFILL_SIZE> buffer{};
+        size_t available = 0;         ///< Невыданных байт в конце buffer
+    };
+
+    thread_local ThreadState state;
+
+    std::uint32_t loadLE32(const unsigned char* data) {
+        return static_cast<std::uint32_t>(data[0]) | static_cast<std::uint32_t>(data[1]) << 8 |
+               static_cast<std::uint32_t>(data[2]) << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+    }
+
+    std::uint32_t rotl(const std::uint32_t x, const int n) {
+        return x << n | x >> (32 - n);
+    }
+
+    void quarterRound(std::array<std::uint32_t, 16>& x, const size_t a, const size_t b, const size_t c, const size_t d) {
+        x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+        x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+        x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+        x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+    }
+
+    /**
+     * @brief Затирает память так, чтобы компилятор не убрал запись
+     */
+    void wipe(void* data, const size_t size) {
+        volatile auto* bytes = static_cast<volatile unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Энтропия операционной системы
+     * @throws std::runtime_error если getrandom() завершился ошибкой
+     */
+    void systemEntropy(unsigned char* out, size_t size) {
+#ifdef __linux__
+        while (size > 0) {
+            const ssize_t got = getrandom(out, size, 0);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Не удалось получить энтропию от системы (getrandom)");
+            }
+            out += got;
+            size -= static_cast<size_t>(got);
+        }
+#else
+        std::random_device device;
+        for (size_t i = 0; i < size; i += sizeof(unsigned int)) {
+            const unsigned int word = device();
+            std::memcpy(out + i, &word, std::min(sizeof(word), size - i));
+        }
+#endif
+    }
+
+    void seed(ThreadState& s) {
+        std::array<unsigned char, KEY_BYTES> entropy;
+        systemEntropy(entropy.data(), entropy.size());
+        for (size_t i = 0; i < s.key.size(); ++i) {
+            s.key[i] = loadLE32(entropy.data() + i * 4);
+        }
+        wipe(entropy.data(), entropy.size());
+        wipe(s.buffer.data(), s.buffer.size());
+        s.available = 0;
+        s.generation = generation.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Вырабатывает пачку байт: начало пачки — новый ключ, остальное — на выдачу
+     */
+    void refill(ThreadState& s) {
+        constexpr std::array<std::uint32_t, 3> nonce{};
+        for (size_t block = 0; block < Drbg::REFILL_SIZE / CHACHA_BLOCK_SIZE; ++block) {
+            Drbg::chacha20Block(s.key, static_cast<std::uint32_t>(block), nonce,
+                                s.buffer.data() + block * CHACHA_BLOCK_SIZE);
+        }
+        for (size_t i = 0; i < s.key.size(); ++i) {
+            s.key[i] = loadLE32(s.buffer.data() + i * 4);
+        }
+        wipe(s.buffer.data(), KEY_BYTES);
+        s.available = Drbg::REFILL_SIZE - KEY_BYTES;
+    }
+}
+
+void Drbg::chacha20Block(const std::array<std::uint32_t, 8>& key, const std::uint32_t counter,
+                         const std::array<std::uint32_t, 3>& nonce, unsigned char* out) {
+    // "expand 32-byte k"
+    std::array<std::uint32_t, 16> input = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    std::copy(key.begin(), key.end(), input.begin() + 4);
+    input[12] = counter;
+    std::copy(nonce.begin(), nonce.end(), input.begin() + 13);
+
+    auto x = input;
+    for (int round = 0; round < 10; ++round) {
+        quarterRound(x, 0, 4, 8, 12);
+        quarterRound(x, 1, 5, 9, 13);
+        quarterRound(x, 2, 6, 10, 14);
+        quarterRound(x, 3, 7, 11, 15);
+        quarterRound(x, 0, 5, 10, 15);
+        quarterRound(x, 1, 6, 11, 12);
+        quarterRound(x, 2, 7, 8, 13);
+        quarterRound(x, 3, 4, 9, 14);
+    }
+    for (size_t i = 0; i < 16; ++i) {
+        const std::uint32_t word = x[i] + input[i];
+        out[i * 4] = static_cast<unsigned char>(word);
+        out[i * 4 + 1] = static_cast<unsigned char>(word >> 8);
+        out[i * 4 + 2] = static_cast<unsigned char>(word >> 16);
+        out[i * 4 + 3] = static_cast<unsigned char>(word >> 24);
+    }
+}
+
+void Drbg::fill(unsigned char* out, size_t size) {
+    ThreadState& s = state;
+    if (s.generation != generation.load(std::memory_order_relaxed)) {
+        seed(s);
+    }
+    while (size > 0) {
+        if (s.available == 0) {
+            refill(s);
+        }
+        const size_t count = std::min(size, s.available);
+        unsigned char* ready = s.buffer.data() + (s.buffer.size() - s.available);
+        std::memcpy(out, ready, count);
+        wipe(ready, count);
+        s.available -= count;
+        out += count;
+        size -= count;
+    }
+}
+
+void Drbg::fill(const std::span<std::byte> out) {
+    fill(reinterpret_cast<unsigned char*>(out.data()), out.size());
+}
+
+void Drbg::reseed() {
+    seed(state);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file drbg.h
+ * @brief Криптографический генератор случайных байт (DRBG на ChaCha20)
+ *
+ * Источник IV и ключей модуля шифрования вместо std::random_device и
+ * std::mt19937
+ */
+
+#ifndef TRAFFIC_FORECAST_DRBG_H
+#define TRAFFIC_FORECAST_DRBG_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @class Drbg
+ * @brief Генератор случайных байт на потоке ChaCha20 с быстрым стиранием ключа
+ *
+ * У каждого потока своё состояние: ключ ChaCha20 и буфер готовых байт,
+ * поэтому генерация не требует блокировок. Ключ потока один раз берётся
+ * из getrandom() при первом обращении, дальше байты вырабатываются
+ * пачками по REFILL_SIZE: первые 32 байта каждой пачки становятся
+ * следующим ключом, остальные выдаются и стираются из буфера по мере
+ * выдачи. Поэтому перехват состояния не раскрывает уже выданные байты.
+ *
+ * После fork() дочерний процесс получает копию состояния родителя;
+ * чтобы процессы не выдавали одинаковые байты, в дочернем процессе
+ * состояние каждого потока засевается заново при следующем обращении.
+ */
+class Drbg {
+public:
+    /// Байт, вырабатываемых за одно пополнение буфера потока
+    static constexpr size_t REFILL_SIZE = 1024;
+
+    /**
+     * @brief Заполняет out случайными байтами
+     * @throws std::runtime_error если система не выдала энтропию для засева
+     */
+    static void fill(unsigned char* out, size_t size);
+
+    /**
+     * @brief Заполняет out случайными байтами
+     * @see fill(unsigned char*, size_t)
+     */
+    static void fill(std::span<std::byte> out);
+
+    /**
+     * @brief Возвращает N случайных байт
+     */
+    template <size_t N>
+    static std::array<unsigned char, N> bytes() {
+        std::array<unsigned char, N> result;
+        fill(result.data(), N);
+        return result;
+    }
+
+    /**
+     * @brief Засевает состояние текущего потока заново из getrandom()
+     */
+    static void reseed();
+
+    /**
+     * @brief Блочная функция ChaCha20 (RFC 8439, раздел 2.3)
+     *
+     * Открыта для проверки по тестовым векторам.
+     *
+     * @param key Ключ (8 слов little-endian)
+     * @param counter Счётчик блока
+     * @param nonce Nonce (3 слова little-endian)
+     * @param out 64 байта ключевого потока
+     */
+    static void chacha20Block(const std::array<std::uint32_t, 8>& key, std::uint32_t counter,
+                              const std::array<std::uint32_t, 3>& nonce, unsigned char* out);
+};
+
+#endif
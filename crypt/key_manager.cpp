@@ -0,0 +1,136 @@
+/**
+ * @file key_manager.cpp
+ * @brief Реализация связки ключей SEED
+ */
+
+#include "key_manager.h"
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+    int hexDigit(const char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /**
+     * @brief Разбирает строку связки ключей "<id> <ключ>"
+     * @return false, если строка некорректна
+     */
+    bool parseKeyLine(const std::string& line, KeyManager::KeyId& id, SeedKey& key) {
+        size_t pos = line.find_first_not_of(" \t");
+        const size_t idEnd = line.find_first_of(" \t", pos);
+        if (idEnd == std::string::npos || idEnd == pos) {
+            return false;
+        }
+        unsigned long value = 0;
+        for (size_t i = pos; i < idEnd; ++i) {
+            if (line[i] < '0' || line[i] > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<unsigned long>(line[i] - '0');
+            if (value > 0xFFFF) {
+                return false;
+            }
+        }
+        id = static_cast<KeyManager::KeyId>(value);
+
+        pos = line.find_first_not_of(" \t", idEnd);
+        const size_t end = line.find_last_not_of(" \t\r");
+        if (pos == std::string::npos || end + 1 - pos != SeedKey::KEY_SIZE * 2) {
+            return false;
+        }
+        std::array<unsigned char, SeedKey::KEY_SIZE> data;
+        for (size_t i = 0; i < SeedKey::KEY_SIZE; ++i) {
+            const int high = hexDigit(line[pos + i * 2]);
+            const int low = hexDigit(line[pos + i * 2 + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            data[i] = static_cast<unsigned char>(high << 4 | low);
+        }
+        key = SeedKey(data);
+        return true;
+    }
+}
+
+void KeyManager::loadKeyring(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Не удалось открыть файл ключей " + path);
+    }
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); ++number) {
+        const size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        KeyId id = 0;
+        SeedKey key;
+        if (!parseKeyLine(line, id, key)) {
+            throw std::runtime_error(path + ":" + std::to_string(number) + ": ожидается \"<id> <ключ из 32 hex-цифр>\"");
+        }
+        try {
+            addKey(id, key);
+        } catch (const std::invalid_argument& e) {
+            throw std::runtime_error(path + ":" + std::to_string(number) + ": " + e.what());
+        }
+    }
+    if (file.bad()) {
+        throw std::runtime_error("Ошибка чтения файла ключей " + path);
+    }
+}
+
+void KeyManager::addKey(const KeyId id, const SeedKey& key) {
+    std::unique_lock guard(_lock);
+    if (!_keys.emplace(id, key).second) {
+        throw std::invalid_argument("Повторяется ключ с ID " + std::to_string(id));
+    }
+}
+
+bool KeyManager::contains(const KeyId id) const {
+    std::shared_lock guard(_lock);
+    return _keys.contains(id);
+}
+
+size_t KeyManager::size() const {
+    std::shared_lock guard(_lock);
+    return _keys.size();
+}
+
+size_t KeyManager::expanded() const {
+    std::shared_lock guard(_lock);
+    return _cryptors.size();
+}
+
+/**
+ * Обычный путь — поиск под разделяемой блокировкой. Промах берёт
+ * исключительную блокировку и проверяет кэш повторно: другой поток мог
+ * успеть создать криптор, и расписание разворачивается ровно один раз.
+ */
+std::shared_ptr<const SeedCryptor> KeyManager::cryptor(const KeyId id) const {
+    {
+        std::shared_lock guard(_lock);
+        if (const auto found = _cryptors.find(id); found != _cryptors.end()) {
+            return found->second;
+        }
+    }
+    std::unique_lock guard(_lock);
+    if (const auto found = _cryptors.find(id); found != _cryptors.end()) {
+        return found->second;
+    }
+    const auto key = _keys.find(id);
+    if (key == _keys.end()) {
+        throw std::runtime_error("Нет ключа с ID " + std::to_string(id));
+    }
+    auto created = std::make_shared<const SeedCryptor>(key->second, id);
+    _cryptors.emplace(id, created);
+    return created;
+}
+
+std::shared_ptr<const SeedCryptor> KeyManager::cryptorFor(const std::span<const std::byte> head) const {
+    return cryptor(SeedCryptor::keyIdOf(head));
+}
@@ -0,0 +1,93 @@
+/**
+ * @file key_manager.h
+ * @brief Связка ключей SEED с кэшем развёрнутых раундовых ключей
+ */
+
+#ifndef TRAFFIC_FORECAST_KEY_MANAGER_H
+#define TRAFFIC_FORECAST_KEY_MANAGER_H
+
+#include "crypt.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class KeyManager
+ * @brief Ключи по ID и готовые крипторы для них
+ *
+ * Ключи загружаются один раз (файл связки ключей или отдельные ключи),
+ * а криптор с развёрнутыми расписаниями раундовых ключей (основного и
+ * ключа CMAC формата с порциями) создаётся при первом обращении к ID и
+ * дальше берётся из кэша. Поиск в кэше идёт
+ * под разделяемой блокировкой, поэтому множество потоков (например,
+ * обработка разных сайтов со своими ключами) получают крипторы
+ * параллельно, без повторного разворачивания ключа и чтения файлов.
+ *
+ * Крипторы неизменяемы и потокобезопасны: один криптор можно использовать
+ * из нескольких потоков. ID криптора записывается в заголовки CTR и
+ * Chunked, а при расшифровке ключ выбирается по ID из заголовка
+ * (cryptorFor). Ключ DEFAULT_KEY_ID используется для данных без ID:
+ * формат CBC и файлы, зашифрованные одним ключом (--crypt).
+ */
+class KeyManager {
+public:
+    using KeyId = std::uint16_t;
+
+    /// ID ключа для данных без ID в заголовке
+    static constexpr KeyId DEFAULT_KEY_ID = 0;
+
+    KeyManager() = default;
+
+    KeyManager(const KeyManager&) = delete;
+    KeyManager& operator=(const KeyManager&) = delete;
+
+    /**
+     * @brief Загружает файл связки ключей
+     *
+     * Каждая непустая строка, кроме комментариев (#), — "<id> <ключ>":
+     * ID от 0 до 65535 и ключ из 32 шестнадцатеричных цифр.
+     *
+     * @param path Путь к файлу
+     * @throws std::runtime_error если файл не читается, строка некорректна или ID повторяется
+     */
+    void loadKeyring(const std::string& path);
+
+    /**
+     * @brief Добавляет ключ
+     * @throws std::invalid_argument если ключ с таким ID уже есть
+     */
+    void addKey(KeyId id, const SeedKey& key);
+
+    /// Есть ли ключ с ID id
+    [[nodiscard]] bool contains(KeyId id) const;
+
+    /// Количество ключей
+    [[nodiscard]] size_t size() const;
+
+    /// Количество развёрнутых расписаний ключей (крипторов в кэше)
+    [[nodiscard]] size_t expanded() const;
+
+    /**
+     * @brief Криптор ключа id (создаётся при первом обращении)
+     * @throws std::runtime_error если ключа с таким ID нет
+     */
+    [[nodiscard]] std::shared_ptr<const SeedCryptor> cryptor(KeyId id) const;
+
+    /**
+     * @brief Криптор для расшифровки данных по ID ключа из их заголовка
+     * @param head Первые байты данных (не меньше SeedCryptor::HEADER_SIZE)
+     * @throws std::runtime_error если ключа с таким ID нет
+     */
+    [[nodiscard]] std::shared_ptr<const SeedCryptor> cryptorFor(std::span<const std::byte> head) const;
+
+private:
+    mutable std::shared_mutex _lock;
+    std::unordered_map<KeyId, SeedKey> _keys;
+    mutable std::unordered_map<KeyId, std::shared_ptr<const SeedCryptor>> _cryptors;
+};
+
+#endif
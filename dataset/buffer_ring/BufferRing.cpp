@@ -0,0 +1,61 @@
+#include "BufferRing.h"
+
+#include <algorithm>
+
+BufferRing::BufferRing(const size_t bufferCount, const size_t bufferSize)
+    : size(max<size_t>(bufferSize, 1)),
+      buffers(max<size_t>(bufferCount, 2), vector<char>(size)),
+      lengths(buffers.size(), 0) {}
+
+/**
+ * Буфер writeIndex свободен, пока опубликованных буферов меньше, чем всего в кольце.
+ */
+span<char> BufferRing::acquireWrite() {
+    unique_lock guard(lock);
+    canWrite.wait(guard, [this] { return cancelled || filled < buffers.size(); });
+    if (cancelled) return {};
+    return buffers[writeIndex];
+}
+
+void BufferRing::commitWrite(const size_t bytes) {
+    {
+        lock_guard guard(lock);
+        lengths[writeIndex] = min(bytes, size);
+        writeIndex = (writeIndex + 1) % buffers.size();
+        ++filled;
+    }
+    canRead.notify_one();
+}
+
+void BufferRing::close() {
+    {
+        lock_guard guard(lock);
+        closed = true;
+    }
+    canRead.notify_one();
+}
+
+string_view BufferRing::acquireRead() {
+    unique_lock guard(lock);
+    canRead.wait(guard, [this] { return cancelled || filled > 0 || closed; });
+    if (cancelled || filled == 0) return {};
+    return {buffers[readIndex].data(), lengths[readIndex]};
+}
+
+void BufferRing::releaseRead() {
+    {
+        lock_guard guard(lock);
+        readIndex = (readIndex + 1) % buffers.size();
+        --filled;
+    }
+    canWrite.notify_one();
+}
+
+void BufferRing::cancel() {
+    {
+        lock_guard guard(lock);
+        cancelled = true;
+    }
+    canWrite.notify_all();
+    canRead.notify_all();
+}
@@ -0,0 +1,91 @@
+#ifndef TRAFFIC_FORECAST_BUFFER_RING_H
+#define TRAFFIC_FORECAST_BUFFER_RING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Кольцо буферов фиксированного размера между одним производителем и одним потребителем.
+ *
+ * Все буферы выделяются в конструкторе, поэтому объём памяти не зависит
+ * от объёма проходящих данных. Производитель (например, поток чтения из
+ * stdin) заполняет свободный буфер и публикует его, потребитель (разбор
+ * CSV) обрабатывает буферы в том же порядке и возвращает их в кольцо.
+ * Если все буферы заняты, производитель ждёт; если заполненных нет —
+ * ждёт потребитель.
+ */
+class BufferRing {
+public:
+    /// Размер буфера по умолчанию
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+    /// Количество буферов по умолчанию
+    static constexpr size_t DEFAULT_BUFFER_COUNT = 4;
+
+    /**
+     * @param bufferCount Количество буферов (не меньше 2).
+     * @param bufferSize Размер каждого буфера в байтах.
+     */
+    explicit BufferRing(size_t bufferCount = DEFAULT_BUFFER_COUNT, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+    BufferRing(const BufferRing &) = delete;
+    BufferRing &operator=(const BufferRing &) = delete;
+
+    /**
+     * @brief Получить свободный буфер для записи (блокируется, пока его нет).
+     * @return Буфер полного размера; пустой, если потребитель прекратил чтение (cancel).
+     */
+    span<char> acquireWrite();
+
+    /**
+     * @brief Опубликовать буфер, полученный acquireWrite.
+     * @param bytes Сколько байт в начале буфера заполнено.
+     */
+    void commitWrite(size_t bytes);
+
+    /**
+     * @brief Данных больше не будет (конец потока).
+     */
+    void close();
+
+    /**
+     * @brief Получить следующий заполненный буфер (блокируется, пока его нет).
+     * @return Данные буфера; пустое представление — поток закончен.
+     */
+    string_view acquireRead();
+
+    /**
+     * @brief Вернуть буфер, полученный acquireRead, в кольцо.
+     */
+    void releaseRead();
+
+    /**
+     * @brief Прекратить обмен: ожидающий производитель получит пустой буфер.
+     */
+    void cancel();
+
+    /**
+     * @brief Размер одного буфера.
+     */
+    [[nodiscard]] size_t bufferSize() const { return size; }
+
+private:
+    size_t size;
+    vector<vector<char>> buffers;
+    vector<size_t> lengths;
+    size_t writeIndex = 0;   ///< Следующий буфер для записи
+    size_t readIndex = 0;    ///< Следующий буфер для чтения
+    size_t filled = 0;       ///< Опубликовано и ещё не возвращено буферов
+    bool closed = false;
+    bool cancelled = false;
+    mutex lock;
+    condition_variable canWrite;
+    condition_variable canRead;
+};
+
+#endif
@@ -1,7 +1,20 @@
 #include "Dataset.h"
+#include "DatasetSnapshot.h"
+#include "executor.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <queue>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <tuple>
+
+#include <cerrno>
+#include <unistd.h>
 using namespace std;
 
 /**
@@ -42,6 +55,188 @@ void Dataset::setRows(vector<DatasetValue> r) {
     rows = std::move(r);
 }
 
+namespace {
+    /// Размер порции, которой читается CSV-файл.
+    constexpr size_t CSV_READ_CHUNK = 1 << 20;
+    /// Количество полей в строке CSV: row,day,dayOfWeek,date и четыре метрики.
+    constexpr size_t CSV_FIELD_COUNT = 8;
+    /// Номер поля CSV с датой.
+    constexpr size_t CSV_DATE_FIELD = 3;
+
+    /// Столбец набора данных для каждого поля CSV (поле 0 — номер строки — не хранится).
+    constexpr array<DatasetColumn, CSV_FIELD_COUNT> CSV_FIELD_COLUMNS = {
+        DatasetColumn::Day, DatasetColumn::Day, DatasetColumn::DayOfWeek, DatasetColumn::Date,
+        DatasetColumn::PageLoads, DatasetColumn::UniqueVisitors,
+        DatasetColumn::FirstTimeVisitors, DatasetColumn::ReturningVisitors
+    };
+
+    /**
+     * Результат разбора одной строки CSV.
+     */
+    enum class RowParseResult {
+        Added,     ///< Запись добавлена
+        Filtered,  ///< Строка корректна, но её дата вне диапазона
+        Invalid    ///< В строке не хватает полей, нужная дата или число некорректны
+    };
+
+    /**
+     * Разбор строк CSV с учётом CSVLoadOptions: поля после последнего нужного
+     * не выделяются, ненужные поля не преобразуются, строки вне диапазона дат
+     * отбрасываются сразу после разбора даты.
+     */
+    class CSVRowParser {
+    public:
+        explicit CSVRowParser(const CSVLoadOptions &options) : _options(options) {
+            _filterByDate = options.from.has_value() || options.to.has_value();
+            for (size_t i = 1; i < CSV_FIELD_COUNT; ++i) {
+                if (options.wants(CSV_FIELD_COLUMNS[i])) _lastField = i;
+            }
+            if (_filterByDate) _lastField = max(_lastField, CSV_DATE_FIELD);
+        }
+
+        /**
+         * @param requireAllFields требовать все CSV_FIELD_COUNT полей независимо от
+         * набора столбцов (для недописанной последней строки файла).
+         */
+        RowParseResult parse(string_view line, const bool requireAllFields, vector<DatasetValue> &rows) const {
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            const size_t lastField = requireAllFields ? CSV_FIELD_COUNT - 1 : _lastField;
+            array<string_view, CSV_FIELD_COUNT> f{};
+            time_t date = 0;
+            size_t pos = 0;
+            for (size_t i = 0; i <= lastField; ++i) {
+                if (pos > line.size()) return RowParseResult::Invalid;
+                f[i] = nextCSVField(line, pos);
+                if (i == CSV_DATE_FIELD && (_filterByDate || _options.wants(DatasetColumn::Date))) {
+                    // Нераспознанная дата делает строку некорректной: нулевая дата нарушила бы порядок ряда
+                    int64_t days = 0;
+                    if (!parseDateMDY(f[i], days) && !parseDateISO(f[i], days)) return RowParseResult::Invalid;
+                    date = daysToTimeT(days);
+                    if ((_options.from && date < *_options.from) || (_options.to && date > *_options.to)) {
+                        return RowParseResult::Filtered;
+                    }
+                }
+            }
+
+            // Некорректное число в нужном столбце делает строку некорректной, а не нулём
+            array<int, CSV_FIELD_COUNT> numbers{};
+            for (const size_t field : {size_t{2}, size_t{4}, size_t{5}, size_t{6}, size_t{7}}) {
+                if (_options.wants(CSV_FIELD_COLUMNS[field]) &&
+                    parseNumber(f[field], numbers[field]) != ParseStatus::Ok) {
+                    return RowParseResult::Invalid;
+                }
+            }
+            rows.emplace_back(
+                _options.wants(DatasetColumn::Day) ? string(f[1]) : string(),
+                numbers[2],
+                _options.wants(DatasetColumn::Date) ? date : time_t(0),
+                numbers[4],
+                numbers[5],
+                numbers[6],
+                numbers[7]
+            );
+            return RowParseResult::Added;
+        }
+
+    private:
+        const CSVLoadOptions &_options;
+        bool _filterByDate = false;
+        size_t _lastField = 0;
+    };
+
+    /**
+     * Разбирает все полные строки из data.
+     * @param skipHeader [in,out] пропустить первую строку (сбрасывается после пропуска).
+     * @param atEOF data заканчивается концом файла: последняя строка без '\n'
+     * принимается, если в ней есть все поля.
+     * @return количество обработанных байт (всегда на границе строки).
+     */
+    size_t parseCSVChunk(const string_view data, const CSVRowParser &parser, bool &skipHeader, const bool atEOF,
+                         vector<DatasetValue> &rows, size_t &appended) {
+        size_t pos = 0;
+        while (pos < data.size()) {
+            const size_t eol = data.find('\n', pos);
+            if (eol == string_view::npos) {
+                if (!atEOF) break;
+                const string_view tail = data.substr(pos);
+                if (skipHeader) {
+                    skipHeader = false;
+                    pos = data.size();
+                } else if (const auto r = parser.parse(tail, true, rows); r != RowParseResult::Invalid) {
+                    if (r == RowParseResult::Added) ++appended;
+                    pos = data.size();
+                }
+                break;
+            }
+
+            const string_view line = data.substr(pos, eol - pos);
+            if (skipHeader) {
+                skipHeader = false;
+            } else if (parser.parse(line, false, rows) == RowParseResult::Added) {
+                ++appended;
+            }
+            pos = eol + 1;
+        }
+        return pos;
+    }
+
+    /**
+     * Дата строки CSV; nullopt, если в строке нет поля даты.
+     */
+    optional<time_t> csvLineDate(const string_view line) {
+        size_t pos = 0;
+        string_view field;
+        for (size_t i = 0; i <= CSV_DATE_FIELD; ++i) {
+            if (pos > line.size()) return nullopt;
+            field = nextCSVField(line, pos);
+        }
+        return parseDateString(field);
+    }
+
+    /**
+     * Дата первой полной строки в data (после первого перевода строки);
+     * nullopt, если полной строки нет.
+     */
+    optional<time_t> firstFullLineDate(const string_view data) {
+        const size_t begin = data.find('\n');
+        if (begin == string_view::npos) return nullopt;
+        const size_t end = data.find('\n', begin + 1);
+        if (end == string_view::npos) return nullopt;
+        return csvLineDate(data.substr(begin + 1, end - begin - 1));
+    }
+
+    /**
+     * Количество пропущенных дней между соседними датами; 0, если даты идут подряд или повторяются.
+     * Без ветвлений, чтобы цикл подсчёта по всему ряду оставался простым для векторизации.
+     */
+    inline int64_t missingDaysBetween(const time_t prev, const time_t next) {
+        const int64_t steps = (static_cast<int64_t>(next) - static_cast<int64_t>(prev)) / SECONDS_PER_DAY;
+        return max<int64_t>(steps - 1, 0);
+    }
+
+    /**
+     * Метрики записи в порядке столбцов PageLoads, UniqueVisitors, FirstTimeVisitors, ReturningVisitors.
+     */
+    array<int, 4> rowMetrics(const DatasetValue &row) {
+        return {row.getPageLoads(), row.getUniqueVisitors(), row.getFirstTimeVisitors(), row.getReturningVisitors()};
+    }
+
+    /**
+     * Контрольная сумма последних CSV_CURSOR_TAIL_SIZE байт перед offset.
+     */
+    bool tailChecksum(ifstream &file, const uint64_t offset, uint64_t &checksum) {
+        const size_t len = static_cast<size_t>(min<uint64_t>(offset, CSV_CURSOR_TAIL_SIZE));
+        array<char, CSV_CURSOR_TAIL_SIZE> tail{};
+        file.clear();
+        file.seekg(static_cast<streamoff>(offset - len));
+        file.read(tail.data(), static_cast<streamsize>(len));
+        if (static_cast<size_t>(file.gcount()) != len) return false;
+        checksum = fnv1a64(tail.data(), len);
+        return true;
+    }
+}
+
 /**
  * @brief Загрузить записи набора данных из CSV-файла.
  *
@@ -49,42 +244,585 @@ void Dataset::setRows(vector<DatasetValue> r) {
  * Каждая последующая строка должна содержать следующие поля через запятую:
  * row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors
  *
- * Числовые поля могут передаваться как строки и будут распарсены
- * соответствующими конструкторами DatasetValue. Строки с неправильным
- * количеством полей будут проигнорированы.
+ * Числовые поля разбираются parseNumber, дата — parseDateMDY или parseDateISO.
+ * Строки с неправильным количеством полей, некорректным числом или
+ * нераспознанной датой будут проигнорированы.
  *
  * @param filename Путь к CSV-файлу для чтения. Если файл не может быть
  * открыт, набор данных останется пустым.
  */
 void Dataset::fromCSV(const string &filename) {
+    fromCSV(filename, CSVLoadOptions{});
+}
+
+/**
+ * @brief Загрузить из CSV только нужные столбцы и строки из диапазона дат.
+ *
+ * @param filename Путь к CSV-файлу.
+ * @param options Набор столбцов и диапазон дат.
+ */
+void Dataset::fromCSV(const string &filename, const CSVLoadOptions &options) {
     rows.clear();
-    std::ifstream file(filename);
-    string line;
-
-    std::getline(file, line);
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-
-        vector<string> inputs;
-        string input;
-        while (std::getline(iss, input, ',')) {
-            if (input[0] == '"') {
-                string input2;
-                std::getline(iss, input2, ',');
-                inputs.push_back(input + input2);
-            } else {
-                inputs.push_back(input);
+    CSVCursor cursor;
+    appendFromCSV(filename, cursor, options, true);
+}
+
+/**
+ * @brief Дочитать новые строки CSV-файла, дописанные после позиции cursor.
+ *
+ * Файл читается порциями по CSV_READ_CHUNK байт начиная с cursor.offset;
+ * недочитанная строка переносится в следующую порцию. Хвост без перевода
+ * строки в конце файла разбирается только при complete.
+ *
+ * @param filename Путь к CSV-файлу.
+ * @param cursor [in,out] Позиция чтения.
+ * @param options Набор столбцов и диапазон дат.
+ * @param complete Принять последнюю строку без '\n'.
+ * @return Количество добавленных записей и признак полной перезагрузки.
+ */
+CSVAppendResult Dataset::appendFromCSV(const string &filename, CSVCursor &cursor, const CSVLoadOptions &options,
+                                       const bool complete) {
+    CSVAppendResult result;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        result.opened = false;
+        return result;
+    }
+
+    file.seekg(0, std::ios::end);
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+
+    // Файл перезаписан (стал короче или изменился уже прочитанный хвост): читаем заново
+    uint64_t checksum = 0;
+    if (cursor.offset > 0 &&
+        (cursor.offset > fileSize || !tailChecksum(file, cursor.offset, checksum) || checksum != cursor.tailChecksum)) {
+        rows.clear();
+        cursor = CSVCursor{};
+        result.reloaded = true;
+    }
+
+    const CSVRowParser parser(options);
+    bool skipHeader = cursor.offset == 0;
+    uint64_t position = cursor.offset;
+    string buffer;
+    file.clear();
+    file.seekg(static_cast<streamoff>(position));
+    while (position < fileSize) {
+        const size_t carried = buffer.size();
+        const size_t toRead = static_cast<size_t>(min<uint64_t>(CSV_READ_CHUNK, fileSize - position));
+        buffer.resize(carried + toRead);
+        file.read(buffer.data() + carried, static_cast<streamsize>(toRead));
+        const auto got = static_cast<size_t>(file.gcount());
+        buffer.resize(carried + got);
+        position += got;
+
+        const bool atEOF = got < toRead || position >= fileSize;
+        const size_t consumed =
+            parseCSVChunk(buffer, parser, skipHeader, atEOF && complete, rows, result.rowsAppended);
+        cursor.offset += consumed;
+        buffer.erase(0, consumed);
+        if (atEOF) break;
+    }
+
+    if (cursor.offset > 0 && tailChecksum(file, cursor.offset, checksum)) {
+        cursor.tailChecksum = checksum;
+    }
+    return result;
+}
+
+/**
+ * @brief Загрузить и объединить несколько CSV-файлов.
+ *
+ * Задачи общего исполнителя (не больше options.threads) берут следующий
+ * неразобранный файл по атомарному счётчику.
+ * Слияние: в куче по одной текущей записи из каждого файла, упорядочение
+ * по (дата, номер файла, позиция в файле), поэтому среди записей с одной
+ * датой первой извлекается запись из более раннего файла. При KeepFirst
+ * остаётся первая извлечённая запись, при KeepLast — последняя.
+ *
+ * @param filenames Пути к CSV-файлам.
+ * @param options Параметры загрузки и слияния.
+ * @return Количество записей, отброшенных повторов, пропуски и неоткрытые файлы.
+ */
+CSVMergeResult Dataset::fromCSVFiles(const vector<string> &filenames, const CSVMergeOptions &options) {
+    CSVMergeResult result;
+    rows.clear();
+
+    // Слияние идёт по дате, поэтому столбец даты нужен всегда
+    CSVLoadOptions load = options.load;
+    load.columns |= CSVLoadOptions::columnBit(DatasetColumn::Date);
+
+    // Разбор файлов параллельно
+    vector<Dataset> shards(filenames.size());
+    vector<char> opened(filenames.size(), 0);
+    atomic<size_t> next{0};
+    const auto parseShards = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < filenames.size();) {
+            CSVCursor cursor;
+            opened[i] = shards[i].appendFromCSV(filenames[i], cursor, load, true).opened;
+            auto &shardRows = shards[i].rows;
+            if (!is_sorted(shardRows.begin(), shardRows.end(), [](const DatasetValue &a, const DatasetValue &b) {
+                    return a.getDate() < b.getDate();
+                })) {
+                stable_sort(shardRows.begin(), shardRows.end(), [](const DatasetValue &a, const DatasetValue &b) {
+                    return a.getDate() < b.getDate();
+                });
+            }
+        }
+    };
+    const unsigned limit = options.threads > 0 ? options.threads : Executor::global().concurrency();
+    parallelFor(0, min<size_t>(limit, filenames.size()), [&](size_t) { parseShards(); }, 1);
+
+    size_t total = 0;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        if (!opened[i]) result.failed.push_back(filenames[i]);
+        total += shards[i].rows.size();
+    }
+    rows.reserve(total);
+
+    // k-путевое слияние: (дата, номер файла, позиция)
+    using HeapEntry = tuple<time_t, size_t, size_t>;
+    priority_queue<HeapEntry, vector<HeapEntry>, greater<>> heap;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!shards[i].rows.empty()) heap.emplace(shards[i].rows[0].getDate(), i, 0);
+    }
+
+    while (!heap.empty()) {
+        const auto [date, shard, position] = heap.top();
+        heap.pop();
+        if (position + 1 < shards[shard].rows.size()) {
+            heap.emplace(shards[shard].rows[position + 1].getDate(), shard, position + 1);
+        }
+
+        DatasetValue &row = shards[shard].rows[position];
+        if (!rows.empty() && rows.back().getDate() == date) {
+            ++result.duplicates;
+            if (options.duplicates == DuplicatePolicy::KeepLast) rows.back() = std::move(row);
+            continue;
+        }
+
+        // Пропуск: между соседними датами больше одного дня
+        if (!rows.empty()) {
+            if (const int64_t missing = missingDaysBetween(rows.back().getDate(), date); missing > 0) {
+                const time_t from = rows.back().getDate() + SECONDS_PER_DAY;
+                result.gaps.push_back(DateGap{from, from + (missing - 1) * SECONDS_PER_DAY, static_cast<size_t>(missing)});
+            }
+        }
+        rows.push_back(std::move(row));
+    }
+
+    result.rows = rows.size();
+    return result;
+}
+
+/**
+ * @brief Дочитать CSV из несохраняемого потока.
+ *
+ * Производитель заполняет буферы кольца целиком (короткие чтения из канала
+ * склеиваются), потребитель разбирает полные строки прямо из буфера через
+ * parseCSVChunk, а хвост без перевода строки переносит в carry. Поток
+ * производителя присоединяется и при исключении в разборе.
+ *
+ * @param source Источник байтов.
+ * @param options Набор столбцов и диапазон дат.
+ * @param bufferSize Размер одного буфера кольца.
+ * @return Количество добавленных записей и признак ошибки чтения.
+ */
+StreamLoadResult Dataset::appendFromStream(const ByteSource &source, const CSVLoadOptions &options,
+                                           const size_t bufferSize) {
+    StreamLoadResult result;
+    BufferRing ring(BufferRing::DEFAULT_BUFFER_COUNT, bufferSize);
+
+    bool readError = false;
+    // Если разбор бросит исключение, деструктор jthread запросит остановку:
+    // обратный вызов отменит кольцо, ждущий производитель выйдет, и поток будет присоединён
+    jthread producer([&](const stop_token stop) {
+        const stop_callback cancelOnStop(stop, [&ring] { ring.cancel(); });
+        while (true) {
+            const span<char> buffer = ring.acquireWrite();
+            if (buffer.empty()) return;
+            size_t used = 0;
+            bool eof = false;
+            while (used < buffer.size()) {
+                const ptrdiff_t got = source(buffer.data() + used, buffer.size() - used);
+                if (got <= 0) {
+                    readError = got < 0;
+                    eof = true;
+                    break;
+                }
+                used += static_cast<size_t>(got);
+            }
+            if (used > 0) ring.commitWrite(used);
+            if (eof) {
+                ring.close();
+                return;
+            }
+        }
+    });
+
+    const CSVRowParser parser(options);
+    bool skipHeader = true;
+    string carry;
+    for (string_view data; !(data = ring.acquireRead()).empty(); ring.releaseRead()) {
+        if (!carry.empty()) {
+            // Дописываем разорванную строку до первого перевода строки в новом буфере
+            const size_t eol = data.find('\n');
+            const size_t take = eol == string_view::npos ? data.size() : eol + 1;
+            carry.append(data.substr(0, take));
+            data.remove_prefix(take);
+            if (eol == string_view::npos) continue;
+            parseCSVChunk(carry, parser, skipHeader, false, rows, result.rowsAppended);
+            carry.clear();
+        }
+        const size_t consumed = parseCSVChunk(data, parser, skipHeader, false, rows, result.rowsAppended);
+        carry.assign(data.substr(consumed));
+    }
+    if (!carry.empty()) {
+        parseCSVChunk(carry, parser, skipHeader, true, rows, result.rowsAppended);
+    }
+
+    producer.join();
+    result.readError = readError;
+    return result;
+}
+
+/**
+ * @brief Дочитать CSV из файлового дескриптора.
+ *
+ * Прерванные сигналом чтения (EINTR) повторяются.
+ *
+ * @param fd Файловый дескриптор.
+ * @param options Набор столбцов и диапазон дат.
+ * @return Количество добавленных записей и признак ошибки чтения.
+ */
+StreamLoadResult Dataset::appendFromFD(const int fd, const CSVLoadOptions &options) {
+    return appendFromStream([fd](char *buffer, const size_t capacity) -> ptrdiff_t {
+        while (true) {
+            const ssize_t got = ::read(fd, buffer, capacity);
+            if (got >= 0 || errno != EINTR) return got;
+        }
+    }, options);
+}
+
+/**
+ * @brief Дочитать CSV из зашифрованного файла.
+ *
+ * Исключения расшифровщика не выходят за пределы потока-производителя:
+ * источник возвращает -1 и запоминает сообщение.
+ */
+StreamLoadResult Dataset::appendFromEncrypted(const string &filename, const SeedCryptor &cryptor,
+                                              const CSVLoadOptions &options) {
+    StreamLoadResult result;
+    ifstream in(filename, ios::binary);
+    if (!in) {
+        result.readError = true;
+        result.error = "не удалось открыть файл " + filename;
+        return result;
+    }
+
+    optional<SeedStreamDecryptor> reader;
+    try {
+        reader.emplace(cryptor, in);
+    } catch (const exception &e) {
+        result.readError = true;
+        result.error = e.what();
+        return result;
+    }
+
+    string error;
+    result = appendFromStream([&](char *buffer, const size_t capacity) -> ptrdiff_t {
+        try {
+            return static_cast<ptrdiff_t>(reader->read(reinterpret_cast<unsigned char *>(buffer), capacity));
+        } catch (const exception &e) {
+            error = e.what();
+            return -1;
+        }
+    }, options);
+    result.error = std::move(error);
+    return result;
+}
+
+/**
+ * @brief Дочитать из зашифрованного файла с порциями записи из диапазона дат.
+ *
+ * Порция i подходит для начала чтения, если дата её первой полной строки
+ * раньше options.from: всё, что в ней до этой строки, тоже раньше from.
+ * Двоичный поиск находит последнюю такую порцию; начало её первой строки
+ * (хвост строки из предыдущей порции) пропускается. Каждая порция
+ * проверяется по CMAC при расшифровке (SeedCryptor::decryptRange).
+ */
+StreamLoadResult Dataset::appendDateRangeFromEncrypted(const string &filename, const SeedCryptor &cryptor,
+                                                       const CSVLoadOptions &options) {
+    if (!options.from && !options.to) {
+        return appendFromEncrypted(filename, cryptor, options);
+    }
+    ifstream in(filename, ios::binary);
+    array<std::byte, SeedCryptor::HEADER_SIZE> head{};
+    in.read(reinterpret_cast<char *>(head.data()), static_cast<streamsize>(head.size()));
+    if (static_cast<size_t>(in.gcount()) != head.size() || SeedCryptor::detectMode(head) != CipherMode::Chunked) {
+        return appendFromEncrypted(filename, cryptor, options);
+    }
+
+    StreamLoadResult result;
+    const size_t before = rows.size();
+    try {
+        const ChunkedLayout layout = SeedCryptor::readChunkedLayout(in);
+        const auto readChunk = [&](const uint64_t index) {
+            return cryptor.decryptRange(in, index * layout.chunkSize, layout.chunkSize);
+        };
+        const auto asText = [](const vector<unsigned char> &data) {
+            return string_view(reinterpret_cast<const char *>(data.data()), data.size());
+        };
+
+        uint64_t start = 0;
+        if (options.from) {
+            for (uint64_t low = 1, high = layout.chunkCount; low < high;) {
+                const uint64_t middle = low + (high - low) / 2;
+                const auto date = firstFullLineDate(asText(readChunk(middle)));
+                if (date && *date < *options.from) {
+                    start = middle;
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
             }
         }
 
-        if (inputs.size() >= 7) {
-            DatasetValue dv(inputs[1], stoi(inputs[2]), inputs[3], inputs[4], inputs[5], inputs[6], inputs[7]);
+        const CSVRowParser parser(options);
+        bool skipHeader = start == 0;
+        bool skipPartial = start > 0;
+        bool pastRange = false;
+        optional<time_t> previous;
+        string carry;
+        for (uint64_t index = start; index < layout.chunkCount && !pastRange; ++index) {
+            const auto plain = readChunk(index);
+            string_view data = asText(plain);
+            if (skipPartial) {
+                const size_t eol = data.find('\n');
+                if (eol == string_view::npos) continue;
+                data.remove_prefix(eol + 1);
+                skipPartial = false;
+            }
+            carry.append(data);
+
+            // Проверка порядка дат и конца диапазона по полным строкам (кроме заголовка)
+            size_t pos = 0;
+            if (skipHeader) {
+                const size_t eol = carry.find('\n');
+                pos = eol == string::npos ? carry.size() : eol + 1;
+            }
+            for (size_t eol; (eol = carry.find('\n', pos)) != string::npos; pos = eol + 1) {
+                const auto date = csvLineDate(string_view(carry).substr(pos, eol - pos));
+                if (!date) continue;
+                if (previous && *date < *previous) {
+                    rows.erase(rows.begin() + static_cast<ptrdiff_t>(before), rows.end());
+                    return appendFromEncrypted(filename, cryptor, options);
+                }
+                previous = date;
+                if (options.to && *date > *options.to) pastRange = true;
+            }
 
-            rows.push_back(std::move(dv));
+            const size_t consumed = parseCSVChunk(carry, parser, skipHeader, false, rows, result.rowsAppended);
+            carry.erase(0, consumed);
+        }
+        if (!pastRange && !carry.empty()) {
+            parseCSVChunk(carry, parser, skipHeader, true, rows, result.rowsAppended);
         }
+    } catch (const exception &e) {
+        result.readError = true;
+        result.error = e.what();
     }
+    return result;
+}
 
-    file.close();
+/**
+ * @brief Загрузить набор данных из CSV, используя бинарный снимок как кэш.
+ *
+ * Снимок считается актуальным, если размер и время изменения CSV совпадают
+ * с записанными в его заголовке. Если CSV недоступен, но снимок есть,
+ * используется снимок.
+ *
+ * @param filename Путь к CSV-файлу.
+ * @param snapshotPath Путь к файлу бинарного снимка.
+ * @return true, если данные были загружены из снимка.
+ */
+bool Dataset::fromCSVCached(const string &filename, const string &snapshotPath, CSVCursor *cursor) {
+    SnapshotSource csvSource;
+    const bool csvExists = DatasetSnapshot::statSource(filename, csvSource);
+
+    SnapshotSource snapshotSource;
+    if (DatasetSnapshot::readSource(snapshotPath, snapshotSource)) {
+        // Снимок актуален
+        if ((!csvExists || snapshotSource.sameFile(csvSource)) &&
+            DatasetSnapshot::load(snapshotPath, *this, &snapshotSource)) {
+            if (cursor) *cursor = snapshotSource.cursor;
+            return true;
+        }
+
+        // CSV дописан: загружаем снимок и дочитываем только новые байты
+        if (csvExists && snapshotSource.cursor.offset > 0 && snapshotSource.cursor.offset <= csvSource.size &&
+            DatasetSnapshot::load(snapshotPath, *this, &snapshotSource)) {
+            csvSource.cursor = snapshotSource.cursor;
+            const auto appended = appendFromCSV(filename, csvSource.cursor);
+            if (!DatasetSnapshot::save(*this, snapshotPath, csvSource)) {
+                cerr << "Не удалось сохранить снимок набора данных в " << snapshotPath << endl;
+            }
+            if (cursor) *cursor = csvSource.cursor;
+            return !appended.reloaded;
+        }
+    }
+
+    rows.clear();
+    appendFromCSV(filename, csvSource.cursor);
+    if (csvExists && !DatasetSnapshot::save(*this, snapshotPath, csvSource)) {
+        cerr << "Не удалось сохранить снимок набора данных в " << snapshotPath << endl;
+    }
+    if (cursor) *cursor = csvSource.cursor;
+    return false;
+}
+
+/**
+ * @brief Сохранить набор данных в бинарный поколоночный снимок.
+ *
+ * @param path Путь к файлу снимка.
+ * @return true при успешном сохранении.
+ */
+bool Dataset::saveSnapshot(const string &path) const {
+    return DatasetSnapshot::save(*this, path);
+}
+
+/**
+ * @brief Загрузить набор данных из бинарного поколоночного снимка.
+ *
+ * @param path Путь к файлу снимка.
+ * @return true при успешной загрузке.
+ */
+bool Dataset::loadSnapshot(const string &path) {
+    return DatasetSnapshot::load(path, *this);
+}
+
+/**
+ * @brief Найти записи с датой в диапазоне [from, to] двоичным поиском.
+ *
+ * @param from Начало диапазона (включительно).
+ * @param to Конец диапазона (включительно).
+ * @return Непрерывный диапазон записей внутри набора.
+ */
+span<const DatasetValue> Dataset::sliceByDate(const time_t from, const time_t to) const {
+    const auto first = lower_bound(rows.begin(), rows.end(), from,
+        [](const DatasetValue &row, const time_t date) { return row.getDate() < date; });
+    const auto last = upper_bound(first, rows.end(), to,
+        [](const time_t date, const DatasetValue &row) { return date < row.getDate(); });
+    if (first >= last) return {};
+    return {&*first, static_cast<size_t>(last - first)};
+}
+
+/**
+ * @brief Оставить в наборе только записи с датой в диапазоне [from, to].
+ *
+ * @param from Начало диапазона (включительно).
+ * @param to Конец диапазона (включительно).
+ */
+void Dataset::retainDateRange(const time_t from, const time_t to) {
+    const auto slice = sliceByDate(from, to);
+    if (slice.empty()) {
+        rows.clear();
+        return;
+    }
+    const auto first = static_cast<size_t>(slice.data() - rows.data());
+    rows.erase(rows.begin() + static_cast<ptrdiff_t>(first + slice.size()), rows.end());
+    rows.erase(rows.begin(), rows.begin() + static_cast<ptrdiff_t>(first));
+}
+
+/**
+ * @brief Проверить, что даты записей не убывают.
+ */
+bool Dataset::isSortedByDate() const {
+    return is_sorted(rows.begin(), rows.end(), [](const DatasetValue &a, const DatasetValue &b) {
+        return a.getDate() < b.getDate();
+    });
+}
+
+/**
+ * @brief Найти пропущенные дни.
+ *
+ * @return Пропуски по возрастанию дат; пусто, если даты где-то убывают.
+ */
+vector<DateGap> Dataset::findGaps() const {
+    vector<DateGap> gaps;
+    if (!isSortedByDate()) return gaps;
+    for (size_t i = 1; i < rows.size(); ++i) {
+        if (const int64_t missing = missingDaysBetween(rows[i - 1].getDate(), rows[i].getDate()); missing > 0) {
+            const time_t from = rows[i - 1].getDate() + SECONDS_PER_DAY;
+            gaps.push_back(DateGap{from, from + (missing - 1) * SECONDS_PER_DAY, static_cast<size_t>(missing)});
+        }
+    }
+    return gaps;
+}
+
+/**
+ * @brief Заполнить пропущенные дни.
+ *
+ * Записи переносятся (move) в новый вектор, выделенный один раз под
+ * итоговый размер; добавленные записи вставляются между ними по ходу.
+ * Для SeasonalNaive источником служит уже построенная часть ряда, поэтому
+ * пропуск длиннее сезона заполняется повторением последнего сезона.
+ *
+ * @param method Способ заполнения.
+ * @param seasonLength Длина сезона.
+ * @return Заполненные пропуски и количество добавленных записей.
+ */
+GapFillResult Dataset::fillGaps(const ImputeMethod method, const int seasonLength) {
+    GapFillResult result;
+
+    // Первый проход — только подсчёт; убывающий шаг отмечается без ветвления
+    int64_t missing = 0;
+    bool decreasing = false;
+    for (size_t i = 1; i < rows.size(); ++i) {
+        missing += missingDaysBetween(rows[i - 1].getDate(), rows[i].getDate());
+        decreasing |= rows[i].getDate() < rows[i - 1].getDate();
+    }
+    if (decreasing) {
+        // Шаг назад (например, нулевая дата посреди ряда) — не начало нового диапазона, а ошибка данных
+        result.unsorted = true;
+        return result;
+    }
+    if (missing == 0) return result;
+
+    vector<DatasetValue> filled;
+    filled.reserve(rows.size() + static_cast<size_t>(missing));
+    const bool withDayNames = !rows.front().getDay().empty();
+    const auto season = static_cast<size_t>(max(1, seasonLength));
+
+    filled.push_back(std::move(rows[0]));
+    for (size_t i = 1; i < rows.size(); ++i) {
+        const time_t prevDate = filled.back().getDate();
+        const int64_t gap = missingDaysBetween(prevDate, rows[i].getDate());
+        if (gap > 0) {
+            const auto before = rowMetrics(filled.back());
+            const auto after = rowMetrics(rows[i]);
+            const int64_t firstDay = timeTToDays(prevDate) + 1;
+            for (int64_t k = 1; k <= gap; ++k) {
+                array<int, 4> values{};
+                if (method == ImputeMethod::SeasonalNaive && filled.size() >= season) {
+                    values = rowMetrics(filled[filled.size() - season]);
+                } else {
+                    for (size_t c = 0; c < values.size(); ++c) {
+                        values[c] = static_cast<int>(llround(before[c] + static_cast<double>(after[c] - before[c]) *
+                                                             static_cast<double>(k) / static_cast<double>(gap + 1)));
+                    }
+                }
+                const int64_t days = firstDay + k - 1;
+                filled.emplace_back(withDayNames ? weekdayName(days) : string(), weekdayFromDays(days) + 1,
+                                    daysToTimeT(days), values[0], values[1], values[2], values[3]);
+            }
+            result.gaps.push_back(DateGap{daysToTimeT(firstDay), daysToTimeT(firstDay + gap - 1), static_cast<size_t>(gap)});
+            result.filled += static_cast<size_t>(gap);
+        }
+        filled.push_back(std::move(rows[i]));
+    }
+    rows = std::move(filled);
+    return result;
 }
 
 /**
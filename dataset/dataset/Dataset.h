@@ -1,13 +1,165 @@
 #ifndef TRAFFIC_FORECAST_DATASET_H
 #define TRAFFIC_FORECAST_DATASET_H
 
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string>
 
 #include "DatasetValue.h"
+#include "BufferRing.h"
+#include "crypt.h"
 
 using namespace std;
 
+/**
+ * @brief Столбцы набора данных.
+ *
+ * Используются для поколоночного хранения (бинарный снимок) и выбора
+ * нужных столбцов при загрузке. Значения совпадают с идентификаторами
+ * столбцов в бинарном снимке, поэтому их нельзя переупорядочивать.
+ */
+enum class DatasetColumn : uint32_t {
+    Day = 0,
+    DayOfWeek = 1,
+    Date = 2,
+    PageLoads = 3,
+    UniqueVisitors = 4,
+    FirstTimeVisitors = 5,
+    ReturningVisitors = 6
+};
+
+/// Количество столбцов в DatasetColumn.
+constexpr size_t DATASET_COLUMN_COUNT = 7;
+
+/**
+ * @brief Позиция инкрементального чтения CSV-файла.
+ *
+ * offset — количество уже прочитанных байт (всегда на границе строки),
+ * tailChecksum — FNV-1a последних CSV_CURSOR_TAIL_SIZE байт перед offset.
+ * По контрольной сумме хвоста обнаруживается, что файл был перезаписан,
+ * а не дописан.
+ */
+struct CSVCursor {
+    uint64_t offset = 0;       ///< Количество прочитанных байт
+    uint64_t tailChecksum = 0; ///< Контрольная сумма хвоста прочитанной части
+};
+
+/// Длина хвоста прочитанной части CSV, по которой считается CSVCursor::tailChecksum.
+constexpr size_t CSV_CURSOR_TAIL_SIZE = 256;
+
+/**
+ * @brief Параметры загрузки CSV: набор нужных столбцов и диапазон дат.
+ *
+ * Столбцы, не входящие в набор, не разбираются (остаются нулями и пустой
+ * строкой), а разбор строки прекращается после последнего нужного поля.
+ * Строки с датой вне [from, to] отбрасываются сразу после разбора даты.
+ */
+struct CSVLoadOptions {
+    uint32_t columns = ALL_COLUMNS;   ///< Битовая маска нужных столбцов (см. columnBit)
+    optional<time_t> from{};          ///< Начало диапазона дат (включительно)
+    optional<time_t> to{};            ///< Конец диапазона дат (включительно)
+
+    /// Маска всех столбцов
+    static constexpr uint32_t ALL_COLUMNS = (1u << DATASET_COLUMN_COUNT) - 1;
+
+    /**
+     * @brief Бит столбца в маске columns.
+     */
+    static constexpr uint32_t columnBit(DatasetColumn column) {
+        return 1u << static_cast<uint32_t>(column);
+    }
+
+    /**
+     * @brief Нужен ли столбец при загрузке.
+     */
+    [[nodiscard]] constexpr bool wants(const DatasetColumn column) const {
+        return (columns & columnBit(column)) != 0;
+    }
+};
+
+/**
+ * @brief Результат инкрементального чтения CSV.
+ */
+struct CSVAppendResult {
+    size_t rowsAppended = 0; ///< Количество добавленных записей
+    bool reloaded = false;   ///< Файл был перезаписан и перечитан целиком (записи заменены)
+    bool opened = true;      ///< Файл удалось открыть
+};
+
+/**
+ * @brief Источник байтов для потокового чтения.
+ *
+ * Заполняет буфер buffer не более чем capacity байтами.
+ * Возвращает количество прочитанных байт, 0 — конец данных, отрицательное
+ * значение — ошибка чтения.
+ */
+using ByteSource = function<ptrdiff_t(char *buffer, size_t capacity)>;
+
+/**
+ * @brief Результат потокового чтения CSV.
+ */
+struct StreamLoadResult {
+    size_t rowsAppended = 0; ///< Количество добавленных записей
+    bool readError = false;  ///< Чтение прервано ошибкой источника (добавлены записи до ошибки)
+    string error{};          ///< Описание ошибки источника, если оно известно
+};
+
+/**
+ * @brief Пропуск в ряду: дни без записей между двумя соседними датами.
+ */
+struct DateGap {
+    time_t from;     ///< Первый пропущенный день
+    time_t to;       ///< Последний пропущенный день
+    size_t missing;  ///< Количество пропущенных дней
+};
+
+/**
+ * @brief Какую запись оставлять, если одна дата встречается в нескольких файлах.
+ */
+enum class DuplicatePolicy {
+    KeepFirst,  ///< Запись из файла, стоящего раньше в списке
+    KeepLast    ///< Запись из файла, стоящего позже в списке (более свежая выгрузка)
+};
+
+/**
+ * @brief Параметры загрузки нескольких CSV-файлов.
+ */
+struct CSVMergeOptions {
+    CSVLoadOptions load{};                              ///< Столбцы и диапазон дат для каждого файла
+    DuplicatePolicy duplicates = DuplicatePolicy::KeepLast; ///< Разрешение повторов дат
+    unsigned threads = 0;                               ///< Наибольшее число файлов, разбираемых одновременно (0 — по числу потоков исполнителя)
+};
+
+/**
+ * @brief Результат загрузки нескольких CSV-файлов.
+ */
+struct CSVMergeResult {
+    size_t rows = 0;           ///< Записей после слияния
+    size_t duplicates = 0;     ///< Отброшено повторов дат
+    vector<DateGap> gaps;      ///< Пропуски в итоговом ряду, по возрастанию дат
+    vector<string> failed;     ///< Файлы, которые не удалось открыть
+};
+
+/**
+ * @brief Способ заполнения пропущенных дней.
+ */
+enum class ImputeMethod {
+    Linear,        ///< Линейная интерполяция между соседними известными днями
+    SeasonalNaive  ///< Значение того же дня предыдущего сезона (линейно, если сезона ещё нет)
+};
+
+/**
+ * @brief Результат заполнения пропусков.
+ */
+struct GapFillResult {
+    vector<DateGap> gaps;  ///< Заполненные пропуски, по возрастанию дат
+    size_t filled = 0;     ///< Всего добавлено записей
+    bool unsorted = false; ///< Даты где-то убывают: пропуски не заполнялись, набор не изменён
+};
+
 /**
  * @brief Представляет коллекцию записей набора данных.
  *
@@ -62,6 +214,218 @@ public:
      */
     void fromCSV(const string &filename);
 
+    /**
+     * @brief Загрузить из CSV только нужные столбцы и строки из диапазона дат.
+     *
+     * @param filename Путь к CSV-файлу.
+     * @param options Набор столбцов и диапазон дат (см. CSVLoadOptions).
+     */
+    void fromCSV(const string &filename, const CSVLoadOptions &options);
+
+    /**
+     * @brief Загрузить и объединить несколько CSV-файлов (например, помесячные выгрузки).
+     *
+     * Файлы разбираются параллельно, затем сливаются по дате k-путевым
+     * слиянием через кучу. Если дата встречается несколько раз (файлы
+     * перекрываются), остаётся одна запись согласно options.duplicates.
+     * В том же проходе находятся пропуски дней в итоговом ряду.
+     * Записи внутри файла не обязаны быть упорядочены по дате.
+     *
+     * @param filenames Пути к CSV-файлам; порядок важен для DuplicatePolicy.
+     * @param options Столбцы, диапазон дат, политика повторов и число потоков.
+     * @return Количество записей, отброшенных повторов, пропуски и неоткрытые файлы.
+     */
+    CSVMergeResult fromCSVFiles(const vector<string> &filenames, const CSVMergeOptions &options = {});
+
+    /**
+     * @brief Дочитать новые строки CSV-файла, дописанные после позиции cursor.
+     *
+     * Разбираются только байты после cursor.offset; новые записи добавляются
+     * в конец набора. Если файл стал короче или контрольная сумма хвоста не
+     * совпадает (файл перезаписан), набор очищается и файл читается целиком.
+     * При cursor.offset == 0 первая строка считается заголовком и пропускается.
+     * Разбираются только строки, завершённые переводом строки: последняя
+     * строка без '\n' может быть дописана не до конца (например, "…,12"
+     * вместо "…,1234"), поэтому она остаётся за курсором и читается при
+     * следующем вызове. Исключение — разовая загрузка (complete = true):
+     * файл уже дописан, и последняя строка принимается, если в ней есть все
+     * поля записи; курсор после такой загрузки для дочитывания не годится.
+     *
+     * @param filename Путь к CSV-файлу.
+     * @param cursor [in,out] Позиция чтения; обновляется после чтения.
+     * @param options Набор столбцов и диапазон дат (по умолчанию — все).
+     * @param complete Файл больше не дописывается: принять последнюю строку без '\n'.
+     * @return Количество добавленных записей и признак полной перезагрузки.
+     */
+    CSVAppendResult appendFromCSV(const string &filename, CSVCursor &cursor, const CSVLoadOptions &options = {},
+                                  bool complete = false);
+
+    /**
+     * @brief Дочитать CSV из несохраняемого потока (stdin, FIFO, распаковщик).
+     *
+     * Отдельный поток читает источник в кольцо из BufferRing::DEFAULT_BUFFER_COUNT
+     * буферов по bufferSize байт, текущий поток разбирает
+     * заполненные буферы. Строка, разорванная границей буфера, собирается в
+     * небольшом промежуточном буфере. Память, кроме самих записей, не
+     * зависит от объёма входных данных. Первая строка потока — заголовок.
+     *
+     * @param source Источник байтов.
+     * @param options Набор столбцов и диапазон дат.
+     * @param bufferSize Размер одного буфера кольца.
+     * @return Количество добавленных записей и признак ошибки чтения.
+     */
+    StreamLoadResult appendFromStream(const ByteSource &source, const CSVLoadOptions &options = {},
+                                      size_t bufferSize = BufferRing::DEFAULT_BUFFER_SIZE);
+
+    /**
+     * @brief Дочитать CSV из файлового дескриптора (например, 0 — stdin, или открытого FIFO).
+     *
+     * Дескриптор не закрывается.
+     *
+     * @param fd Файловый дескриптор, открытый на чтение.
+     * @param options Набор столбцов и диапазон дат.
+     * @return Количество добавленных записей и признак ошибки чтения.
+     */
+    StreamLoadResult appendFromFD(int fd, const CSVLoadOptions &options = {});
+
+    /**
+     * @brief Дочитать CSV из зашифрованного файла (любой формат SeedCryptor).
+     *
+     * Расшифровка выполняется в потоке-производителе appendFromStream: он
+     * расшифровывает очередную порцию прямо в буфер кольца (CBC — через
+     * промежуточный буфер расшифровщика), пока текущий поток разбирает
+     * предыдущую. Открытые данные существуют только в памяти и на диск не
+     * попадают. При ошибке расшифровки (неверный
+     * ключ, паддинг, CMAC порции) чтение прерывается с readError и
+     * описанием в error.
+     *
+     * @param filename Путь к зашифрованному файлу.
+     * @param cryptor Криптор с ключом.
+     * @param options Набор столбцов и диапазон дат.
+     * @return Количество добавленных записей и признак ошибки чтения или расшифровки.
+     */
+    StreamLoadResult appendFromEncrypted(const string &filename, const SeedCryptor &cryptor,
+                                         const CSVLoadOptions &options = {});
+
+    /**
+     * @brief Дочитать из зашифрованного файла с порциями только записи из диапазона дат.
+     *
+     * Для файла формата CipherMode::Chunked, упорядоченного по дате (как
+     * исходные выгрузки), расшифровываются и проверяются только порции,
+     * покрывающие options.from..options.to: первая нужная порция находится
+     * двоичным поиском по дате первой полной строки порции, чтение
+     * прекращается после первой строки позже options.to. Если диапазон дат
+     * не задан, файл другого формата или в прочитанных строках даты идут не
+     * по порядку, файл читается целиком через appendFromEncrypted.
+     *
+     * @param filename Путь к зашифрованному файлу.
+     * @param cryptor Криптор с ключом.
+     * @param options Набор столбцов и диапазон дат.
+     * @return Количество добавленных записей и признак ошибки чтения или расшифровки.
+     */
+    StreamLoadResult appendDateRangeFromEncrypted(const string &filename, const SeedCryptor &cryptor,
+                                                  const CSVLoadOptions &options);
+
+    /**
+     * @brief Загрузить набор данных из CSV, используя бинарный снимок как кэш.
+     *
+     * Если снимок snapshotPath существует, корректен и был построен из файла
+     * того же размера и с тем же временем изменения, записи читаются из снимка
+     * без разбора текста. Иначе CSV разбирается через fromCSV, а снимок
+     * перестраивается. Если CSV был только дописан, загружается снимок,
+     * дочитываются новые байты (см. appendFromCSV) и снимок обновляется.
+     * Снимок и курсор покрывают только строки, завершённые переводом строки.
+     *
+     * @param filename Путь к CSV-файлу.
+     * @param snapshotPath Путь к файлу бинарного снимка.
+     * @param cursor [out] Позиция чтения CSV после загрузки, если указатель не нулевой.
+     * @return true, если данные были загружены из снимка, false — если из CSV целиком.
+     */
+    bool fromCSVCached(const string &filename, const string &snapshotPath, CSVCursor *cursor = nullptr);
+
+    /**
+     * @brief Сохранить набор данных в бинарный поколоночный снимок.
+     *
+     * Подробности формата — в DatasetSnapshot.h.
+     *
+     * @param path Путь к файлу снимка.
+     * @return true при успешном сохранении.
+     */
+    [[nodiscard]] bool saveSnapshot(const string &path) const;
+
+    /**
+     * @brief Загрузить набор данных из бинарного поколоночного снимка.
+     *
+     * При ошибке (нет файла, неверная версия или контрольная сумма) набор
+     * данных не изменяется.
+     *
+     * @param path Путь к файлу снимка.
+     * @return true при успешной загрузке.
+     */
+    [[nodiscard]] bool loadSnapshot(const string &path);
+
+    /**
+     * @brief Найти записи с датой в диапазоне [from, to] двоичным поиском.
+     *
+     * Записи должны быть упорядочены по дате (как в исходных выгрузках).
+     * Сложность O(log n), данные не копируются.
+     *
+     * @param from Начало диапазона (включительно).
+     * @param to Конец диапазона (включительно).
+     * @return Непрерывный диапазон записей внутри набора.
+     */
+    [[nodiscard]] span<const DatasetValue> sliceByDate(time_t from, time_t to) const;
+
+    /**
+     * @brief Оставить в наборе только записи с датой в диапазоне [from, to].
+     *
+     * Записи должны быть упорядочены по дате.
+     *
+     * @param from Начало диапазона (включительно).
+     * @param to Конец диапазона (включительно).
+     */
+    void retainDateRange(time_t from, time_t to);
+
+    /**
+     * @brief Проверить, что даты записей не убывают.
+     *
+     * Повторы дат допускаются. На этом порядке основаны sliceByDate,
+     * retainDateRange, findGaps и fillGaps.
+     */
+    [[nodiscard]] bool isSortedByDate() const;
+
+    /**
+     * @brief Найти пропущенные дни.
+     *
+     * Пропуском считаются только дни между строго возрастающими соседними
+     * датами; повторы дат пропуском не считаются. Если даты где-то убывают
+     * (например, запись с нулевой датой посреди ряда), пропуски не
+     * определены и возвращается пустой вектор — см. isSortedByDate.
+     *
+     * @return Пропуски по возрастанию дат.
+     */
+    [[nodiscard]] vector<DateGap> findGaps() const;
+
+    /**
+     * @brief Заполнить пропущенные дни, чтобы ряд шёл с шагом в один день.
+     *
+     * exponentialSmoothing считает наблюдения равноотстоящими, и пропуск дня
+     * сдвигает сезонную фазу. Метрики добавленных записей вычисляются
+     * выбранным методом, название и номер дня недели — по дате (если столбец
+     * дня не загружался, название остаётся пустым). Записи должны быть
+     * упорядочены по дате: если даты где-то убывают, набор не изменяется и
+     * в результате выставляется unsorted, иначе одна ошибочная дата
+     * породила бы тысячи выдуманных записей.
+     *
+     * Сначала один проход считает количество пропущенных дней; если их нет,
+     * набор не изменяется. Иначе память под итоговый ряд выделяется один раз.
+     *
+     * @param method Способ заполнения.
+     * @param seasonLength Длина сезона для ImputeMethod::SeasonalNaive.
+     * @return Заполненные пропуски и количество добавленных записей.
+     */
+    GapFillResult fillGaps(ImputeMethod method = ImputeMethod::SeasonalNaive, int seasonLength = 7);
+
     /**
      * @brief Вернуть количество записей в наборе данных.
      *
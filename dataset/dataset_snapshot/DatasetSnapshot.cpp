@@ -0,0 +1,323 @@
+#include "DatasetSnapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "forecast_utils.h"
+#include "output_file.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * Заголовок снимка фиксированной длины (64 байта).
+     */
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t columnCount;
+        uint64_t rowCount;
+        uint64_t sourceSize;
+        int64_t sourceMtimeNs;
+        uint64_t checksum;
+        uint64_t csvOffset;
+        uint64_t csvTailChecksum;
+    };
+    static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader must be 64 bytes");
+    static_assert(sizeof(SnapshotColumnInfo) == 40, "SnapshotColumnInfo must be 40 bytes");
+
+    uint64_t zigzagEncode(const int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    int64_t zigzagDecode(const uint64_t v) {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    void writeVarint(vector<unsigned char> &out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(v));
+    }
+
+    /**
+     * Читает varint из [pos, end). При выходе за границы возвращает false.
+     */
+    bool readVarint(const unsigned char *&pos, const unsigned char *end, uint64_t &v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+            const unsigned char byte = *pos++;
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Значение числового столбца строки (дата — в днях с начала эпохи).
+     */
+    int64_t columnValue(const DatasetValue &row, const DatasetColumn column) {
+        switch (column) {
+            case DatasetColumn::DayOfWeek: return row.getDayOfWeek();
+            case DatasetColumn::Date: return timeTToDays(row.getDate());
+            case DatasetColumn::PageLoads: return row.getPageLoads();
+            case DatasetColumn::UniqueVisitors: return row.getUniqueVisitors();
+            case DatasetColumn::FirstTimeVisitors: return row.getFirstTimeVisitors();
+            case DatasetColumn::ReturningVisitors: return row.getReturningVisitors();
+            case DatasetColumn::Day: break;
+        }
+        return 0;
+    }
+
+    /**
+     * Кодирует столбец названий дней словарём.
+     */
+    void encodeDayColumn(const vector<DatasetValue> &rows, vector<unsigned char> &out) {
+        vector<string> dictionary;
+        vector<uint64_t> indices;
+        indices.reserve(rows.size());
+        for (const auto &row : rows) {
+            size_t idx = 0;
+            while (idx < dictionary.size() && dictionary[idx] != row.getDay()) ++idx;
+            if (idx == dictionary.size()) dictionary.push_back(row.getDay());
+            indices.push_back(idx);
+        }
+
+        writeVarint(out, dictionary.size());
+        for (const auto &word : dictionary) {
+            writeVarint(out, word.size());
+            out.insert(out.end(), word.begin(), word.end());
+        }
+        for (const uint64_t idx : indices) writeVarint(out, idx);
+    }
+
+    /**
+     * Отображение файла в память только для чтения (RAII).
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const string &path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st{};
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    _data = static_cast<const unsigned char *>(p);
+                    _size = static_cast<size_t>(st.st_size);
+                }
+            }
+            ::close(fd);
+        }
+
+        ~MappedFile() {
+            if (_data) ::munmap(const_cast<unsigned char *>(_data), _size);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] const unsigned char *data() const { return _data; }
+        [[nodiscard]] size_t size() const { return _size; }
+
+    private:
+        const unsigned char *_data = nullptr;
+        size_t _size = 0;
+    };
+
+    /**
+     * Проверяет заголовок: магическое значение, версию и количество столбцов.
+     */
+    bool readHeader(const unsigned char *data, const size_t size, SnapshotHeader &header) {
+        if (size < sizeof(SnapshotHeader)) return false;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, DatasetSnapshot::MAGIC.data(), DatasetSnapshot::MAGIC.size()) != 0) return false;
+        if (header.version != DatasetSnapshot::VERSION) return false;
+        if (header.columnCount != DATASET_COLUMN_COUNT) return false;
+        return size >= sizeof(SnapshotHeader) + header.columnCount * sizeof(SnapshotColumnInfo);
+    }
+}
+
+bool DatasetSnapshot::save(const Dataset &dataset, const string &path, const SnapshotSource &source) {
+    const auto &rows = dataset.getRows();
+
+    // Кодируем каждый столбец в отдельный буфер
+    array<vector<unsigned char>, DATASET_COLUMN_COUNT> blobs;
+    array<SnapshotColumnInfo, DATASET_COLUMN_COUNT> directory{};
+    for (size_t c = 0; c < DATASET_COLUMN_COUNT; ++c) {
+        const auto column = static_cast<DatasetColumn>(c);
+        auto &info = directory[c];
+        info.column = static_cast<uint32_t>(c);
+
+        if (column == DatasetColumn::Day) {
+            info.encoding = static_cast<uint32_t>(SnapshotEncoding::Dictionary);
+            encodeDayColumn(rows, blobs[c]);
+            continue;
+        }
+
+        const bool delta = column != DatasetColumn::DayOfWeek;
+        info.encoding = static_cast<uint32_t>(delta ? SnapshotEncoding::DeltaVarint : SnapshotEncoding::Varint);
+        info.min = rows.empty() ? 0 : numeric_limits<int64_t>::max();
+        info.max = rows.empty() ? 0 : numeric_limits<int64_t>::min();
+        blobs[c].reserve(rows.size() * 2);
+
+        int64_t previous = 0;
+        for (const auto &row : rows) {
+            const int64_t v = columnValue(row, column);
+            info.min = min(info.min, v);
+            info.max = max(info.max, v);
+            writeVarint(blobs[c], zigzagEncode(delta ? v - previous : v));
+            previous = v;
+        }
+    }
+
+    uint64_t offset = sizeof(SnapshotHeader) + sizeof(directory);
+    for (size_t c = 0; c < DATASET_COLUMN_COUNT; ++c) {
+        directory[c].offset = offset;
+        directory[c].length = blobs[c].size();
+        offset += blobs[c].size();
+    }
+
+    // Всё, что идёт после заголовка, покрывается контрольной суммой
+    vector<unsigned char> body(sizeof(directory));
+    memcpy(body.data(), directory.data(), sizeof(directory));
+    body.reserve(offset - sizeof(SnapshotHeader));
+    for (const auto &blob : blobs) body.insert(body.end(), blob.begin(), blob.end());
+
+    SnapshotHeader header{};
+    memcpy(header.magic, MAGIC.data(), MAGIC.size());
+    header.version = VERSION;
+    header.columnCount = DATASET_COLUMN_COUNT;
+    header.rowCount = rows.size();
+    header.sourceSize = source.size;
+    header.sourceMtimeNs = source.mtimeNs;
+    header.csvOffset = source.cursor.offset;
+    header.csvTailChecksum = source.cursor.tailChecksum;
+    header.checksum = fnv1a64(body.data(), body.size());
+
+    // Уникальный временный файл, fsync и переименование — как у файла прогноза
+    AtomicOutputFile file(path);
+    const string_view parts[] = {
+        string_view(reinterpret_cast<const char *>(&header), sizeof(header)),
+        string_view(reinterpret_cast<const char *>(body.data()), body.size())
+    };
+    return file.write(parts) && file.commit();
+}
+
+bool DatasetSnapshot::load(const string &path, Dataset &dataset, SnapshotSource *source) {
+    const MappedFile file(path);
+    SnapshotHeader header{};
+    if (!file.data() || !readHeader(file.data(), file.size(), header)) return false;
+
+    const unsigned char *body = file.data() + sizeof(SnapshotHeader);
+    const size_t bodySize = file.size() - sizeof(SnapshotHeader);
+    if (fnv1a64(body, bodySize) != header.checksum) return false;
+
+    // Заголовок не покрыт контрольной суммой: rowCount ограничивается длинами
+    // столбцов (на каждое значение приходится хотя бы один байт varint) до выделения памяти
+    array<SnapshotColumnInfo, DATASET_COLUMN_COUNT> directory{};
+    memcpy(directory.data(), body, sizeof(directory));
+    for (const auto &info : directory) {
+        if (info.column >= DATASET_COLUMN_COUNT) return false;
+        if (info.offset > file.size() || info.length > file.size() - info.offset) return false;
+        if (header.rowCount > info.length) return false;
+    }
+
+    // Декодируем числовые столбцы в плотные массивы
+    const size_t rowCount = header.rowCount;
+    array<vector<int64_t>, DATASET_COLUMN_COUNT> values;
+    vector<string> dictionary;
+    vector<uint64_t> dayIndices;
+    for (const auto &info : directory) {
+        const unsigned char *pos = file.data() + info.offset;
+        const unsigned char *end = pos + info.length;
+
+        if (info.encoding == static_cast<uint32_t>(SnapshotEncoding::Dictionary)) {
+            uint64_t words = 0;
+            if (!readVarint(pos, end, words) || words > info.length) return false;
+            dictionary.reserve(words);
+            for (uint64_t w = 0; w < words; ++w) {
+                uint64_t len = 0;
+                if (!readVarint(pos, end, len) || len > static_cast<uint64_t>(end - pos)) return false;
+                dictionary.emplace_back(reinterpret_cast<const char *>(pos), len);
+                pos += len;
+            }
+            dayIndices.resize(rowCount);
+            for (size_t i = 0; i < rowCount; ++i) {
+                if (!readVarint(pos, end, dayIndices[i]) || dayIndices[i] >= dictionary.size()) return false;
+            }
+            continue;
+        }
+
+        const bool delta = info.encoding == static_cast<uint32_t>(SnapshotEncoding::DeltaVarint);
+        auto &column = values[info.column];
+        column.resize(rowCount);
+        int64_t previous = 0;
+        for (size_t i = 0; i < rowCount; ++i) {
+            uint64_t raw = 0;
+            if (!readVarint(pos, end, raw)) return false;
+            const int64_t v = zigzagDecode(raw);
+            column[i] = delta ? previous + v : v;
+            previous = column[i];
+        }
+    }
+    if (dayIndices.size() != rowCount) return false;
+    for (size_t c = 0; c < DATASET_COLUMN_COUNT; ++c) {
+        if (c != static_cast<size_t>(DatasetColumn::Day) && values[c].size() != rowCount) return false;
+    }
+
+    const auto col = [&values](DatasetColumn c, const size_t i) {
+        return values[static_cast<size_t>(c)][i];
+    };
+    vector<DatasetValue> rows;
+    rows.reserve(rowCount);
+    for (size_t i = 0; i < rowCount; ++i) {
+        rows.emplace_back(
+            dictionary[dayIndices[i]],
+            static_cast<int>(col(DatasetColumn::DayOfWeek, i)),
+            daysToTimeT(col(DatasetColumn::Date, i)),
+            static_cast<int>(col(DatasetColumn::PageLoads, i)),
+            static_cast<int>(col(DatasetColumn::UniqueVisitors, i)),
+            static_cast<int>(col(DatasetColumn::FirstTimeVisitors, i)),
+            static_cast<int>(col(DatasetColumn::ReturningVisitors, i))
+        );
+    }
+
+    dataset.setRows(std::move(rows));
+    if (source) {
+        source->size = header.sourceSize;
+        source->mtimeNs = header.sourceMtimeNs;
+        source->cursor = CSVCursor{header.csvOffset, header.csvTailChecksum};
+    }
+    return true;
+}
+
+bool DatasetSnapshot::readSource(const string &path, SnapshotSource &source) {
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    SnapshotHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (file.gcount() != sizeof(header)) return false;
+    if (memcmp(header.magic, MAGIC.data(), MAGIC.size()) != 0 || header.version != VERSION) return false;
+    source.size = header.sourceSize;
+    source.mtimeNs = header.sourceMtimeNs;
+    source.cursor = CSVCursor{header.csvOffset, header.csvTailChecksum};
+    return true;
+}
+
+bool DatasetSnapshot::statSource(const string &path, SnapshotSource &source) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) return false;
+    source.size = static_cast<uint64_t>(st.st_size);
+    source.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef TRAFFIC_FORECAST_DATASET_SNAPSHOT_H
+#define TRAFFIC_FORECAST_DATASET_SNAPSHOT_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "Dataset.h"
+
+using namespace std;
+
+/**
+ * @brief Сведения об исходном CSV-файле, из которого построен снимок.
+ *
+ * По ним определяется, устарел ли снимок.
+ */
+struct SnapshotSource {
+    uint64_t size = 0;     ///< Размер файла в байтах
+    int64_t mtimeNs = 0;   ///< Время последнего изменения, наносекунды с начала эпохи
+    CSVCursor cursor{};    ///< Позиция, до которой CSV был прочитан при построении снимка
+
+    /**
+     * @brief Совпадают ли размер и время изменения файла.
+     */
+    [[nodiscard]] bool sameFile(const SnapshotSource &other) const {
+        return size == other.size && mtimeNs == other.mtimeNs;
+    }
+};
+
+/**
+ * @brief Описание одного столбца в снимке.
+ */
+struct SnapshotColumnInfo {
+    uint32_t column;   ///< Идентификатор столбца (значение DatasetColumn)
+    uint32_t encoding; ///< Способ кодирования (SnapshotEncoding)
+    uint64_t offset;   ///< Смещение данных столбца от начала файла
+    uint64_t length;   ///< Длина данных столбца в байтах
+    int64_t min;       ///< Минимальное значение столбца (для даты — в днях)
+    int64_t max;       ///< Максимальное значение столбца (для даты — в днях)
+};
+
+/**
+ * @brief Способы кодирования столбцов снимка.
+ */
+enum class SnapshotEncoding : uint32_t {
+    Dictionary = 0,  ///< Словарь строк + varint-индекс на каждую строку
+    Varint = 1,      ///< Zigzag-varint каждого значения
+    DeltaVarint = 2  ///< Zigzag-varint разности с предыдущим значением
+};
+
+/**
+ * @brief Бинарный поколоночный снимок набора данных.
+ *
+ * Формат (little-endian):
+ * - заголовок фиксированной длины: магическое значение "TFSNAP", версия,
+ *   количество столбцов и строк, размер и время изменения исходного CSV,
+ *   контрольная сумма FNV-1a (64 бит) всего, что следует за заголовком,
+ *   позиция прочитанной части CSV и контрольная сумма её хвоста (CSVCursor);
+ * - каталог столбцов: SnapshotColumnInfo на каждый столбец;
+ * - данные столбцов. Даты хранятся в днях с начала эпохи, даты и метрики
+ *   кодируются как delta + zigzag varint, день недели — как varint,
+ *   название дня — словарём.
+ *
+ * Загрузка выполняется через mmap: файл отображается в память и столбцы
+ * декодируются прямо из отображения, без разбора текста.
+ */
+class DatasetSnapshot {
+public:
+    /// Магическое значение в начале файла
+    static constexpr array<char, 8> MAGIC = {'T', 'F', 'S', 'N', 'A', 'P', '\0', '\0'};
+    /// Текущая версия формата
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @brief Сохранить набор данных в снимок.
+     *
+     * Файл записывается через AtomicOutputFile: во временный файл с
+     * уникальным именем рядом с path, который сбрасывается на диск и затем
+     * атомарно переименовывается.
+     *
+     * @param dataset Набор данных.
+     * @param path Путь к файлу снимка.
+     * @param source Сведения об исходном CSV (нули, если источника нет).
+     * @return true при успешном сохранении.
+     */
+    static bool save(const Dataset &dataset, const string &path, const SnapshotSource &source = {});
+
+    /**
+     * @brief Загрузить набор данных из снимка через mmap.
+     *
+     * @param path Путь к файлу снимка.
+     * @param dataset [out] Набор данных; изменяется только при успехе.
+     * @param source [out] Сведения об исходном CSV, если указатель не нулевой.
+     * @return true при успешной загрузке и совпадении контрольной суммы.
+     */
+    static bool load(const string &path, Dataset &dataset, SnapshotSource *source = nullptr);
+
+    /**
+     * @brief Прочитать только сведения об исходном CSV из заголовка снимка.
+     *
+     * @param path Путь к файлу снимка.
+     * @param source [out] Сведения об исходном CSV.
+     * @return true, если файл существует и имеет заголовок поддерживаемой версии.
+     */
+    static bool readSource(const string &path, SnapshotSource &source);
+
+    /**
+     * @brief Получить размер и время изменения файла.
+     *
+     * @param path Путь к файлу.
+     * @param source [out] Сведения о файле.
+     * @return true, если файл существует.
+     */
+    static bool statSource(const string &path, SnapshotSource &source);
+};
+
+#endif
@@ -1,7 +1,20 @@
 #include "DatasetValue.h"
-#include <sstream>
 #include <ctime>
-#include "forecast_utils.h"
+
+namespace {
+    /**
+     * Разбирает числовое поле через parseNumber. При ошибке возвращает 0 и,
+     * если в status ещё нет ошибки, записывает в него код результата.
+     */
+    int parseField(const string &s, ParseStatus *status) {
+        int value = 0;
+        if (const ParseStatus result = parseNumber(s, value); result != ParseStatus::Ok) {
+            if (status && *status == ParseStatus::Ok) *status = result;
+            return 0;
+        }
+        return value;
+    }
+}
 
 /**
  * Полный конструктор: дата и числовые поля как значения.
@@ -33,28 +46,23 @@ DatasetValue::DatasetValue(const string &_day, int _dayOfWeek, const string &_da
  * Конструктор, где числовые поля передаются как строки с запятыми (например "1,234").
  * Дата передаётся как time_t.
  */
-DatasetValue::DatasetValue(const string &_day, int _dayOfWeek, time_t _date, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr) {
+DatasetValue::DatasetValue(const string &_day, int _dayOfWeek, time_t _date, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr, ParseStatus *status) {
+    if (status) *status = ParseStatus::Ok;
     day = _day;
     dayOfWeek = _dayOfWeek;
     date = _date;
-    pageLoads = parseNumberString(_pageLoadsStr);
-    uniqueVisitors = parseNumberString(_uniqueVisitorsStr);
-    firstTimeVisitors = parseNumberString(_firstTimeVisitorsStr);
-    returningVisitors = parseNumberString(_returningVisitorsStr);
+    pageLoads = parseField(_pageLoadsStr, status);
+    uniqueVisitors = parseField(_uniqueVisitorsStr, status);
+    firstTimeVisitors = parseField(_firstTimeVisitorsStr, status);
+    returningVisitors = parseField(_returningVisitorsStr, status);
 }
 
 /**
  * Конструктор, где и дата, и числовые поля передаются в виде строк.
  * Дата — "MM/DD/YYYY", числа — возможно с запятыми.
  */
-DatasetValue::DatasetValue(const string &_day, int _dayOfWeek, const string &_dateStr, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr) {
-    day = _day;
-    dayOfWeek = _dayOfWeek;
-    date = parseDateString(_dateStr);
-    pageLoads = parseNumberString(_pageLoadsStr);
-    uniqueVisitors = parseNumberString(_uniqueVisitorsStr);
-    firstTimeVisitors = parseNumberString(_firstTimeVisitorsStr);
-    returningVisitors = parseNumberString(_returningVisitorsStr);
+DatasetValue::DatasetValue(const string &_day, int _dayOfWeek, const string &_dateStr, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr, ParseStatus *status)
+    : DatasetValue(_day, _dayOfWeek, parseDateString(_dateStr), _pageLoadsStr, _uniqueVisitorsStr, _firstTimeVisitorsStr, _returningVisitorsStr, status) {
 }
 
 /** @return название дня (ссылка на внутреннюю строку) */
@@ -77,46 +85,35 @@ void DatasetValue::setDay(const string &d) { day = d; }
 /** Устанавливает номер дня недели. */
 void DatasetValue::setDayOfWeek(const int d) { dayOfWeek = d; }
 /** Устанавливает номер дня недели из строки (поддерживает запятые). */
-void DatasetValue::setDayOfWeek(const string &d) { dayOfWeek = parseNumberString(d); }
+ParseStatus DatasetValue::setDayOfWeek(const string &d) { return parseNumber(d, dayOfWeek); }
 /** Устанавливает дату (time_t). */
 void DatasetValue::setDate(time_t d) { date = d; }
 /** Устанавливает количество загрузок страниц. */
 void DatasetValue::setPageLoads(const int v) { pageLoads = v; }
 /** Устанавливает количество загрузок страниц из строки. */
-void DatasetValue::setPageLoads(const string &v) { pageLoads = parseNumberString(v); }
+ParseStatus DatasetValue::setPageLoads(const string &v) { return parseNumber(v, pageLoads); }
 /** Устанавливает количество уникальных посетителей. */
 void DatasetValue::setUniqueVisitors(const int v) { uniqueVisitors = v; }
 /** Устанавливает количество уникальных посетителей из строки. */
-void DatasetValue::setUniqueVisitors(const string &v) { uniqueVisitors = parseNumberString(v); }
+ParseStatus DatasetValue::setUniqueVisitors(const string &v) { return parseNumber(v, uniqueVisitors); }
 /** Устанавливает количество посетителей в первый раз. */
 void DatasetValue::setFirstTimeVisitors(const int v) { firstTimeVisitors = v; }
 /** Устанавливает количество посетителей в первый раз из строки. */
-void DatasetValue::setFirstTimeVisitors(const string &v) { firstTimeVisitors = parseNumberString(v); }
+ParseStatus DatasetValue::setFirstTimeVisitors(const string &v) { return parseNumber(v, firstTimeVisitors); }
 /** Устанавливает количество возвращающихся посетителей. */
 void DatasetValue::setReturningVisitors(const int v) { returningVisitors = v; }
 /** Устанавливает количество возвращающихся посетителей из строки. */
-void DatasetValue::setReturningVisitors(const string &v) { returningVisitors = parseNumberString(v); }
+ParseStatus DatasetValue::setReturningVisitors(const string &v) { return parseNumber(v, returningVisitors); }
 
 /** Оператор вывода для удобного логирования/отладки. Формат:
  * YYYY-MM-DD day dow=<n> pageLoads=<n> uniqueVisitors=<n> firstTimeVisitors=<n> returningVisitors=<n>
  */
 std::ostream& operator<<(std::ostream& os, const DatasetValue& dv) {
-    // format date as YYYY-MM-DD
+    // format date as YYYY-MM-DD (UTC, без обращения к базе часовых поясов)
     const time_t t = dv.getDate();
     if (t != 0) {
-        std::tm tm{};
-#ifdef _POSIX_VERSION
-        localtime_r(&t, &tm);
-#else
-        // fallback (not thread-safe) for non-POSIX
-        if (const std::tm *ptm = std::localtime(&t)) tm = *ptm;
-#endif
-        char buf[32];
-        if (std::strftime(buf, sizeof(buf), "%Y-%m-%d", &tm)) {
-            os << buf;
-        } else {
-            os << "0000-00-00";
-        }
+        char buf[FORMATTED_DATE_LENGTH];
+        os.write(buf, static_cast<std::streamsize>(formatDateISO(timeTToDays(t), buf)));
     } else {
         os << "0000-00-00";
     }
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <ostream>
+
+#include "forecast_utils.h"
+
 using namespace std;
 
 /**
@@ -32,6 +35,7 @@ public:
 
     /**
      * Конструктор, где дата передаётся строкой формата "MM/DD/YYYY", числовые поля — как int.
+     * Дата хранится как полночь указанного дня по UTC.
      * @param _day название дня
      * @param _dayOfWeek номер дня недели
      * @param _dateStr дата в виде строки "MM/DD/YYYY"
@@ -44,7 +48,8 @@ public:
 
     /**
      * Конструктор, где числовые поля передаются как строки с запятыми (например "1,234").
-     * Дата передаётся как time_t.
+     * Дата передаётся как time_t. Числа разбираются parseNumber; некорректное
+     * поле равно нулю, а код ошибки сообщается через status.
      * @param _day название дня
      * @param _dayOfWeek номер дня недели
      * @param _date значение time_t
@@ -52,14 +57,16 @@ public:
      * @param _uniqueVisitorsStr строковое представление уникальных посетителей
      * @param _firstTimeVisitorsStr строковое представление посетителей в первый раз
      * @param _returningVisitorsStr строковое представление возвращающихся посетителей
+     * @param status [out] если не нулевой: ParseStatus::Ok или код первого некорректного поля
      */
-    DatasetValue(const string &_day, int _dayOfWeek, time_t _date, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr);
+    DatasetValue(const string &_day, int _dayOfWeek, time_t _date, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr, ParseStatus *status = nullptr);
 
     /**
      * Конструктор, где и дата, и числовые поля передаются в виде строк.
-     * Дата — "MM/DD/YYYY", числа — возможно с запятыми.
+     * Дата — "MM/DD/YYYY", числа — возможно с запятыми; ошибки разбора чисел
+     * сообщаются через status, как в конструкторе с датой time_t.
      */
-    DatasetValue(const string &_day, int _dayOfWeek, const string &_dateStr, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr);
+    DatasetValue(const string &_day, int _dayOfWeek, const string &_dateStr, const string &_pageLoadsStr, const string &_uniqueVisitorsStr, const string &_firstTimeVisitorsStr, const string &_returningVisitorsStr, ParseStatus *status = nullptr);
 
     // Геттеры
     /** @return название дня (ссылка на внутреннюю строку) */
@@ -82,26 +89,41 @@ public:
     void setDay(const string &d);
     /** Устанавливает номер дня недели. */
     void setDayOfWeek(int d);
-    /** Устанавливает номер дня недели из строки (например "1"), поддерживает удаление запятых. */
-    void setDayOfWeek(const string &d);
+    /**
+     * Устанавливает номер дня недели из строки (например "1"), поддерживает удаление запятых.
+     * @return код результата разбора; при ошибке значение не изменяется.
+     */
+    ParseStatus setDayOfWeek(const string &d);
     /** Устанавливает дату (time_t). */
     void setDate(time_t d);
     /** Устанавливает количество загрузок страниц. */
     void setPageLoads(int v);
-    /** Устанавливает количество загрузок страниц из строки (например "1,234"). */
-    void setPageLoads(const string &v);
+    /**
+     * Устанавливает количество загрузок страниц из строки (например "1,234").
+     * @return код результата разбора; при ошибке значение не изменяется.
+     */
+    ParseStatus setPageLoads(const string &v);
     /** Устанавливает количество уникальных посетителей. */
     void setUniqueVisitors(int v);
-    /** Устанавливает количество уникальных посетителей из строки (например "1,234"). */
-    void setUniqueVisitors(const string &v);
+    /**
+     * Устанавливает количество уникальных посетителей из строки (например "1,234").
+     * @return код результата разбора; при ошибке значение не изменяется.
+     */
+    ParseStatus setUniqueVisitors(const string &v);
     /** Устанавливает количество посетителей в первый раз. */
     void setFirstTimeVisitors(int v);
-    /** Устанавливает количество посетителей в первый раз из строки (например "1,234"). */
-    void setFirstTimeVisitors(const string &v);
+    /**
+     * Устанавливает количество посетителей в первый раз из строки (например "1,234").
+     * @return код результата разбора; при ошибке значение не изменяется.
+     */
+    ParseStatus setFirstTimeVisitors(const string &v);
     /** Устанавливает количество возвращающихся посетителей. */
     void setReturningVisitors(int v);
-    /** Устанавливает количество возвращающихся посетителей из строки (например "1,234"). */
-    void setReturningVisitors(const string &v);
+    /**
+     * Устанавливает количество возвращающихся посетителей из строки (например "1,234").
+     * @return код результата разбора; при ошибке значение не изменяется.
+     */
+    ParseStatus setReturningVisitors(const string &v);
 };
 
 // Оператор вывода в поток для удобного логирования/отладки
@@ -0,0 +1,245 @@
+#include "SeriesSet.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include "arena.h"
+#include "executor.h"
+#include "forecast_utils.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * Строка длинного формата; site и metric ссылаются на буфер файла.
+     */
+    struct LongRow {
+        string_view site;
+        string_view metric;
+        int64_t days;
+        int value;
+    };
+
+    /**
+     * Ряд раздела до копирования в общие буферы: участок отсортированных строк раздела.
+     */
+    struct PartitionSeries {
+        size_t first;
+        size_t length;
+    };
+
+    /**
+     * Разбирает строку "site_id,date,metric,value". Окружающие кавычки и
+     * пробелы site и metric снимаются, чтобы "site-1" и site-1 были одним рядом.
+     */
+    bool parseLongRow(string_view line, LongRow &row) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        size_t pos = 0;
+        row.site = trimField(nextCSVField(line, pos));
+        if (pos > line.size() || row.site.empty()) return false;
+        const string_view date = nextCSVField(line, pos);
+        if (pos > line.size()) return false;
+        row.metric = trimField(nextCSVField(line, pos));
+        if (pos > line.size() || row.metric.empty()) return false;
+        const string_view value = nextCSVField(line, pos);
+        if (pos <= line.size()) return false; // лишние поля
+        return (parseDateMDY(date, row.days) || parseDateISO(date, row.days)) &&
+               parseNumber(value, row.value) == ParseStatus::Ok;
+    }
+
+    /**
+     * Хеш пары (сайт, метрика) для выбора раздела.
+     */
+    uint64_t seriesHash(const string_view site, const string_view metric) {
+        const uint64_t h = fnv1a64(site.data(), site.size());
+        return fnv1a64(metric.data(), metric.size(), h ^ 0x2c);
+    }
+}
+
+/**
+ * @brief Загрузить ряды из файла в длинном формате.
+ *
+ * Три фазы:
+ * 1. файл делится на threads участков по границам строк; каждый участок —
+ *    задача общего исполнителя, которая разбирает его и раскладывает строки по threads разделам
+ *    по хешу (сайт, метрика) — строки одного ряда попадают в один раздел;
+ * 2. задача раздела забирает его строки из всех участков (в порядке файла),
+ *    устойчиво сортирует по (сайт, метрика, дата) и убирает повторы дат,
+ *    оставляя последнее значение;
+ * 3. ряды всех разделов упорядочиваются по (сайт, метрика) и копируются
+ *    в общие буферы.
+ */
+LongCSVLoadResult SeriesSet::fromLongCSV(const string &filename, unsigned threads) {
+    LongCSVLoadResult result;
+    clear();
+
+    string content;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            result.opened = false;
+            return result;
+        }
+        file.seekg(0, std::ios::end);
+        content.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(content.data(), static_cast<streamsize>(content.size()));
+        content.resize(static_cast<size_t>(file.gcount()));
+    }
+
+    // Первая строка — заголовок
+    const string_view data(content);
+    const size_t headerEnd = data.find('\n');
+    const size_t bodyStart = headerEnd == string_view::npos ? data.size() : headerEnd + 1;
+
+    if (threads == 0) threads = Executor::global().concurrency();
+    // Не дробим мелкие файлы: участок не меньше 64 КиБ
+    threads = static_cast<unsigned>(clamp<size_t>((data.size() - bodyStart) / (64 << 10), 1, threads));
+    const size_t parts = threads;
+
+    // Границы участков выравниваются на начало строки
+    vector<size_t> bounds(parts + 1, data.size());
+    bounds[0] = bodyStart;
+    for (size_t i = 1; i < parts; ++i) {
+        const size_t guess = max(bounds[i - 1], bodyStart + (data.size() - bodyStart) * i / parts);
+        const size_t eol = data.find('\n', guess);
+        bounds[i] = eol == string_view::npos ? data.size() : eol + 1;
+    }
+
+    // Фаза 1: разбор участков и раскладка по разделам. Промежуточные списки
+    // каждого участка растут в арене своего потока и освобождаются разом после фазы 2
+    vector<unique_ptr<Arena>> arenas(parts);
+    vector<vector<pmr::vector<LongRow>>> routed(parts);
+    vector<size_t> malformed(parts, 0);
+    parallelFor(0, parts, [&](const size_t chunk) {
+        arenas[chunk] = make_unique<Arena>("series_set.routing");
+        auto &out = routed[chunk];
+        out.reserve(parts);
+        for (size_t p = 0; p < parts; ++p) out.emplace_back(arenas[chunk].get());
+        size_t pos = bounds[chunk];
+        while (pos < bounds[chunk + 1]) {
+            size_t eol = data.find('\n', pos);
+            if (eol == string_view::npos || eol > bounds[chunk + 1]) eol = bounds[chunk + 1];
+            const string_view line = data.substr(pos, eol - pos);
+            pos = eol + 1;
+            if (line.empty() || line == "\r") continue;
+
+            LongRow row{};
+            if (!parseLongRow(line, row)) {
+                ++malformed[chunk];
+                continue;
+            }
+            out[seriesHash(row.site, row.metric) % parts].push_back(row);
+        }
+    }, 1);
+
+    // Фаза 2: группировка и сортировка каждого раздела
+    vector<vector<LongRow>> partitions(parts);
+    vector<vector<PartitionSeries>> partitionSeries(parts);
+    vector<size_t> duplicates(parts, 0);
+    parallelFor(0, parts, [&](const size_t p) {
+        auto &rows = partitions[p];
+        size_t total = 0;
+        for (size_t chunk = 0; chunk < parts; ++chunk) total += routed[chunk][p].size();
+        rows.reserve(total);
+        for (size_t chunk = 0; chunk < parts; ++chunk) {
+            rows.insert(rows.end(), routed[chunk][p].begin(), routed[chunk][p].end());
+        }
+
+        stable_sort(rows.begin(), rows.end(), [](const LongRow &a, const LongRow &b) {
+            if (a.site != b.site) return a.site < b.site;
+            if (a.metric != b.metric) return a.metric < b.metric;
+            return a.days < b.days;
+        });
+
+        // Повтор даты: остаётся последнее по файлу значение (оно последнее после устойчивой сортировки)
+        size_t out = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (out > 0 && rows[out - 1].site == rows[i].site && rows[out - 1].metric == rows[i].metric &&
+                rows[out - 1].days == rows[i].days) {
+                rows[out - 1] = rows[i];
+                ++duplicates[p];
+                continue;
+            }
+            rows[out++] = rows[i];
+        }
+        rows.resize(out);
+
+        auto &found = partitionSeries[p];
+        for (size_t i = 0; i < rows.size();) {
+            size_t j = i + 1;
+            while (j < rows.size() && rows[j].site == rows[i].site && rows[j].metric == rows[i].metric) ++j;
+            found.push_back(PartitionSeries{i, j - i});
+            i = j;
+        }
+    }, 1);
+
+    routed.clear();
+    arenas.clear();
+
+    // Фаза 3: общий порядок рядов и копирование в непрерывные буферы
+    struct SeriesRef {
+        size_t partition;
+        PartitionSeries range;
+    };
+    vector<SeriesRef> order;
+    for (size_t p = 0; p < parts; ++p) {
+        for (const auto &range : partitionSeries[p]) order.push_back(SeriesRef{p, range});
+    }
+    sort(order.begin(), order.end(), [&](const SeriesRef &a, const SeriesRef &b) {
+        const LongRow &x = partitions[a.partition][a.range.first];
+        const LongRow &y = partitions[b.partition][b.range.first];
+        return x.site != y.site ? x.site < y.site : x.metric < y.metric;
+    });
+
+    size_t totalRows = 0;
+    for (const auto &ref : order) totalRows += ref.range.length;
+    dates.resize(totalRows);
+    values.resize(totalRows);
+    series.reserve(order.size());
+    size_t offset = 0;
+    for (const auto &ref : order) {
+        const LongRow *rows = partitions[ref.partition].data() + ref.range.first;
+        series.push_back(SeriesInfo{string(rows[0].site), string(rows[0].metric), offset, ref.range.length});
+        for (size_t i = 0; i < ref.range.length; ++i) {
+            dates[offset + i] = daysToTimeT(rows[i].days);
+            values[offset + i] = rows[i].value;
+        }
+        offset += ref.range.length;
+    }
+
+    result.rows = totalRows;
+    for (size_t p = 0; p < parts; ++p) {
+        result.malformed += malformed[p];
+        result.duplicates += duplicates[p];
+    }
+    result.rows += result.duplicates;
+    return result;
+}
+
+SeriesView SeriesSet::operator[](const size_t index) const {
+    const SeriesInfo &info = series[index];
+    return SeriesView{
+        info.site,
+        info.metric,
+        span<const time_t>(dates).subspan(info.offset, info.length),
+        span<const int>(values).subspan(info.offset, info.length)
+    };
+}
+
+optional<size_t> SeriesSet::find(const string_view site, const string_view metric) const {
+    const auto it = lower_bound(series.begin(), series.end(), pair{site, metric},
+        [](const SeriesInfo &info, const pair<string_view, string_view> &key) {
+            const int c = string_view(info.site).compare(key.first);
+            return c != 0 ? c < 0 : string_view(info.metric) < key.second;
+        });
+    if (it == series.end() || it->site != site || it->metric != metric) return nullopt;
+    return static_cast<size_t>(it - series.begin());
+}
+
+void SeriesSet::clear() {
+    series.clear();
+    dates.clear();
+    values.clear();
+}
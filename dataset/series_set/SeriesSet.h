@@ -0,0 +1,94 @@
+#ifndef TRAFFIC_FORECAST_SERIES_SET_H
+#define TRAFFIC_FORECAST_SERIES_SET_H
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Один временной ряд набора: участки общих буферов дат и значений.
+ */
+struct SeriesView {
+    string_view site;          ///< Идентификатор сайта
+    string_view metric;        ///< Название метрики
+    span<const time_t> dates;  ///< Даты, по возрастанию
+    span<const int> values;    ///< Значения; values[i] соответствует dates[i]
+};
+
+/**
+ * @brief Результат чтения файла в длинном формате.
+ */
+struct LongCSVLoadResult {
+    size_t rows = 0;        ///< Принято строк
+    size_t malformed = 0;   ///< Строк, которые не удалось разобрать
+    size_t duplicates = 0;  ///< Повторов (сайт, метрика, дата); остаётся последнее значение в файле
+    bool opened = true;     ///< Файл удалось открыть
+};
+
+/**
+ * @brief Набор временных рядов нескольких сайтов и метрик.
+ *
+ * Загружается из файлов в длинном формате "site_id,date,metric,value"
+ * (первая строка — заголовок, даты MM/DD/YYYY или YYYY-MM-DD). Все ряды
+ * хранятся в двух общих непрерывных буферах — даты и значения, — ряд
+ * занимает в них непрерывный участок. Поэтому SeriesView::values можно
+ * передавать в exponentialSmoothing и betterCoefficient без копирования.
+ *
+ * Ряды упорядочены по (site, metric), значения в ряду — по дате.
+ */
+class SeriesSet {
+    struct SeriesInfo {
+        string site;
+        string metric;
+        size_t offset;
+        size_t length;
+    };
+
+    vector<SeriesInfo> series;
+    vector<time_t> dates;
+    vector<int> values;
+
+public:
+    /**
+     * @brief Загрузить ряды из файла в длинном формате.
+     *
+     * Файл делится на участки по границам строк, участки разбираются
+     * параллельно; каждая строка отправляется в раздел по хешу пары
+     * (сайт, метрика). Затем разделы параллельно группируются и сортируются
+     * по дате, и ряды копируются в общие буферы — одна копия на значение.
+     *
+     * @param filename Путь к файлу.
+     * @param threads Количество участков и разделов (0 — по числу потоков общего исполнителя).
+     * @return Количество принятых, некорректных и повторных строк.
+     */
+    LongCSVLoadResult fromLongCSV(const string &filename, unsigned threads = 0);
+
+    /**
+     * @brief Количество рядов.
+     */
+    [[nodiscard]] size_t size() const { return series.size(); }
+
+    /**
+     * @brief Ряд по индексу (0 <= index < size()).
+     */
+    [[nodiscard]] SeriesView operator[](size_t index) const;
+
+    /**
+     * @brief Найти ряд по сайту и метрике двоичным поиском.
+     * @return Индекс ряда или nullopt.
+     */
+    [[nodiscard]] optional<size_t> find(string_view site, string_view metric) const;
+
+    /**
+     * @brief Удалить все ряды.
+     */
+    void clear();
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "executor.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    /// Исполнитель и номер очереди текущего рабочего потока (nullptr — поток не рабочий)
+    thread_local const Executor *currentExecutor = nullptr;
+    thread_local size_t currentQueue = 0;
+
+    mutex globalLock;
+    unique_ptr<Executor> globalExecutor;
+    unsigned globalThreads = 0;
+    bool globalPin = false;
+
+    /**
+     * Закрепляет поток за ядром cpu (по модулю числа ядер).
+     */
+    void pinToCore([[maybe_unused]] thread &worker, [[maybe_unused]] const size_t cpu) {
+#ifdef __linux__
+        const unsigned cores = max(1u, thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % cores, &set);
+        pthread_setaffinity_np(worker.native_handle(), sizeof(set), &set);
+#endif
+    }
+}
+
+Executor::Executor(unsigned threads, const bool pinThreads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    const size_t workerCount = threads - 1;
+    queues.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) queues.push_back(make_unique<Queue>());
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&Executor::workerLoop, this, i);
+        // Ядро 0 остаётся вызывающему потоку
+        if (pinThreads) pinToCore(workers.back(), i + 1);
+    }
+}
+
+Executor::~Executor() {
+    {
+        lock_guard guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+Executor &Executor::global() {
+    lock_guard guard(globalLock);
+    if (!globalExecutor) globalExecutor = make_unique<Executor>(globalThreads, globalPin);
+    return *globalExecutor;
+}
+
+void Executor::configureGlobal(const unsigned threads, const bool pinThreads) {
+    lock_guard guard(globalLock);
+    globalThreads = threads;
+    globalPin = pinThreads;
+    globalExecutor.reset();
+}
+
+/**
+ * Задача рабочего потока попадает в его собственную очередь, задача внешнего
+ * потока — в очереди рабочих по кругу.
+ */
+void Executor::push(Task task) {
+    const size_t index = currentExecutor == this
+        ? currentQueue
+        : nextQueue.fetch_add(1, memory_order_relaxed) % queues.size();
+    {
+        lock_guard guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard guard(sleepLock);
+        queued.fetch_add(1);
+    }
+    wake.notify_one();
+}
+
+/**
+ * Сначала своя очередь с конца, затем кража с начала остальных очередей.
+ */
+bool Executor::takeTask(Task &task) {
+    if (queued.load() == 0) return false;
+    const bool isWorker = currentExecutor == this;
+    const size_t start = isWorker ? currentQueue : 0;
+    if (isWorker) {
+        Queue &own = *queues[start];
+        lock_guard guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t step = isWorker ? 1 : 0; step < queues.size(); ++step) {
+        Queue &victim = *queues[(start + step) % queues.size()];
+        lock_guard guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Executor::tryRun() {
+    Task task;
+    if (!takeTask(task)) return false;
+    exception_ptr error;
+    try {
+        task.run();
+    } catch (...) {
+        error = current_exception();
+    }
+    task.group->finish(error);
+    return true;
+}
+
+void Executor::workerLoop(const size_t index) {
+    currentExecutor = this;
+    currentQueue = index;
+    while (true) {
+        if (tryRun()) continue;
+        unique_lock guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping) return;
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    // Задачи ссылаются на группу: нельзя уничтожить её раньше их завершения
+    while (pending.load() > 0) {
+        if (!executor.tryRun()) this_thread::yield();
+    }
+    // finish последней задачи мог ещё не отпустить мьютекс
+    lock_guard guard(lock);
+}
+
+void TaskGroup::run(function<void()> task) {
+    if (executor.workers.empty()) {
+        try {
+            task();
+        } catch (...) {
+            lock_guard guard(lock);
+            if (!firstError) firstError = current_exception();
+        }
+        return;
+    }
+    pending.fetch_add(1);
+    executor.push(Executor::Task{std::move(task), this});
+}
+
+void TaskGroup::finish(const exception_ptr error) {
+    lock_guard guard(lock);
+    if (error && !firstError) firstError = error;
+    if (pending.fetch_sub(1) == 1) done.notify_all();
+}
+
+/**
+ * Пока задачи группы не завершены, поток выполняет любые задачи из очередей;
+ * если очереди пусты (оставшиеся задачи группы уже выполняются другими
+ * потоками), ждёт их завершения с коротким таймаутом, чтобы успеть взять
+ * задачи, которые они поставят.
+ */
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (executor.tryRun()) continue;
+        unique_lock guard(lock);
+        done.wait_for(guard, chrono::microseconds(200), [this] { return pending.load() == 0; });
+    }
+    lock_guard guard(lock);
+    if (firstError) {
+        const exception_ptr error = firstError;
+        firstError = nullptr;
+        rethrow_exception(error);
+    }
+}
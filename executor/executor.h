@@ -0,0 +1,191 @@
+#ifndef TRAFFIC_FORECAST_EXECUTOR_H
+#define TRAFFIC_FORECAST_EXECUTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class TaskGroup;
+
+/**
+ * @brief Пул потоков с очередью на каждый поток и кражей задач.
+ *
+ * Каждый рабочий поток берёт задачи с конца своей очереди (последние
+ * поставленные — они ещё в кэше), а когда она пуста — крадёт с начала
+ * очереди другого потока. Очереди защищены мьютексами: задачи здесь
+ * крупные (файл, раздел, участок сетки коэффициентов), поэтому
+ * конкуренция за мьютекс несущественна.
+ *
+ * Поток, ожидающий группу задач (TaskGroup::wait), не простаивает, а
+ * выполняет задачи из очередей. Поэтому вложенные параллельные участки
+ * (parallelFor внутри задачи) не создают новых потоков и не блокируют
+ * рабочие потоки: общее число потоков всегда равно concurrency().
+ *
+ * Обычно используется общий исполнитель Executor::global(), размер
+ * которого задаётся параметром --threads.
+ */
+class Executor {
+public:
+    /**
+     * @param threads Общее число потоков вместе с вызывающим (0 — по числу ядер).
+     * При threads == 1 рабочих потоков нет и все задачи выполняются в вызывающем.
+     * @param pinThreads Закрепить рабочие потоки за ядрами (только Linux).
+     */
+    explicit Executor(unsigned threads = 0, bool pinThreads = false);
+    ~Executor();
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    /**
+     * @brief Общее число потоков, выполняющих задачи (рабочие + ожидающий).
+     */
+    [[nodiscard]] unsigned concurrency() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /**
+     * @brief Общий исполнитель процесса.
+     */
+    static Executor &global();
+
+    /**
+     * @brief Пересоздать общий исполнитель с заданным числом потоков.
+     *
+     * Вызывается до начала параллельной работы (например, после разбора аргументов);
+     * во время работы задач общего исполнителя вызывать нельзя.
+     */
+    static void configureGlobal(unsigned threads, bool pinThreads = false);
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        function<void()> run;
+        TaskGroup *group;
+    };
+
+    struct Queue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool tryRun();
+    bool takeTask(Task &task);
+    void workerLoop(size_t index);
+
+    vector<unique_ptr<Queue>> queues;   ///< Очередь каждого рабочего потока
+    vector<thread> workers;
+    atomic<size_t> queued{0};           ///< Задач в очередях
+    atomic<size_t> nextQueue{0};        ///< Очередь для задач из внешних потоков (по кругу)
+    mutex sleepLock;
+    condition_variable wake;
+    bool stopping = false;
+};
+
+/**
+ * @brief Группа задач, завершения которых можно дождаться.
+ *
+ * Первое исключение, выброшенное задачей, повторно выбрасывается из wait().
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(Executor &executor = Executor::global()) : executor(executor) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    /**
+     * @brief Поставить задачу в очередь (без рабочих потоков — выполнить сразу).
+     */
+    void run(function<void()> task);
+
+    /**
+     * @brief Дождаться всех задач группы, выполняя задачи из очередей.
+     */
+    void wait();
+
+private:
+    friend class Executor;
+
+    void finish(exception_ptr error);
+
+    Executor &executor;
+    atomic<size_t> pending{0};
+    mutex lock;
+    condition_variable done;
+    exception_ptr firstError;
+};
+
+/**
+ * @brief Размер участка по умолчанию: около четырёх участков на поток.
+ */
+inline size_t defaultGrain(const size_t count, const Executor &executor) {
+    return max<size_t>(1, count / (static_cast<size_t>(executor.concurrency()) * 4));
+}
+
+/**
+ * @brief Выполнить body(i) для всех i из [begin, end).
+ *
+ * Диапазон делится на участки по grain индексов (0 — defaultGrain), каждый
+ * участок — отдельная задача. Возвращает управление после выполнения всех
+ * участков; исключение из body выбрасывается повторно.
+ */
+template <typename Body>
+void parallelFor(const size_t begin, const size_t end, Body body, size_t grain = 0,
+                 Executor &executor = Executor::global()) {
+    if (begin >= end) return;
+    const size_t count = end - begin;
+    if (grain == 0) grain = defaultGrain(count, executor);
+    if (executor.concurrency() == 1 || count <= grain) {
+        for (size_t i = begin; i < end; ++i) body(i);
+        return;
+    }
+    TaskGroup group(executor);
+    for (size_t first = begin; first < end; first += grain) {
+        const size_t last = min(end, first + grain);
+        group.run([&body, first, last] {
+            for (size_t i = first; i < last; ++i) body(i);
+        });
+    }
+    group.wait();
+}
+
+/**
+ * @brief Свёртка по диапазону [begin, end).
+ *
+ * Диапазон делится на участки по grain индексов (0 — defaultGrain);
+ * map(first, last) вычисляет значение участка, затем значения участков
+ * сворачиваются reduce в порядке возрастания индексов, начиная с identity.
+ * Поэтому при фиксированном grain результат не зависит от числа потоков,
+ * даже если reduce не коммутативна (например, выбор минимума с
+ * предпочтением меньшего индекса).
+ */
+template <typename T, typename Map, typename Reduce>
+T parallelReduce(const size_t begin, const size_t end, T identity, Map map, Reduce reduce, size_t grain = 0,
+                 Executor &executor = Executor::global()) {
+    if (begin >= end) return identity;
+    const size_t count = end - begin;
+    if (grain == 0) grain = defaultGrain(count, executor);
+    const size_t chunks = (count + grain - 1) / grain;
+    vector<T> partial(chunks, identity);
+    parallelFor(0, chunks, [&](const size_t chunk) {
+        const size_t first = begin + chunk * grain;
+        partial[chunk] = map(first, min(end, first + grain));
+    }, 1, executor);
+    T result = std::move(identity);
+    for (auto &value : partial) result = reduce(std::move(result), std::move(value));
+    return result;
+}
+
+#endif
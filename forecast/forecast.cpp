@@ -2,101 +2,133 @@
 
 #include <cmath>
 #include <iostream>
+#include <memory_resource>
+#include "arena.h"
+#include "executor.h"
 #include "forecast_utils.h"
 
+namespace {
+    /// Кандидатов в сетке коэффициентов: alpha, beta, gamma от 0.1 до 0.9 с шагом 0.1
+    constexpr size_t GRID_CANDIDATES = 9 * 9 * 9;
+    /// Кандидатов в одной задаче подбора (фиксировано, чтобы разбиение не зависело от числа потоков)
+    constexpr size_t GRID_GRAIN = 27;
+
+    /**
+     * @brief Рекурсия exponentialSmoothing с прогнозом в forecastedValues.
+     *
+     * Компоненты сглаживания выделяются из resource: при подборе коэффициентов
+     * это арена, переиспользуемая между кандидатами.
+     */
+    template <typename Values>
+    void smoothInto(
+        const span<const int> y,
+        const double alpha,
+        const double beta,
+        const double gamma,
+        const int seasonLength,
+        const int forecastLength,
+        pmr::memory_resource *resource,
+        Values &forecastedValues
+    ) {
+        pmr::vector<SmoothingComponents> components(resource);
+        components.reserve(y.size() + static_cast<size_t>(max(forecastLength, 0)));
+
+        double startingTrend = 0.0;
+        double startingLevel = 0.0;
+        for (int t = seasonLength * 2 - 1; t >= 0; t--) {
+            if (t >= seasonLength) {
+                startingTrend += static_cast<double>(y[t]);
+            }
+            else {
+                startingTrend -= static_cast<double>(y[t]);
+                startingLevel += static_cast<double>(y[t]);
+            }
+        }
+        startingTrend /= static_cast<double>(seasonLength);
+        startingLevel /= static_cast<double>(seasonLength);
+        startingTrend = max(0.0, startingTrend);
+        startingLevel = max(0.0, startingLevel);
+
+        auto currentValue = static_cast<double>(y[0]);
+        const double zeroLevel = alpha * currentValue + (1 - alpha) * (startingLevel + startingTrend);
+        const double zeroTrend = beta * (zeroLevel - startingLevel) + (1 - beta) * startingTrend;
+        const double zeroSeason = gamma * (currentValue / zeroLevel) + (1 - gamma);
+
+        components.push_back(SmoothingComponents{
+            y[0],
+            zeroLevel,
+            zeroTrend,
+            zeroSeason
+        });
+
+        const size_t originalSize = y.size();
+        forecastedValues.reserve(forecastLength > 0 ? static_cast<size_t>(forecastLength) : 0);
+
+        for (size_t t = 1; t < originalSize + forecastLength; ++t) {
+            if (t < originalSize)
+                currentValue = static_cast<double>(y[t]);
+            else
+                currentValue = (components[t - 1].level + components[t - 1].trend) *
+                               (t - seasonLength > 0 ? components[t - seasonLength] : components[0]).season;
+
+            double level = alpha * (currentValue / (t >= seasonLength ? components[t - seasonLength]: components[0]).season) +
+                           (1 - alpha) * (components[t - 1].level + components[t - 1].trend);
+            level = max(0.0, level);
+
+            double trend = beta * (level - components[t - 1].level) +
+                           (1 - beta) * components[t - 1].trend;
+            trend = max(trend, 0.0);
+
+            double season = gamma * (currentValue / level) +
+                            (1 - gamma) * (t >= seasonLength ? components[t - seasonLength] : components[0]).season;
+            season = max(0.0, season);
+
+            int value = 0;
+            if (t >= originalSize) {
+                value = static_cast<int>(
+                    (level + trend) *
+                    (t - seasonLength + 1 > 0 ? components[t - seasonLength + 1] : components[0]).season
+                );
+
+                forecastedValues.push_back(value);
+            } else {
+                value = y[t];
+            }
+
+            components.push_back(SmoothingComponents(
+                value,
+                level,
+                trend,
+                season
+            ));
+        }
+    }
+}
+
 /**
  * @brief Выполняет экспоненциальное сглаживание с компонентами уровень/тренд/сезонность.
  *
  * Детальная реализация находится в заголовке. Функция рассчитывает начальные
  * значения уровня и тренда по первым 2*seasonLength точкам, затем итеративно
  * обновляет компоненты и формирует прогноз для forecastLength шагов.
+ * Промежуточные компоненты берутся из текущей арены потока, если она задана.
  */
 vector<int> exponentialSmoothing(
-    vector<int> y,
+    const span<const int> y,
     const double alpha,
     const double beta,
     const double gamma,
     const int seasonLength,
     const int forecastLength
 ) {
-    vector<SmoothingComponents> components;
-
-    double startingTrend = 0.0;
-    double startingLevel = 0.0;
-    for (int t = seasonLength * 2 - 1; t >= 0; t--) {
-        if (t >= seasonLength) {
-            startingTrend += static_cast<double>(y[t]);
-        }
-        else {
-            startingTrend -= static_cast<double>(y[t]);
-            startingLevel += static_cast<double>(y[t]);
-        }
-    }
-    startingTrend /= static_cast<double>(seasonLength);
-    startingLevel /= static_cast<double>(seasonLength);
-    startingTrend = max(0.0, startingTrend);
-    startingLevel = max(0.0, startingLevel);
-
-    auto currentValue = static_cast<double>(y[0]);
-    const double zeroLevel = alpha * currentValue + (1 - alpha) * (startingLevel + startingTrend);
-    const double zeroTrend = beta * (zeroLevel - startingLevel) + (1 - beta) * startingTrend;
-    const double zeroSeason = gamma * (currentValue / zeroLevel) + (1 - gamma);
-
-    components.push_back(SmoothingComponents{
-        y[0],
-        zeroLevel,
-        zeroTrend,
-        zeroSeason
-    });
-
-    const size_t originalSize = y.size();
-
-    for (size_t t = 1; t < originalSize + forecastLength; ++t) {
-        if (t < originalSize)
-            currentValue = static_cast<double>(y[t]);
-        else
-            currentValue = (components[t - 1].level + components[t - 1].trend) *
-                           (t - seasonLength > 0 ? components[t - seasonLength] : components[0]).season;
-
-        double level = alpha * (currentValue / (t >= seasonLength ? components[t - seasonLength]: components[0]).season) +
-                       (1 - alpha) * (components[t - 1].level + components[t - 1].trend);
-        level = max(0.0, level);
-
-        double trend = beta * (level - components[t - 1].level) +
-                       (1 - beta) * components[t - 1].trend;
-        trend = max(trend, 0.0);
-
-        double season = gamma * (currentValue / level) +
-                        (1 - gamma) * (t >= seasonLength ? components[t - seasonLength] : components[0]).season;
-        season = max(0.0, season);
-
-        if (t >= originalSize) {
-            const int forecastedValue = static_cast<int>(
-                (level + trend) *
-                (t - seasonLength + 1 > 0 ? components[t - seasonLength + 1] : components[0]).season
-            );
-
-            y.push_back(forecastedValue);
-        }
-
-        components.push_back(SmoothingComponents(
-            y[t],
-            level,
-            trend,
-            season
-        ));
-    }
-
     vector<int> forecastedValues;
-    for (size_t t = originalSize; t < y.size(); ++t) {
-        forecastedValues.push_back(y[t]);
-    }
+    smoothInto(y, alpha, beta, gamma, seasonLength, forecastLength, scratchResource(), forecastedValues);
     return forecastedValues;
 }
 
 double WAPETest(
-    const vector<int>& real,
-    const vector<int>& forecast
+    const span<const int> real,
+    const span<const int> forecast
 ) {
     const size_t len = min(real.size(), forecast.size());
     double errorSum = 0.0;
@@ -118,64 +150,187 @@ double WAPETest(
  * коэффициентов от 0.1 до 0.9 с шагом 0.1. Для каждой тройки коэффициентов
  * строится прогноз для последних seasonLength точек и вычисляется средняя
  * абсолютная ошибка. Возвращается тройка коэффициентов с минимальной ошибкой.
+ * Сетка перебирается участками параллельно в общем исполнителе.
  */
 SmoothingOdds betterCoefficient(
-    vector<int> y,
+    const span<const int> y,
     const int seasonLength
 ) {
-    double bestAlpha = 0.1, bestBeta = 0.1, bestGamma = 0.1;
-    double minError = 1e9;
-
-    vector<int> yData = y;
-    if (yData.size() >= static_cast<size_t>(seasonLength)) {
-        yData.erase(yData.end() - seasonLength, yData.end());
-    } else {
-        cerr << "Not enough elements to create yData\n";
-    }
-
-    vector<int> realForecast;
+    // Обучающая часть и контрольный хвост — участки исходного ряда, без копирования
+    span<const int> yData = y;
+    span<const int> realForecast;
     if (y.size() >= static_cast<size_t>(seasonLength)) {
-        realForecast.assign(y.end() - seasonLength, y.end());
+        yData = y.first(y.size() - seasonLength);
+        realForecast = y.last(seasonLength);
     } else {
+        cerr << "Not enough elements to create yData\n";
         cerr << "Not enough elements to create realForecast\n";
     }
 
-    for (int intAlpha = 1; intAlpha < 10; intAlpha += 1) {
-        const double alpha = intAlpha / 10.0;
-        for (int intBeta = 1; intBeta < 10; intBeta += 1) {
-            const double beta = intBeta / 10.0;
-            for (int intGamma = 1; intGamma < 10; intGamma += 1) {
-                const double gamma = intGamma / 10.0;
-                vector<int> forecast = exponentialSmoothing(
-                    yData,
-                    alpha,
-                    beta,
-                    gamma,
-                    seasonLength,
-                    seasonLength
-                );
+    // Кандидат k соответствует alpha = (1 + k / 81) / 10, beta = (1 + k / 9 % 9) / 10,
+    // gamma = (1 + k % 9) / 10 — тот же порядок, что у вложенных циклов по alpha, beta, gamma
+    const auto bestInRange = [&](const size_t first, const size_t last) {
+        SmoothingOdds best{0.1, 0.1, 0.1, 1e9};
+        // Кандидаты участка используют одну арену: после первого кандидата выделений нет
+        Arena candidates("forecast.candidates");
+        for (size_t k = first; k < last; ++k) {
+            const double alpha = static_cast<int>(1 + k / 81) / 10.0;
+            const double beta = static_cast<int>(1 + k / 9 % 9) / 10.0;
+            const double gamma = static_cast<int>(1 + k % 9) / 10.0;
+            candidates.reset();
+            pmr::vector<int> forecast(&candidates);
+            smoothInto(
+                yData,
+                alpha,
+                beta,
+                gamma,
+                seasonLength,
+                seasonLength,
+                &candidates,
+                forecast
+            );
 
-                if (forecast.size() != realForecast.size()) {
-                    cerr << "Forecast size does not match real forecast size\n";
-                    continue;
-                }
+            if (forecast.size() != realForecast.size()) {
+                cerr << "Forecast size does not match real forecast size\n";
+                continue;
+            }
 
-                double error = WAPETest(realForecast, forecast);
+            const double error = WAPETest(realForecast, forecast);
 
-                if (error < minError) {
-                    minError = error;
-                    bestAlpha = alpha;
-                    bestBeta = beta;
-                    bestGamma = gamma;
-                }
+            if (error < best.WAPETest) {
+                best = SmoothingOdds{alpha, beta, gamma, error};
             }
         }
+        return best;
+    };
+
+    // Участки сворачиваются по порядку со строгим сравнением: при равной ошибке
+    // остаётся кандидат с меньшим номером, как при последовательном переборе
+    return parallelReduce(
+        0, GRID_CANDIDATES,
+        SmoothingOdds{0.1, 0.1, 0.1, 1e9},
+        bestInRange,
+        [](const SmoothingOdds &best, const SmoothingOdds &candidate) {
+            return candidate.WAPETest < best.WAPETest ? candidate : best;
+        },
+        GRID_GRAIN
+    );
+}
+
+HoltWintersModel::HoltWintersModel(const SmoothingOdds &odds, const int seasonLength)
+    : _alpha(odds.alpha),
+      _beta(odds.beta),
+      _gamma(odds.gamma),
+      _seasonLength(static_cast<size_t>(max(1, seasonLength))),
+      _seasons(_seasonLength, 0.0) {}
+
+double HoltWintersModel::seasonAt(const vector<double> &seasons, const long long index) const {
+    return index >= 0 ? seasons[static_cast<size_t>(index) % _seasonLength] : _zeroSeason;
+}
+
+/**
+ * @brief Начальные значения вычисляются так же, как в exponentialSmoothing,
+ * затем наблюдения с 1-го по последнее учитываются через update.
+ */
+bool HoltWintersModel::fit(const span<const int> y) {
+    const auto m = static_cast<int>(_seasonLength);
+    if (y.size() < _seasonLength * 2) {
+        return false;
     }
 
-    return SmoothingOdds{
-        bestAlpha,
-        bestBeta,
-        bestGamma,
-        minError
-    };
-}
\ No newline at end of file
+    double startingTrend = 0.0;
+    double startingLevel = 0.0;
+    for (int t = m * 2 - 1; t >= 0; t--) {
+        if (t >= m) {
+            startingTrend += static_cast<double>(y[t]);
+        }
+        else {
+            startingTrend -= static_cast<double>(y[t]);
+            startingLevel += static_cast<double>(y[t]);
+        }
+    }
+    startingTrend /= static_cast<double>(m);
+    startingLevel /= static_cast<double>(m);
+    startingTrend = max(0.0, startingTrend);
+    startingLevel = max(0.0, startingLevel);
+
+    const auto currentValue = static_cast<double>(y[0]);
+    _level = _alpha * currentValue + (1 - _alpha) * (startingLevel + startingTrend);
+    _trend = _beta * (_level - startingLevel) + (1 - _beta) * startingTrend;
+    _zeroSeason = _gamma * (currentValue / _level) + (1 - _gamma);
+    _seasons.assign(_seasonLength, 0.0);
+    _seasons[0] = _zeroSeason;
+    _t = 1;
+
+    for (size_t t = 1; t < y.size(); ++t) {
+        update(y[t]);
+    }
+    return true;
+}
+
+/**
+ * @brief Один шаг рекурсии exponentialSmoothing для наблюдаемой точки.
+ */
+void HoltWintersModel::update(const int value) {
+    const auto t = static_cast<long long>(_t);
+    const auto m = static_cast<long long>(_seasonLength);
+    const auto currentValue = static_cast<double>(value);
+    const double seasonRef = seasonAt(_seasons, t >= m ? t - m : -1);
+
+    double level = _alpha * (currentValue / seasonRef) + (1 - _alpha) * (_level + _trend);
+    level = max(0.0, level);
+
+    double trend = _beta * (level - _level) + (1 - _beta) * _trend;
+    trend = max(trend, 0.0);
+
+    double season = _gamma * (currentValue / level) + (1 - _gamma) * seasonRef;
+    season = max(0.0, season);
+
+    _seasons[_t % _seasonLength] = season;
+    _level = level;
+    _trend = trend;
+    ++_t;
+}
+
+/**
+ * @brief Продолжает рекурсию на копии состояния, подставляя вместо наблюдений
+ * прогнозные значения, как это делает exponentialSmoothing.
+ */
+vector<int> HoltWintersModel::forecast(const int forecastLength) const {
+    vector<int> forecastedValues;
+    if (forecastLength <= 0) return forecastedValues;
+    forecastedValues.reserve(static_cast<size_t>(forecastLength));
+
+    vector<double> seasons = _seasons;
+    double prevLevel = _level;
+    double prevTrend = _trend;
+    const auto m = static_cast<long long>(_seasonLength);
+    const auto end = static_cast<long long>(_t) + forecastLength;
+
+    for (auto t = static_cast<long long>(_t); t < end; ++t) {
+        const double currentValue = (prevLevel + prevTrend) * seasonAt(seasons, t - m > 0 ? t - m : -1);
+        const double seasonRef = seasonAt(seasons, t >= m ? t - m : -1);
+
+        double level = _alpha * (currentValue / seasonRef) + (1 - _alpha) * (prevLevel + prevTrend);
+        level = max(0.0, level);
+
+        double trend = _beta * (level - prevLevel) + (1 - _beta) * prevTrend;
+        trend = max(trend, 0.0);
+
+        double season = _gamma * (currentValue / level) + (1 - _gamma) * seasonRef;
+        season = max(0.0, season);
+
+        forecastedValues.push_back(static_cast<int>(
+            (level + trend) * seasonAt(seasons, t - m + 1 > 0 ? t - m + 1 : -1)
+        ));
+
+        seasons[static_cast<size_t>(t) % _seasonLength] = season;
+        prevLevel = level;
+        prevTrend = trend;
+    }
+    return forecastedValues;
+}
+
+size_t HoltWintersModel::observations() const {
+    return _t;
+}
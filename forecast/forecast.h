@@ -1,5 +1,6 @@
 #ifndef TRAFFIC_FORECAST_FORECAST_H
 #define TRAFFIC_FORECAST_FORECAST_H
+#include <span>
 #include <vector>
 using namespace std;
 
@@ -38,6 +39,9 @@ struct SmoothingOdds {
  * коэффициентов (alpha, beta, gamma), длину сезонного периода и длину
  * горизонта прогноза.
  *
+ * Ряд не копируется: можно передать vector<int> или непрерывный участок
+ * буфера (например, ряд из SeriesSet).
+ *
  * @param y Входной ряд наблюдаемых целых значений.
  * @param alpha Коэффициент адаптации уровня (0..1).
  * @param beta Коэффициент адаптации тренда (0..1).
@@ -47,7 +51,7 @@ struct SmoothingOdds {
  * @return Вектор целых значений длиной forecastLength с прогнозом.
  */
 vector<int> exponentialSmoothing(
-    vector<int> y,
+    span<const int> y,
     double alpha,
     double beta,
     double gamma,
@@ -68,8 +72,72 @@ vector<int> exponentialSmoothing(
  * @return Структура SmoothingOdds с подобранными alpha, beta, gamma.
  */
 SmoothingOdds betterCoefficient(
-    vector<int> y,
+    span<const int> y,
     int seasonLength
 );
 
+/**
+ * @brief Онлайн-состояние модели экспоненциального сглаживания.
+ *
+ * Повторяет рекуррентные формулы exponentialSmoothing, но хранит только
+ * текущие уровень и тренд и последние seasonLength сезонных компонент.
+ * Это позволяет дообучать модель на новых наблюдениях за O(1) без
+ * пересчёта всего ряда: fit(y) + update(v) + forecast(H) даёт тот же
+ * результат, что exponentialSmoothing(y + v, ..., H).
+ */
+class HoltWintersModel {
+public:
+    /**
+     * @brief Создать модель с заданными коэффициентами.
+     *
+     * @param odds Коэффициенты alpha, beta, gamma (WAPETest не используется).
+     * @param seasonLength Длина сезонного периода.
+     */
+    HoltWintersModel(const SmoothingOdds &odds, int seasonLength);
+
+    /**
+     * @brief Обучить модель на ряде заново.
+     *
+     * @param y Ряд наблюдений; должен содержать не менее 2 * seasonLength точек.
+     * @return true при успехе, false если наблюдений недостаточно.
+     */
+    bool fit(span<const int> y);
+
+    /**
+     * @brief Учесть одно новое наблюдение.
+     *
+     * @param value Новое значение ряда. Модель должна быть обучена через fit.
+     */
+    void update(int value);
+
+    /**
+     * @brief Построить прогноз по текущему состоянию (состояние не меняется).
+     *
+     * @param forecastLength Количество прогнозируемых шагов.
+     * @return Вектор прогнозных значений длиной forecastLength.
+     */
+    [[nodiscard]] vector<int> forecast(int forecastLength) const;
+
+    /**
+     * @brief Количество учтённых наблюдений.
+     */
+    [[nodiscard]] size_t observations() const;
+
+private:
+    double _alpha;
+    double _beta;
+    double _gamma;
+    size_t _seasonLength;
+    size_t _t = 0;              ///< Количество учтённых наблюдений
+    double _level = 0.0;        ///< Уровень последней точки
+    double _trend = 0.0;        ///< Тренд последней точки
+    double _zeroSeason = 0.0;   ///< Сезонная компонента нулевой точки
+    vector<double> _seasons;    ///< Кольцевой буфер сезонных компонент: точка i хранится в [i % seasonLength]
+
+    /**
+     * @brief Сезонная компонента точки index (или нулевой точки, если index < 0).
+     */
+    [[nodiscard]] double seasonAt(const vector<double> &seasons, long long index) const;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+
+namespace {
+    thread_local Arena *threadArena = nullptr;
+
+    mutex reportsLock;
+    map<string, ArenaReport, less<>> reports;
+
+    /**
+     * Выравнивает адрес вверх; alignment — степень двойки.
+     */
+    uintptr_t alignUp(const uintptr_t address, const size_t alignment) {
+        return (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+}
+
+Arena::Arena(const string_view name, const size_t initialBlockSize, pmr::memory_resource *upstream)
+    : _name(name),
+      _upstream(upstream),
+      _nextBlockSize(max(initialBlockSize, sizeof(Block) + alignof(max_align_t))) {}
+
+Arena::~Arena() {
+    if (!_name.empty()) {
+        const ArenaReport own = report();
+        lock_guard guard(reportsLock);
+        auto [it, inserted] = reports.try_emplace(_name);
+        ArenaReport &total = it->second;
+        if (inserted) total.name = _name;
+        ++total.instances;
+        total.allocations += own.allocations;
+        total.highWater = max(total.highWater, own.highWater);
+        total.reserved = max(total.reserved, own.reserved);
+    }
+    freeBlocks();
+}
+
+ArenaReport Arena::report() const {
+    return ArenaReport{_name, 1, _allocations, _highWater, _peakReserved};
+}
+
+void *Arena::do_allocate(size_t bytes, const size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    auto start = reinterpret_cast<uintptr_t>(_cursor);
+    auto aligned = alignUp(start, alignment);
+    if (_head == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(_end)) {
+        addBlock(bytes + alignment);
+        start = reinterpret_cast<uintptr_t>(_cursor);
+        aligned = alignUp(start, alignment);
+    }
+    _cursor = reinterpret_cast<char *>(aligned + bytes);
+    _used += aligned + bytes - start;
+    _highWater = max(_highWater, _used);
+    ++_allocations;
+    return reinterpret_cast<void *>(aligned);
+}
+
+/**
+ * Остаток текущего блока не используется: блоки не связаны в список свободных участков.
+ */
+void Arena::addBlock(const size_t minimum) {
+    const size_t size = max(_nextBlockSize, minimum + sizeof(Block));
+    void *memory = _upstream->allocate(size, alignof(max_align_t));
+    _head = new (memory) Block{_head, size};
+    _cursor = reinterpret_cast<char *>(_head + 1);
+    _end = reinterpret_cast<char *>(_head) + size;
+    _reserved += size;
+    _peakReserved = max(_peakReserved, _reserved);
+    _nextBlockSize = size * 2;
+}
+
+void Arena::freeBlocks() {
+    while (_head != nullptr) {
+        Block *next = _head->next;
+        _upstream->deallocate(_head, _head->size, alignof(max_align_t));
+        _head = next;
+    }
+    _cursor = _end = nullptr;
+    _reserved = 0;
+}
+
+void Arena::reset() {
+    _used = 0;
+    if (_head == nullptr) return;
+    if (_head->next != nullptr) {
+        // Несколько блоков — заменяем одним, вмещающим всю работу до reset
+        const size_t total = _reserved;
+        freeBlocks();
+        _nextBlockSize = total;
+        addBlock(0);
+        return;
+    }
+    _cursor = reinterpret_cast<char *>(_head + 1);
+}
+
+void Arena::release() {
+    freeBlocks();
+    _used = 0;
+}
+
+ArenaScope::ArenaScope(Arena &arena) : _previous(threadArena) {
+    threadArena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+    threadArena = _previous;
+}
+
+Arena *currentArena() {
+    return threadArena;
+}
+
+pmr::memory_resource *scratchResource() {
+    return threadArena != nullptr ? threadArena : pmr::get_default_resource();
+}
+
+vector<ArenaReport> arenaReports() {
+    lock_guard guard(reportsLock);
+    vector<ArenaReport> result;
+    result.reserve(reports.size());
+    for (const auto &[name, report] : reports) result.push_back(report);
+    return result;
+}
+
+void clearArenaReports() {
+    lock_guard guard(reportsLock);
+    reports.clear();
+}
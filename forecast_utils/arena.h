@@ -0,0 +1,158 @@
+#ifndef TRAFFIC_FORECAST_ARENA_H
+#define TRAFFIC_FORECAST_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Итоговая статистика арен с одним именем.
+ */
+struct ArenaReport {
+    string name;            ///< Имя арены
+    size_t instances = 0;   ///< Сколько арен с этим именем было уничтожено
+    size_t allocations = 0; ///< Всего выделений
+    size_t highWater = 0;   ///< Наибольший объём занятой памяти одной арены, байт
+    size_t reserved = 0;    ///< Наибольший объём блоков одной арены, байт
+};
+
+/**
+ * @brief Монотонная арена: выделение сдвигом указателя, освобождение сразу всей памяти.
+ *
+ * Память берётся у вышестоящего ресурса блоками, каждый следующий блок
+ * вдвое больше предыдущего. deallocate ничего не делает — память
+ * возвращается только reset() или release(). Подходит для временных
+ * объектов одной задачи: pmr-контейнеры, созданные с ареной, не обращаются
+ * к malloc после того, как арена выросла до нужного размера.
+ *
+ * Арена не потокобезопасна: для параллельной работы у каждого потока
+ * своя арена (см. ArenaScope).
+ *
+ * Арены с непустым именем при уничтожении добавляют свою статистику
+ * в общий отчёт (arenaReports), чтобы по нему подобрать размеры блоков.
+ */
+class Arena : public pmr::memory_resource {
+public:
+    /// Размер первого блока по умолчанию
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 << 10;
+
+    /**
+     * @param name Имя для отчёта (пусто — не попадает в отчёт).
+     * @param initialBlockSize Размер первого блока.
+     * @param upstream Источник блоков.
+     */
+    explicit Arena(string_view name = {}, size_t initialBlockSize = DEFAULT_BLOCK_SIZE,
+                   pmr::memory_resource *upstream = pmr::new_delete_resource());
+    ~Arena() override;
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Освободить все выделения, сохранив память для повторного использования.
+     *
+     * Если арена успела вырасти до нескольких блоков, они заменяются одним
+     * блоком суммарного размера: при повторении той же работы новых
+     * обращений к вышестоящему ресурсу не будет.
+     */
+    void reset();
+
+    /**
+     * @brief Вернуть все блоки вышестоящему ресурсу.
+     */
+    void release();
+
+    /**
+     * @brief Занято байт с последнего reset/release (с учётом выравнивания).
+     */
+    [[nodiscard]] size_t used() const { return _used; }
+
+    /**
+     * @brief Байт в блоках, полученных у вышестоящего ресурса.
+     */
+    [[nodiscard]] size_t reserved() const { return _reserved; }
+
+    /**
+     * @brief Наибольшее значение used() за время жизни арены.
+     */
+    [[nodiscard]] size_t highWater() const { return _highWater; }
+
+    /**
+     * @brief Количество выделений за время жизни арены.
+     */
+    [[nodiscard]] size_t allocations() const { return _allocations; }
+
+    /**
+     * @brief Статистика этой арены в виде строки отчёта (для ещё не уничтоженной арены).
+     */
+    [[nodiscard]] ArenaReport report() const;
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override { return this == &other; }
+
+private:
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    void addBlock(size_t minimum);
+    void freeBlocks();
+
+    string _name;
+    pmr::memory_resource *_upstream;
+    Block *_head = nullptr;     ///< Текущий блок; предыдущие — по next
+    char *_cursor = nullptr;    ///< Начало свободного места текущего блока
+    char *_end = nullptr;       ///< Конец текущего блока
+    size_t _nextBlockSize;
+    size_t _used = 0;
+    size_t _reserved = 0;
+    size_t _highWater = 0;
+    size_t _peakReserved = 0;
+    size_t _allocations = 0;
+};
+
+/**
+ * @brief Делает арену текущей для потока на время жизни объекта.
+ *
+ * Области видимости вкладываются: при выходе восстанавливается предыдущая арена.
+ */
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    Arena *_previous;
+};
+
+/**
+ * @brief Текущая арена потока или nullptr, если ArenaScope не установлен.
+ */
+Arena *currentArena();
+
+/**
+ * @brief Ресурс для временных объектов: текущая арена потока или ресурс по умолчанию.
+ */
+pmr::memory_resource *scratchResource();
+
+/**
+ * @brief Статистика всех уничтоженных именованных арен, по имени.
+ */
+vector<ArenaReport> arenaReports();
+
+/**
+ * @brief Очистить накопленную статистику арен.
+ */
+void clearArenaReports();
+
+#endif
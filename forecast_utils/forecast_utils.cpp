@@ -1,54 +1,245 @@
 #include "forecast_utils.h"
 
+#include <climits>
 #include <ctime>
-#include <sstream>
 #include <iostream>
 using namespace std;
 
+string_view trimField(string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '"' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '"' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+    return s;
+}
+
+namespace {
+    /**
+     * Читает от minDigits до maxDigits десятичных цифр, начиная с позиции pos.
+     * @return true, если прочитано допустимое количество цифр.
+     */
+    bool readDigits(const string_view s, size_t &pos, const size_t minDigits, const size_t maxDigits, int &value) {
+        const size_t start = pos;
+        int v = 0;
+        while (pos < s.size() && pos - start < maxDigits && s[pos] >= '0' && s[pos] <= '9') {
+            v = v * 10 + (s[pos] - '0');
+            ++pos;
+        }
+        if (pos - start < minDigits) return false;
+        value = v;
+        return true;
+    }
+
+    bool isDateSeparator(const char c) {
+        return c == '/' || c == '-' || c == '.';
+    }
+
+    void writeTwoDigits(char *out, const int v) {
+        out[0] = static_cast<char>('0' + v / 10);
+        out[1] = static_cast<char>('0' + v % 10);
+    }
+
+    void writeFourDigits(char *out, const int v) {
+        out[0] = static_cast<char>('0' + v / 1000 % 10);
+        out[1] = static_cast<char>('0' + v / 100 % 10);
+        out[2] = static_cast<char>('0' + v / 10 % 10);
+        out[3] = static_cast<char>('0' + v % 10);
+    }
+}
+
+/**
+ * Алгоритм days_from_civil (H. Hinnant): год сдвигается так, чтобы он начинался
+ * с марта, после чего число дней считается через 400-летние эры.
+ */
+int64_t daysFromCivil(int year, const int month, const int day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const auto yoe = static_cast<unsigned>(year - era * 400);
+    const auto mp = static_cast<unsigned>(month > 2 ? month - 3 : month + 9);
+    const unsigned doy = (153 * mp + 2) / 5 + static_cast<unsigned>(day) - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+/**
+ * Алгоритм civil_from_days (H. Hinnant), обратный daysFromCivil.
+ */
+void civilFromDays(int64_t days, int &year, int &month, int &day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(static_cast<int64_t>(yoe) + era * 400 + (month <= 2));
+}
+
+/**
+ * 1970-01-01 — четверг (4).
+ */
+int weekdayFromDays(const int64_t days) {
+    const int64_t w = (days + 4) % 7;
+    return static_cast<int>(w < 0 ? w + 7 : w);
+}
+
+const string &weekdayName(const int64_t days) {
+    static const string names[7] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+    return names[weekdayFromDays(days)];
+}
+
 /**
- * Преобразует строку формата "MM/DD/YYYY" в time_t.
+ * Разбирает "M/D/YYYY" посимвольно, без istringstream и mktime.
+ */
+bool parseDateMDY(string_view s, int64_t &days) {
+    s = trimField(s);
+    size_t pos = 0;
+    int month = 0, day_ = 0, year = 0;
+    if (!readDigits(s, pos, 1, 2, month)) return false;
+    if (pos >= s.size() || !isDateSeparator(s[pos++])) return false;
+    if (!readDigits(s, pos, 1, 2, day_)) return false;
+    if (pos >= s.size() || !isDateSeparator(s[pos++])) return false;
+    if (!readDigits(s, pos, 4, 4, year)) return false;
+    if (pos != s.size()) return false;
+    if (month < 1 || month > 12 || day_ < 1 || day_ > 31) return false;
+
+    days = daysFromCivil(year, month, day_);
+    return true;
+}
+
+/**
+ * Разбирает "YYYY-MM-DD" посимвольно; всё после даты, начиная с 'T' или ' ', игнорируется.
+ */
+bool parseDateISO(string_view s, int64_t &days) {
+    s = trimField(s);
+    size_t pos = 0;
+    int year = 0, month = 0, day_ = 0;
+    if (!readDigits(s, pos, 4, 4, year)) return false;
+    if (pos >= s.size() || s[pos++] != '-') return false;
+    if (!readDigits(s, pos, 2, 2, month)) return false;
+    if (pos >= s.size() || s[pos++] != '-') return false;
+    if (!readDigits(s, pos, 2, 2, day_)) return false;
+    if (pos != s.size() && s[pos] != 'T' && s[pos] != ' ') return false;
+    if (month < 1 || month > 12 || day_ < 1 || day_ > 31) return false;
+
+    days = daysFromCivil(year, month, day_);
+    return true;
+}
+
+size_t formatDateMDY(const int64_t days, char *out) {
+    int year = 0, month = 0, day_ = 0;
+    civilFromDays(days, year, month, day_);
+    writeTwoDigits(out, month);
+    out[2] = '/';
+    writeTwoDigits(out + 3, day_);
+    out[5] = '/';
+    writeFourDigits(out + 6, year);
+    return FORMATTED_DATE_LENGTH;
+}
+
+size_t formatDateISO(const int64_t days, char *out) {
+    int year = 0, month = 0, day_ = 0;
+    civilFromDays(days, year, month, day_);
+    writeFourDigits(out, year);
+    out[4] = '-';
+    writeTwoDigits(out + 5, month);
+    out[7] = '-';
+    writeTwoDigits(out + 8, day_);
+    return FORMATTED_DATE_LENGTH;
+}
+
+/**
+ * Преобразует строку формата "MM/DD/YYYY" (или "YYYY-MM-DD") в time_t.
  * Если парсинг не удаётся, возвращается time_t(0).
  * @param s дата в виде строки "MM/DD/YYYY" (например, "12/31/2020").
- * @return значение time_t, соответствующее полуночи указанного дня в локальном часовом поясе, либо 0 при ошибке.
+ * @return значение time_t, соответствующее полуночи указанного дня по UTC, либо 0 при ошибке.
  */
-time_t parseDateString(const string &s) {
-    std::tm tm{};
-    std::istringstream iss(s);
-    int month = 0, day_ = 0, year = 0;
-    char sep1, sep2;
-    if (!(iss >> month >> sep1 >> day_ >> sep2 >> year)) {
-        return time_t(0);
+time_t parseDateString(const string_view s) {
+    int64_t days = 0;
+    if (parseDateMDY(s, days) || parseDateISO(s, days)) {
+        return daysToTimeT(days);
+    }
+    return time_t(0);
+}
+
+/**
+ * Накопление в стиле std::from_chars по исходной строке: запятые и кавычки
+ * пропускаются на месте, переполнение проверяется до умножения.
+ */
+ParseStatus parseNumber(string_view s, int64_t &value) {
+    s = trimField(s);
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < s.size() && (s[pos] == '-' || s[pos] == '+')) {
+        negative = s[pos] == '-';
+        ++pos;
+    }
+
+    // Накапливаем модуль в беззнаковом типе, чтобы корректно принять INT64_MIN
+    const uint64_t limit = negative
+        ? static_cast<uint64_t>(INT64_MAX) + 1
+        : static_cast<uint64_t>(INT64_MAX);
+    uint64_t acc = 0;
+    bool hasDigits = false;
+    for (; pos < s.size(); ++pos) {
+        const char c = s[pos];
+        if (c == ',' || c == '"') continue;
+        if (c < '0' || c > '9') return ParseStatus::InvalidCharacter;
+
+        const auto digit = static_cast<uint64_t>(c - '0');
+        if (acc > (limit - digit) / 10) return ParseStatus::OutOfRange;
+        acc = acc * 10 + digit;
+        hasDigits = true;
     }
-    if (month < 1) month = 1;
-    if (month > 12) month = 12;
-    if (day_ < 1) day_ = 1;
-    if (year < 1900) year = 1900;
+    if (!hasDigits) return ParseStatus::Empty;
 
-    tm.tm_mon = month - 1;
-    tm.tm_mday = day_;
-    tm.tm_year = year - 1900;
-    tm.tm_hour = 0;
-    tm.tm_min = 0;
-    tm.tm_sec = 0;
-    return mktime(&tm);
+    value = negative ? static_cast<int64_t>(0 - acc) : static_cast<int64_t>(acc);
+    return ParseStatus::Ok;
+}
+
+ParseStatus parseNumber(const string_view s, int &value) {
+    int64_t wide = 0;
+    if (const ParseStatus status = parseNumber(s, wide); status != ParseStatus::Ok) {
+        return status;
+    }
+    if (wide < INT_MIN || wide > INT_MAX) return ParseStatus::OutOfRange;
+    value = static_cast<int>(wide);
+    return ParseStatus::Ok;
+}
+
+string_view nextCSVField(const string_view line, size_t &pos) {
+    const size_t start = pos;
+    bool quoted = false;
+    while (pos < line.size()) {
+        const char c = line[pos];
+        if (c == '"') quoted = !quoted;
+        else if (c == ',' && !quoted) break;
+        ++pos;
+    }
+    const string_view field = line.substr(start, pos - start);
+    ++pos;
+    return field;
 }
 
 /**
- * Убирает запятые из строки и конвертирует результат в int.
- * Если преобразование не удаётся, возвращает 0.
+ * Обёртка над parseNumber: при любой ошибке возвращает 0.
  * @param s строка с числом, возможно с разделителями тысяч (запятая).
  */
-int parseNumberString(const string &s) {
-    string t;
-    t.reserve(s.size());
-    for (const char c: s) {
-        if (c != ',' && c != '"') t.push_back(c);
-    }
-    try {
-        return stoi(t);
-    } catch (...) {
-        return 0;
+int parseNumberString(const string_view s) {
+    int value = 0;
+    if (parseNumber(s, value) != ParseStatus::Ok) return 0;
+    return value;
+}
+
+/**
+ * FNV-1a: побайтовый XOR с последующим умножением на простое число FNV.
+ */
+uint64_t fnv1a64(const void *data, const size_t size, uint64_t seed) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        seed ^= bytes[i];
+        seed *= 0x100000001b3ULL;
     }
+    return seed;
 }
 
 /**
@@ -102,10 +293,10 @@ string nextDayString(const string& currentDay) {
 }
 
 /**
- * @brief Возвращает time_t, увеличенный на один день (24 часа).
+ * @brief Возвращает полночь (UTC) следующего календарного дня.
  */
 time_t nextDayTimeT(const time_t currentDate) {
-    return currentDate + 24 * 60 * 60;
+    return daysToTimeT(timeTToDays(currentDate) + 1);
 }
 
 /**
@@ -120,11 +311,10 @@ time_t nextDayTimeT(const time_t currentDate) {
  * @return Структура Args с разобранными параметрами
  */
 Args parseArgs(const int argc, char** argv) {
-    SeedKey seedKey;
     if (argc<2){
         cerr << "Использование: " << argv[0] << " <csv_path>\n";
         cerr << "Для справки используйте: " << argv[0] << " --help\n";
-        return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+        return Args{.has_error = true};
     }
     const string path = argv[1];
     string outputPath = "forecast.csv";
@@ -134,59 +324,108 @@ Args parseArgs(const int argc, char** argv) {
     string decryptOutputPath;
     bool encryptFile = false;
     string encryptOutputPath;
+    string snapshotPath;
+    bool watch = false;
+    optional<time_t> dateFrom;
+    optional<time_t> dateTo;
+    bool accessLog = false;
+    string visitorFilterPath;
+    bool longFormat = false;
+    vector<string> shardPaths;
+    bool keepFirstDuplicate = false;
+    string fillGaps;
+    bool arenaStats = false;
+    unsigned threads = 0;
+    bool pinThreads = false;
+    vector<string> metrics;
+    CipherMode cipherMode = CipherMode::Chunked;
+    optional<SeedKey> defaultKey;
+    string keyringPath;
+    optional<KeyManager::KeyId> keyId;
+    bool encryptedInput = false;
 
     for (int i=1; i<argc; ++i){
         string arg = argv[i];
         if (arg == "--help" || arg == "-h"){
-            return Args{"", "", 0, 0, false, "", false, "", true, {}, false, SeedCryptor(seedKey)};
+            return Args{.help = true};
         }
         if (arg == "--output"){
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --output\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
             outputPath = argv[++i];
         } else if (arg == "--H"){
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --H\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
-            H = stoi(argv[++i]);
+            if (parseNumber(argv[++i], H) != ParseStatus::Ok) {
+                cerr << "Ошибка: некорректное значение для параметра --H: " << argv[i] << "\n";
+                return Args{.has_error = true};
+            }
         } else if (arg == "--season_m"){
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --season_m\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
-            m = stoi(argv[++i]);
+            if (parseNumber(argv[++i], m) != ParseStatus::Ok) {
+                cerr << "Ошибка: некорректное значение для параметра --season_m: " << argv[i] << "\n";
+                return Args{.has_error = true};
+            }
         } else if (arg == "--crypt"){
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --crypt\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
-            string keyStr = argv[++i];
-            seedKey = SeedKey(keyStr);
+            const string keyPath = argv[++i];
+            SeedKey key;
+            if (!key.loadFromFile(keyPath)) {
+                cerr << "Ошибка: не удалось прочитать ключ из " << keyPath << "\n";
+                return Args{.has_error = true};
+            }
+            defaultKey = key;
         } else if (arg == "--newCryptKey") {
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --newCryptKey\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
             string keyFilePath = argv[++i];
-            seedKey = SeedKey::generateRandom();
-            if (seedKey.saveToFile(keyFilePath)) {
+            defaultKey = SeedKey::generateRandom();
+            if (defaultKey->saveToFile(keyFilePath)) {
                 cout << "Новый ключ шифрования сохранён в " << keyFilePath << endl;
             } else {
                 cerr << "Ошибка при сохранении ключа в " << keyFilePath << endl;
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
+        } else if (arg == "--keyring") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --keyring\n";
+                return Args{.has_error = true};
+            }
+
+            keyringPath = argv[++i];
+        } else if (arg == "--key-id") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --key-id\n";
+                return Args{.has_error = true};
+            }
+
+            int value = 0;
+            if (parseNumber(argv[++i], value) != ParseStatus::Ok || value < 0 || value > 0xFFFF) {
+                cerr << "Ошибка: некорректное значение для параметра --key-id: " << argv[i] << "\n";
+                return Args{.has_error = true};
+            }
+            keyId = static_cast<KeyManager::KeyId>(value);
         } else if (arg == "--decrypt") {
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --decrypt\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
             decryptOutputPath = argv[++i];
@@ -194,13 +433,132 @@ Args parseArgs(const int argc, char** argv) {
         } else if (arg == "--encrypt") {
             if (i + 1 >= argc) {
                 cerr << "Ошибка: отсутствует значение для параметра --encrypt\n";
-                return Args{"", "", 0, 0, false, "", false, "", false, {}, true, SeedCryptor(seedKey)};
+                return Args{.has_error = true};
             }
 
             encryptOutputPath = argv[++i];
             encryptFile = true;
+        } else if (arg == "--snapshot") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --snapshot\n";
+                return Args{.has_error = true};
+            }
+
+            snapshotPath = argv[++i];
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--access-log") {
+            accessLog = true;
+        } else if (arg == "--shard") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --shard\n";
+                return Args{.has_error = true};
+            }
+
+            shardPaths.emplace_back(argv[++i]);
+        } else if (arg == "--duplicates") {
+            const string value = i + 1 < argc ? argv[++i] : "";
+            if (value != "first" && value != "last") {
+                cerr << "Ошибка: параметр --duplicates принимает значения first или last\n";
+                return Args{.has_error = true};
+            }
+            keepFirstDuplicate = value == "first";
+        } else if (arg == "--fill-gaps") {
+            const string value = i + 1 < argc ? argv[++i] : "";
+            if (value != "linear" && value != "seasonal") {
+                cerr << "Ошибка: параметр --fill-gaps принимает значения linear или seasonal\n";
+                return Args{.has_error = true};
+            }
+            fillGaps = value;
+        } else if (arg == "--cipher") {
+            const string value = i + 1 < argc ? argv[++i] : "";
+            if (value == "cbc") {
+                cipherMode = CipherMode::CBC;
+            } else if (value == "ctr") {
+                cipherMode = CipherMode::CTR;
+            } else if (value == "chunked") {
+                cipherMode = CipherMode::Chunked;
+            } else {
+                cerr << "Ошибка: параметр --cipher принимает значения cbc, ctr или chunked\n";
+                return Args{.has_error = true};
+            }
+        } else if (arg == "--long-format") {
+            longFormat = true;
+        } else if (arg == "--arena-stats") {
+            arenaStats = true;
+        } else if (arg == "--pin-threads") {
+            pinThreads = true;
+        } else if (arg == "--encrypted-input") {
+            encryptedInput = true;
+        } else if (arg == "--metrics") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --metrics\n";
+                return Args{.has_error = true};
+            }
+
+            // Имена через запятую; проверяются там, где известен набор метрик
+            const string_view list = argv[++i];
+            metrics.clear();
+            for (size_t pos = 0; pos <= list.size();) {
+                const size_t comma = min(list.find(',', pos), list.size());
+                if (comma > pos) metrics.emplace_back(list.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+            if (metrics.empty()) {
+                cerr << "Ошибка: некорректное значение для параметра --metrics: " << list << "\n";
+                return Args{.has_error = true};
+            }
+        } else if (arg == "--threads") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --threads\n";
+                return Args{.has_error = true};
+            }
+
+            int value = 0;
+            if (parseNumber(argv[++i], value) != ParseStatus::Ok || value < 0) {
+                cerr << "Ошибка: некорректное значение для параметра --threads: " << argv[i] << "\n";
+                return Args{.has_error = true};
+            }
+            threads = static_cast<unsigned>(value);
+        } else if (arg == "--visitor-filter") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра --visitor-filter\n";
+                return Args{.has_error = true};
+            }
+
+            visitorFilterPath = argv[++i];
+        } else if (arg == "--from" || arg == "--to") {
+            if (i + 1 >= argc) {
+                cerr << "Ошибка: отсутствует значение для параметра " << arg << "\n";
+                return Args{.has_error = true};
+            }
+
+            int64_t days = 0;
+            const string value = argv[++i];
+            if (!parseDateMDY(value, days) && !parseDateISO(value, days)) {
+                cerr << "Ошибка: некорректная дата для параметра " << arg << ": " << value << "\n";
+                return Args{.has_error = true};
+            }
+            (arg == "--from" ? dateFrom : dateTo) = daysToTimeT(days);
+        }
+    }
+
+    // Ключи загружаются один раз; крипторы создаются по мере обращения к ID
+    shared_ptr<KeyManager> keys;
+    if (defaultKey || !keyringPath.empty()) {
+        keys = make_shared<KeyManager>();
+        try {
+            if (defaultKey) keys->addKey(KeyManager::DEFAULT_KEY_ID, *defaultKey);
+            if (!keyringPath.empty()) keys->loadKeyring(keyringPath);
+        } catch (const exception &e) {
+            cerr << "Ошибка: " << e.what() << "\n";
+            return Args{.has_error = true};
         }
     }
+    if (keyId && (!keys || !keys->contains(*keyId))) {
+        cerr << "Ошибка: нет ключа с ID " << *keyId << " (ключи задаются --crypt, --newCryptKey или --keyring)\n";
+        return Args{.has_error = true};
+    }
 
     return Args{
         path,
@@ -212,8 +570,24 @@ Args parseArgs(const int argc, char** argv) {
         encryptFile,
         encryptOutputPath,
         false,
-        seedKey,
         false,
-        SeedCryptor(seedKey)
+        snapshotPath,
+        watch,
+        dateFrom,
+        dateTo,
+        accessLog,
+        visitorFilterPath,
+        longFormat,
+        shardPaths,
+        keepFirstDuplicate,
+        fillGaps,
+        arenaStats,
+        threads,
+        pinThreads,
+        metrics,
+        cipherMode,
+        std::move(keys),
+        keyId.value_or(KeyManager::DEFAULT_KEY_ID),
+        encryptedInput
     };
 }
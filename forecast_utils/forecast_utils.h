@@ -1,29 +1,182 @@
 #ifndef TRAFFIC_FORECAST_UTILS_H
 #define TRAFFIC_FORECAST_UTILS_H
 
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <ostream>
 
 #include "crypt.h"
+#include "key_manager.h"
 
 using namespace std;
 
+/// Количество секунд в сутках.
+constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+/// Длина даты, отформатированной formatDateMDY / formatDateISO ("MM/DD/YYYY" или "YYYY-MM-DD").
+constexpr size_t FORMATTED_DATE_LENGTH = 10;
+
+/**
+ * Преобразует календарную дату (пролептический григорианский календарь) в количество дней с 1970-01-01.
+ * Не использует часовые пояса и libc. Значения дня вне месяца нормализуются арифметически
+ * (например, 30 февраля -> 1 или 2 марта), как это делает mktime.
+ * @param year год (например, 2020).
+ * @param month месяц 1..12.
+ * @param day день месяца 1..31.
+ * @return количество дней с начала эпохи (может быть отрицательным).
+ */
+int64_t daysFromCivil(int year, int month, int day);
+
+/**
+ * Обратное преобразование к daysFromCivil.
+ * @param days количество дней с 1970-01-01.
+ * @param year [out] год.
+ * @param month [out] месяц 1..12.
+ * @param day [out] день месяца 1..31.
+ */
+void civilFromDays(int64_t days, int &year, int &month, int &day);
+
+/**
+ * Разбирает дату формата "M/D/YYYY" или "MM/DD/YYYY" без выделения памяти.
+ * Допускаются окружающие пробелы, кавычки и завершающий '\r'.
+ * @param s строка с датой.
+ * @param days [out] количество дней с 1970-01-01.
+ * @return true при успешном разборе, false при ошибке (days не изменяется).
+ */
+bool parseDateMDY(string_view s, int64_t &days);
+
+/**
+ * Разбирает дату формата ISO-8601 "YYYY-MM-DD" без выделения памяти.
+ * Допускается хвост времени ("YYYY-MM-DDThh:mm:ss..."), который игнорируется.
+ * @param s строка с датой.
+ * @param days [out] количество дней с 1970-01-01.
+ * @return true при успешном разборе, false при ошибке (days не изменяется).
+ */
+bool parseDateISO(string_view s, int64_t &days);
+
 /**
- * Преобразует строку формата "MM/DD/YYYY" в time_t.
+ * Записывает дату в формате "MM/DD/YYYY" (ровно FORMATTED_DATE_LENGTH символов, без завершающего нуля).
+ * @param days количество дней с 1970-01-01 (годы 0..9999).
+ * @param out буфер размером не менее FORMATTED_DATE_LENGTH.
+ * @return количество записанных символов.
+ */
+size_t formatDateMDY(int64_t days, char *out);
+
+/**
+ * Записывает дату в формате ISO-8601 "YYYY-MM-DD" (ровно FORMATTED_DATE_LENGTH символов, без завершающего нуля).
+ * @param days количество дней с 1970-01-01 (годы 0..9999).
+ * @param out буфер размером не менее FORMATTED_DATE_LENGTH.
+ * @return количество записанных символов.
+ */
+size_t formatDateISO(int64_t days, char *out);
+
+/**
+ * Возвращает день недели для количества дней с начала эпохи.
+ * @param days количество дней с 1970-01-01.
+ * @return 0 — воскресенье, 1 — понедельник, ..., 6 — суббота.
+ */
+int weekdayFromDays(int64_t days);
+
+/**
+ * Возвращает английское название дня недели ("Sunday" ... "Saturday").
+ * @param days количество дней с 1970-01-01.
+ */
+const string &weekdayName(int64_t days);
+
+/**
+ * Переводит количество дней с начала эпохи в time_t (полночь UTC).
+ */
+constexpr time_t daysToTimeT(const int64_t days) {
+    return static_cast<time_t>(days * SECONDS_PER_DAY);
+}
+
+/**
+ * Переводит time_t в количество дней с начала эпохи (округление вниз, UTC).
+ */
+constexpr int64_t timeTToDays(const time_t t) {
+    const auto s = static_cast<int64_t>(t);
+    return s >= 0 ? s / SECONDS_PER_DAY : -((-s + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY);
+}
+
+/**
+ * Преобразует строку формата "MM/DD/YYYY" (или ISO "YYYY-MM-DD") в time_t.
  * Если парсинг не удаётся, возвращается time_t(0).
+ * Часовой пояс не учитывается: результат — полночь указанного дня по UTC.
  * @param s дата в виде строки "MM/DD/YYYY" (например, "12/31/2020").
- * @return значение time_t, соответствующее полуночи указанного дня в локальном часовом поясе, либо 0 при ошибке.
+ * @return значение time_t, соответствующее полуночи указанного дня (UTC), либо 0 при ошибке.
+ */
+time_t parseDateString(string_view s);
+
+/**
+ * @brief Результат разбора числа.
+ *
+ * Функции разбора не бросают исключений, а возвращают код результата.
+ */
+enum class ParseStatus {
+    Ok,               ///< Число успешно разобрано
+    Empty,            ///< Строка не содержит цифр
+    InvalidCharacter, ///< Встретился недопустимый символ
+    OutOfRange        ///< Значение не помещается в целевой тип
+};
+
+/**
+ * Разбирает целое число со знаком, пропуская разделители тысяч (запятые) и кавычки на месте,
+ * без копирования строки и без исключений. Окружающие пробелы и '\r' игнорируются.
+ * Пример: "\"1,234\"" -> 1234.
+ * @param s строковое представление числа.
+ * @param value [out] результат; изменяется только при ParseStatus::Ok.
+ * @return код результата разбора.
  */
-time_t parseDateString(const string &s);
+ParseStatus parseNumber(string_view s, int64_t &value);
+
+/**
+ * То же, что parseNumber для int64_t, но с проверкой диапазона int.
+ * @param s строковое представление числа.
+ * @param value [out] результат; изменяется только при ParseStatus::Ok.
+ * @return код результата разбора (OutOfRange, если значение не помещается в int).
+ */
+ParseStatus parseNumber(string_view s, int &value);
 
 /**
  * Преобразует строку с числом, где разделителем тысяч может быть запятая, в int.
  * Пример: "1,234" -> 1234. При ошибке возвращает 0.
+ * Для получения кода ошибки используйте parseNumber.
  * @param s строковое представление числа (возможно с запятыми).
- * @return целое значение, полученное после удаления запятых и приведения к int.
+ * @return целое значение либо 0 при ошибке.
  */
-int parseNumberString(const string &s);
+int parseNumberString(string_view s);
+
+/**
+ * Возвращает следующее поле строки CSV начиная с pos и сдвигает pos за разделитель.
+ * Запятые внутри кавычек (разделители тысяч, например "3,005") поле не разделяют.
+ * Если pos > line.size() после вызова, полей в строке больше нет.
+ * @param line строка CSV без перевода строки.
+ * @param pos [in,out] позиция начала поля.
+ * @return поле без разделителя (кавычки не удаляются).
+ */
+string_view nextCSVField(string_view line, size_t &pos);
+
+/**
+ * Убирает окружающие пробелы, кавычки и символы перевода строки поля CSV.
+ * @param s поле, например результат nextCSVField.
+ * @return часть s без окружающих символов.
+ */
+string_view trimField(string_view s);
+
+/**
+ * Вычисляет 64-битный хеш FNV-1a.
+ * Используется как контрольная сумма для обнаружения повреждений и изменений файлов
+ * (не является криптографической).
+ * @param data указатель на данные.
+ * @param size размер данных в байтах.
+ * @param seed начальное значение (для продолжения хеширования по частям).
+ * @return значение хеша.
+ */
+uint64_t fnv1a64(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
 
 /**
  * Выводит std::vector<T> в поток в формате [elem1, elem2, ...].
@@ -56,10 +209,13 @@ std::ostream& operator<<(std::ostream& os, const std::vector<T>& v);
 string nextDayString(const string& currentDay);
 
 /**
- * @brief Прибавляет к времени один календарный день (24 часа).
+ * @brief Возвращает полночь (UTC) следующего календарного дня.
+ *
+ * Расчёт ведётся в днях с начала эпохи, поэтому переходы на летнее время
+ * не сдвигают дату.
  *
  * @param currentDate Временная метка time_t.
- * @return time_t, соответствующий следующему дню (currentDate + 24*60*60).
+ * @return time_t, соответствующий полуночи следующего дня.
  */
 time_t nextDayTimeT(time_t currentDate);
 
@@ -70,18 +226,34 @@ time_t nextDayTimeT(time_t currentDate);
  * включая пути к файлам, параметры прогнозирования и настройки шифрования.
  */
 struct Args {
-    string csv_path;              ///< Путь к входному CSV файлу с данными
-    string output_path;           ///< Путь к выходному файлу для сохранения прогноза
-    int H;                        ///< Горизонт прогнозирования (количество точек)
-    int season_m;                 ///< Длина сезона для экспоненциального сглаживания
-    bool decrypt;                 ///< Флаг режима расшифровки файла
-    string decrypt_output_path;   ///< Путь к выходному файлу при расшифровке
-    bool encrypt_file;            ///< Флаг режима шифрования файла
-    string encrypt_output_path;   ///< Путь к выходному файлу при шифровании
-    bool help;                    ///< Флаг запроса справки
-    SeedKey crypt_key;            ///< Ключ шифрования SEED
-    bool has_error;               ///< Флаг ошибки при парсинге аргументов
-    SeedCryptor cryptor;          ///< Объект криптора для шифрования/расшифровки
+    string csv_path{};            ///< Путь к входному CSV файлу с данными
+    string output_path{};         ///< Путь к выходному файлу для сохранения прогноза
+    int H = 0;                    ///< Горизонт прогнозирования (количество точек)
+    int season_m = 0;             ///< Длина сезона для экспоненциального сглаживания
+    bool decrypt = false;         ///< Флаг режима расшифровки файла
+    string decrypt_output_path{}; ///< Путь к выходному файлу при расшифровке
+    bool encrypt_file = false;    ///< Флаг режима шифрования файла
+    string encrypt_output_path{}; ///< Путь к выходному файлу при шифровании
+    bool help = false;            ///< Флаг запроса справки
+    bool has_error = false;       ///< Флаг ошибки при парсинге аргументов
+    string snapshot_path{};       ///< Путь к бинарному снимку датасета (пусто — без снимка)
+    bool watch = false;           ///< Флаг режима наблюдения за дописыванием CSV
+    optional<time_t> date_from{}; ///< Начало диапазона дат истории (включительно)
+    optional<time_t> date_to{};   ///< Конец диапазона дат истории (включительно)
+    bool access_log = false;      ///< Входной файл — журнал доступа веб-сервера, а не CSV
+    string visitor_filter_path{}; ///< Файл фильтра уже встречавшихся посетителей (пусто — не разделять новых и вернувшихся)
+    bool long_format = false;     ///< Входной файл в длинном формате site_id,date,metric,value
+    vector<string> shard_paths{}; ///< Дополнительные CSV-файлы, объединяемые с csv_path по дате
+    bool keep_first_duplicate = false; ///< При повторе даты в нескольких файлах оставлять запись из более раннего файла
+    string fill_gaps{};           ///< Способ заполнения пропущенных дней: "linear", "seasonal" или пусто (не заполнять)
+    bool arena_stats = false;     ///< Вывести статистику арен временной памяти после прогноза
+    unsigned threads = 0;         ///< Общее число потоков исполнителя (0 — по числу ядер)
+    bool pin_threads = false;     ///< Закрепить рабочие потоки исполнителя за ядрами
+    vector<string> metrics{};     ///< Имена прогнозируемых метрик (пусто — все)
+    CipherMode cipher_mode = CipherMode::Chunked; ///< Режим шифрования для --encrypt
+    shared_ptr<const KeyManager> keys{}; ///< Ключи из --crypt / --newCryptKey (ID 0) и --keyring (nullptr — без шифрования)
+    KeyManager::KeyId key_id = KeyManager::DEFAULT_KEY_ID; ///< ID ключа для шифрования (--key-id)
+    bool encrypted_input = false; ///< csv_path зашифрован в формате CBC без заголовка (--encrypted-input)
 };
 
 /**
@@ -92,10 +264,27 @@ struct Args {
  * - --output <path>: путь к выходному файлу (по умолчанию "forecast.csv")
  * - --H <n>: горизонт прогнозирования (по умолчанию 30)
  * - --season_m <n>: длина сезона (по умолчанию 7)
- * - --crypt <key_file>: путь к файлу с ключом шифрования
- * - --newCryptKey <key_file>: генерация нового ключа и сохранение в файл
+ * - --crypt <key_file>: путь к файлу с ключом шифрования (ключ с ID 0)
+ * - --newCryptKey <key_file>: генерация нового ключа (ID 0) и сохранение в файл
+ * - --keyring <file>: файл связки ключей "<id> <hex>" (ключ расшифровки выбирается по ID из заголовка)
+ * - --key-id <n>: ID ключа для шифрования (по умолчанию 0)
  * - --decrypt <output_file>: расшифровка файла csv_path в output_file
  * - --encrypt <output_file>: шифрование файла csv_path в output_file
+ * - --snapshot <path>: кэшировать разобранный CSV в бинарном снимке
+ * - --watch: после прогноза ждать дописывания CSV и обновлять прогноз
+ * - --from <date>, --to <date>: использовать только историю из диапазона дат
+ * - --access-log: входной файл — журнал доступа в формате combined
+ * - --visitor-filter <path>: фильтр посетителей для разделения новых и вернувшихся
+ * - --long-format: входной файл в длинном формате (несколько сайтов и метрик)
+ * - --shard <path>: дополнительный CSV-файл того же ряда (можно указывать несколько раз)
+ * - --duplicates first|last: какую запись оставлять при повторе даты в нескольких файлах
+ * - --fill-gaps linear|seasonal: заполнять пропущенные дни перед прогнозом
+ * - --arena-stats: вывести статистику арен временной памяти
+ * - --threads <n>: общее число потоков для параллельной работы (0 — по числу ядер)
+ * - --pin-threads: закрепить рабочие потоки за ядрами
+ * - --metrics <list>: прогнозируемые метрики через запятую
+ * - --cipher cbc|ctr|chunked: режим шифрования для --encrypt (по умолчанию chunked)
+ * - --encrypted-input: csv_path зашифрован без заголовка (CBC); CTR и Chunked распознаются по заголовку
  * - --help, -h: вывод справки
  *
  * @param argc Количество аргументов командной строки
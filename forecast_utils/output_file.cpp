@@ -0,0 +1,174 @@
+#include "output_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "forecast_utils.h"
+
+namespace {
+    /// Наибольшее число буферов в одном вызове writev (IOV_MAX в Linux)
+    constexpr size_t MAX_IOVECS = 1024;
+}
+
+OutputBuffer &OutputBuffer::appendInt(const int64_t value) {
+    char buf[24];
+    const auto result = to_chars(buf, buf + sizeof(buf), value);
+    data.append(buf, result.ptr);
+    return *this;
+}
+
+OutputBuffer &OutputBuffer::appendDateMDY(const int64_t days) {
+    char buf[FORMATTED_DATE_LENGTH];
+    data.append(buf, formatDateMDY(days, buf));
+    return *this;
+}
+
+OutputBuffer &OutputBuffer::appendDateISO(const int64_t days) {
+    char buf[FORMATTED_DATE_LENGTH];
+    data.append(buf, formatDateISO(days, buf));
+    return *this;
+}
+
+namespace {
+    string_view asText(const span<const unsigned char> bytes) {
+        return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+    }
+}
+
+/**
+ * Имя временного файла уникально (mkostemp), поэтому одновременные запуски
+ * с одним path не пишут в один и тот же временный файл.
+ */
+AtomicOutputFile::AtomicOutputFile(string path, const SeedCryptor *cryptor, const CipherMode mode)
+    : path(std::move(path)), tmpPath(this->path + ".XXXXXX") {
+    fd = ::mkostemp(tmpPath.data(), O_CLOEXEC);
+    // mkostemp создаёт файл с правами 0600; прогноз должен быть доступен так же, как обычный файл
+    if (fd >= 0 && ::fchmod(fd, 0644) != 0) failed = true;
+    if (cryptor) encryptor.emplace(*cryptor, mode);
+}
+
+AtomicOutputFile::~AtomicOutputFile() {
+    if (fd >= 0) {
+        ::close(fd);
+        std::remove(tmpPath.c_str());
+    }
+}
+
+/**
+ * Без шифрования буферы уходят в writeRaw одним writev. С шифрованием каждый
+ * буфер шифруется и записывается сразу: шифротекст действителен только до
+ * следующего вызова шифровщика.
+ */
+bool AtomicOutputFile::write(const span<const string_view> buffers) {
+    if (!good()) return false;
+    if (!encryptor) return writeRaw(buffers);
+    for (const string_view buffer : buffers) {
+        const string_view cipher = asText(encryptor->update(
+            span(reinterpret_cast<const unsigned char *>(buffer.data()), buffer.size())));
+        if (!writeRaw(span<const string_view>(&cipher, 1))) return false;
+    }
+    return true;
+}
+
+/**
+ * writev может записать меньше запрошенного: записанные буферы пропускаются,
+ * частично записанный сдвигается, и вызов повторяется.
+ */
+bool AtomicOutputFile::writeRaw(const span<const string_view> buffers) {
+    vector<iovec> vecs;
+    vecs.reserve(min(buffers.size(), MAX_IOVECS));
+    for (size_t next = 0; next < buffers.size();) {
+        vecs.clear();
+        for (; next < buffers.size() && vecs.size() < MAX_IOVECS; ++next) {
+            if (buffers[next].empty()) continue;
+            vecs.push_back(iovec{const_cast<char *>(buffers[next].data()), buffers[next].size()});
+        }
+        size_t first = 0;
+        while (first < vecs.size()) {
+            const ssize_t written = ::writev(fd, vecs.data() + first, static_cast<int>(vecs.size() - first));
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                failed = true;
+                return false;
+            }
+            auto left = static_cast<size_t>(written);
+            while (first < vecs.size() && left >= vecs[first].iov_len) {
+                left -= vecs[first].iov_len;
+                ++first;
+            }
+            if (first < vecs.size()) {
+                vecs[first].iov_base = static_cast<char *>(vecs[first].iov_base) + left;
+                vecs[first].iov_len -= left;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Данные сбрасываются на диск (fsync) до переименования: иначе после сбоя
+ * питания по пути path может оказаться пустой или неполный файл. После
+ * переименования сбрасывается и каталог, чтобы сохранилась сама запись о нём.
+ */
+bool AtomicOutputFile::commit() {
+    if (fd < 0) return false;
+    if (encryptor && !failed) {
+        const string_view tail = asText(encryptor->finish());
+        writeRaw(span<const string_view>(&tail, 1));
+    }
+    const bool synced = !failed && ::fsync(fd) == 0;
+    const bool closed = ::close(fd) == 0;
+    fd = -1;
+    if (!synced || !closed || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    const size_t slash = path.rfind('/');
+    const string dir = slash == string::npos ? string(".") : slash == 0 ? string("/") : path.substr(0, slash);
+    if (const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+AtomicOutputStreamBuf::AtomicOutputStreamBuf(AtomicOutputFile &file, const size_t bufferSize)
+    : file(file), buffer(max<size_t>(bufferSize, 1)) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+bool AtomicOutputStreamBuf::flushBuffer() {
+    const string_view pending(pbase(), static_cast<size_t>(pptr() - pbase()));
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return pending.empty() || file.write(pending);
+}
+
+AtomicOutputStreamBuf::int_type AtomicOutputStreamBuf::overflow(const int_type ch) {
+    if (!flushBuffer()) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+/**
+ * Блоки не меньше буфера пишутся в файл напрямую, без копирования.
+ */
+streamsize AtomicOutputStreamBuf::xsputn(const char *s, const streamsize n) {
+    if (static_cast<size_t>(n) < buffer.size()) return streambuf::xsputn(s, n);
+    if (!flushBuffer() || !file.write(string_view(s, static_cast<size_t>(n)))) return 0;
+    return n;
+}
+
+int AtomicOutputStreamBuf::sync() {
+    return flushBuffer() ? 0 : -1;
+}
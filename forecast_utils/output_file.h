@@ -0,0 +1,171 @@
+#ifndef TRAFFIC_FORECAST_OUTPUT_FILE_H
+#define TRAFFIC_FORECAST_OUTPUT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crypt.h"
+
+using namespace std;
+
+/**
+ * @brief Буфер форматированного вывода.
+ *
+ * Числа форматируются через to_chars, даты — formatDateMDY / formatDateISO,
+ * без потоков ввода-вывода, локалей и промежуточных строк. Память
+ * буфера сохраняется между clear(), поэтому один буфер переиспользуется
+ * для многих порций вывода.
+ */
+class OutputBuffer {
+public:
+    /// Начальная ёмкость буфера
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit OutputBuffer(size_t capacity = DEFAULT_CAPACITY) { data.reserve(capacity); }
+
+    OutputBuffer &append(string_view text) {
+        data.append(text);
+        return *this;
+    }
+
+    OutputBuffer &append(char c) {
+        data.push_back(c);
+        return *this;
+    }
+
+    /**
+     * @brief Дописать целое число в десятичной записи.
+     */
+    OutputBuffer &appendInt(int64_t value);
+
+    /**
+     * @brief Дописать дату "MM/DD/YYYY".
+     * @param days Количество дней с 1970-01-01.
+     */
+    OutputBuffer &appendDateMDY(int64_t days);
+
+    /**
+     * @brief Дописать дату "YYYY-MM-DD".
+     * @param days Количество дней с 1970-01-01.
+     */
+    OutputBuffer &appendDateISO(int64_t days);
+
+    [[nodiscard]] string_view view() const { return data; }
+    [[nodiscard]] size_t size() const { return data.size(); }
+    [[nodiscard]] bool empty() const { return data.empty(); }
+    void clear() { data.clear(); }
+
+private:
+    string data;
+};
+
+/**
+ * @brief Файл, который появляется по своему пути только целиком.
+ *
+ * Данные пишутся во временный файл "<path>.XXXXXX" с уникальным именем
+ * (mkostemp) системным вызовом writev (несколько буферов за один вызов);
+ * commit() сбрасывает его на диск (fsync) и переименовывает в path.
+ * Если commit() не вызван или запись не удалась, временный файл удаляется,
+ * а прежний файл по пути path остаётся нетронутым. Читатели прогноза
+ * никогда не видят частично записанный файл.
+ *
+ * С криптором файл пишется зашифрованным: каждый буфер сразу проходит
+ * через SeedStreamEncryptor, и на диск попадает только шифротекст, а в
+ * памяти не копится весь открытый текст. Файлы независимы, поэтому
+ * несколько зашифрованных файлов с общим криптором можно писать из
+ * разных потоков одновременно.
+ */
+class AtomicOutputFile {
+public:
+    /**
+     * @param path Итоговый путь файла.
+     * @param cryptor Криптор для шифрования содержимого (nullptr — открытый текст);
+     * должен жить дольше файла.
+     * @param mode Режим шифрования.
+     */
+    explicit AtomicOutputFile(string path, const SeedCryptor *cryptor = nullptr,
+                              CipherMode mode = CipherMode::Chunked);
+    ~AtomicOutputFile();
+
+    AtomicOutputFile(const AtomicOutputFile &) = delete;
+    AtomicOutputFile &operator=(const AtomicOutputFile &) = delete;
+
+    /**
+     * @brief Удалось ли создать временный файл и не было ли ошибок записи.
+     */
+    [[nodiscard]] bool good() const { return fd >= 0 && !failed; }
+
+    /**
+     * @brief Записать буферы по порядку (writev, с дозаписью при частичной записи).
+     * @return false при ошибке записи.
+     */
+    bool write(span<const string_view> buffers);
+
+    /**
+     * @brief Записать один буфер.
+     */
+    bool write(string_view buffer) { return write(span<const string_view>(&buffer, 1)); }
+
+    /**
+     * @brief Сбросить временный файл на диск, закрыть и атомарно заменить им path.
+     *
+     * Для зашифрованного файла сначала дописывается остаток шифротекста.
+     *
+     * @return false, если запись или переименование не удались.
+     */
+    bool commit();
+
+private:
+    /**
+     * @brief Записать буферы в файл как есть.
+     */
+    bool writeRaw(span<const string_view> buffers);
+
+    string path;
+    string tmpPath;
+    int fd = -1;
+    bool failed = false;
+    optional<SeedStreamEncryptor> encryptor;
+};
+
+/**
+ * @brief Буфер потока поверх AtomicOutputFile.
+ *
+ * Позволяет писать через std::ostream (например, SeedCryptor::encryptStream)
+ * в файл, который появляется по своему пути только после commit().
+ * Ошибка записи переводит поток в состояние ошибки при очередном сбросе
+ * буфера; commit() самого файла вызывается после проверки потока.
+ */
+class AtomicOutputStreamBuf : public streambuf {
+public:
+    /// Размер буфера по умолчанию
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+    /**
+     * @param file Файл назначения (должен жить дольше буфера).
+     * @param bufferSize Размер буфера в байтах.
+     */
+    explicit AtomicOutputStreamBuf(AtomicOutputFile &file, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+protected:
+    int_type overflow(int_type ch) override;
+    streamsize xsputn(const char *s, streamsize n) override;
+    int sync() override;
+
+private:
+    /**
+     * @brief Записать накопленное в файл и очистить буфер.
+     */
+    bool flushBuffer();
+
+    AtomicOutputFile &file;
+    vector<char> buffer;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "access_log.h"
+
+#include <array>
+#include <fstream>
+
+#include "forecast_utils.h"
+
+namespace {
+    /// Размер порции, которой читается журнал.
+    constexpr size_t LOG_READ_CHUNK = 1 << 20;
+
+    /// Расширения статических ресурсов, запросы к которым не считаются загрузками страниц.
+    constexpr array<string_view, 14> ASSET_EXTENSIONS = {
+        ".css", ".js", ".png", ".jpg", ".jpeg", ".gif", ".ico",
+        ".svg", ".webp", ".woff", ".woff2", ".ttf", ".map", ".txt"
+    };
+
+    /**
+     * Разбирает ровно count цифр начиная с pos.
+     */
+    bool parseDigits(const string_view s, const size_t pos, const size_t count, int &value) {
+        if (pos + count > s.size()) return false;
+        value = 0;
+        for (size_t i = pos; i < pos + count; ++i) {
+            const char c = s[i];
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    /**
+     * Номер месяца (1–12) по трёхбуквенному английскому сокращению, 0 — если не распознан.
+     */
+    int parseMonthName(const string_view s) {
+        static constexpr array<string_view, 12> months = {
+            "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+        for (size_t i = 0; i < months.size(); ++i) {
+            if (s == months[i]) return static_cast<int>(i) + 1;
+        }
+        return 0;
+    }
+
+    /**
+     * Разбирает время журнала "10/Oct/2000:13:55:36 -0700" в секунды с начала эпохи.
+     * Без convertToUTC смещение пояса игнорируется (время остаётся местным для сервера).
+     */
+    bool parseLogTimestamp(const string_view s, const bool convertToUTC, int64_t &timestamp) {
+        int day, year, hour, minute, second;
+        if (s.size() < 20 || s[2] != '/' || s[6] != '/' || s[11] != ':' || s[14] != ':' || s[17] != ':') return false;
+        if (!parseDigits(s, 0, 2, day) || !parseDigits(s, 7, 4, year) || !parseDigits(s, 12, 2, hour) ||
+            !parseDigits(s, 15, 2, minute) || !parseDigits(s, 18, 2, second)) {
+            return false;
+        }
+        const int month = parseMonthName(s.substr(3, 3));
+        if (month == 0 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+        timestamp = daysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+        if (convertToUTC && s.size() >= 26 && s[20] == ' ' && (s[21] == '+' || s[21] == '-')) {
+            int zoneHours, zoneMinutes;
+            if (!parseDigits(s, 22, 2, zoneHours) || !parseDigits(s, 24, 2, zoneMinutes)) return false;
+            const int64_t offset = zoneHours * 3600 + zoneMinutes * 60;
+            timestamp += s[21] == '+' ? -offset : offset;
+        }
+        return true;
+    }
+
+    /**
+     * Возвращает поле в кавычках начиная с pos (pos указывает на открывающую кавычку)
+     * и сдвигает pos за закрывающую. Экранированные кавычки (\") поле не закрывают.
+     */
+    bool nextQuoted(const string_view line, size_t &pos, string_view &field) {
+        if (pos >= line.size() || line[pos] != '"') return false;
+        const size_t start = ++pos;
+        while (pos < line.size() && line[pos] != '"') {
+            pos += line[pos] == '\\' ? 2 : 1;
+        }
+        if (pos >= line.size()) return false;
+        field = line.substr(start, pos - start);
+        ++pos;
+        return true;
+    }
+
+    /**
+     * Пропускает пробелы начиная с pos.
+     */
+    void skipSpaces(const string_view line, size_t &pos) {
+        while (pos < line.size() && line[pos] == ' ') ++pos;
+    }
+
+    /**
+     * Является ли путь запросом к статическому ресурсу (по расширению, без учёта параметров).
+     */
+    bool isAsset(string_view path) {
+        if (const size_t query = path.find_first_of("?#"); query != string_view::npos) {
+            path = path.substr(0, query);
+        }
+        const size_t dot = path.rfind('.');
+        if (dot == string_view::npos || path.find('/', dot) != string_view::npos) return false;
+        const string_view ext = path.substr(dot);
+        for (const string_view asset : ASSET_EXTENSIONS) {
+            if (ext.size() == asset.size() &&
+                equal(ext.begin(), ext.end(), asset.begin(), [](const char a, const char b) {
+                    return (a >= 'A' && a <= 'Z' ? a - 'A' + 'a' : a) == b;
+                })) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Считается ли запрос загрузкой страницы.
+     */
+    bool isPageLoad(const AccessLogRecord &record, const bool countAssets) {
+        const bool success = (record.status >= 200 && record.status < 300) || record.status == 304;
+        return success && record.method == "GET" && (countAssets || !isAsset(record.path));
+    }
+}
+
+bool parseAccessLogLine(const string_view line, const bool convertToUTC, AccessLogRecord &record) {
+    size_t pos = line.find(' ');
+    if (pos == string_view::npos || pos == 0) return false;
+    record.host = line.substr(0, pos);
+
+    const size_t open = line.find('[', pos);
+    if (open == string_view::npos) return false;
+    const size_t close = line.find(']', open);
+    if (close == string_view::npos) return false;
+    if (!parseLogTimestamp(line.substr(open + 1, close - open - 1), convertToUTC, record.timestamp)) return false;
+
+    pos = close + 1;
+    skipSpaces(line, pos);
+    string_view request;
+    if (!nextQuoted(line, pos, request)) return false;
+    const size_t methodEnd = request.find(' ');
+    record.method = request.substr(0, methodEnd);
+    record.path = {};
+    if (methodEnd != string_view::npos) {
+        const size_t pathEnd = request.find(' ', methodEnd + 1);
+        record.path = request.substr(methodEnd + 1, pathEnd == string_view::npos ? string_view::npos : pathEnd - methodEnd - 1);
+    }
+
+    skipSpaces(line, pos);
+    const size_t statusEnd = min(line.find(' ', pos), line.size());
+    if (parseNumber(line.substr(pos, statusEnd - pos), record.status) != ParseStatus::Ok) return false;
+    pos = statusEnd;
+
+    // Необязательные поля: размер ответа, "referer" и "agent"
+    record.userAgent = {};
+    skipSpaces(line, pos);
+    pos = min(line.find(' ', pos), line.size());
+    skipSpaces(line, pos);
+    if (string_view referer; nextQuoted(line, pos, referer)) {
+        skipSpaces(line, pos);
+        string_view agent;
+        if (nextQuoted(line, pos, agent)) record.userAgent = agent;
+    }
+    return true;
+}
+
+AccessLogIngester::AccessLogIngester(AccessLogOptions options) : options(options) {
+    if (this->options.maxOpenBuckets == 0) this->options.maxOpenBuckets = 1;
+}
+
+int64_t AccessLogIngester::bucketSeconds() const {
+    return options.bucket == LogBucket::Hour ? 3600 : SECONDS_PER_DAY;
+}
+
+/**
+ * @brief Прочитать журнал порциями по LOG_READ_CHUNK байт.
+ *
+ * Недочитанная строка в конце порции переносится в следующую.
+ */
+bool AccessLogIngester::ingestFile(const string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    string buffer;
+    while (true) {
+        const size_t carried = buffer.size();
+        buffer.resize(carried + LOG_READ_CHUNK);
+        file.read(buffer.data() + carried, static_cast<streamsize>(LOG_READ_CHUNK));
+        const auto got = static_cast<size_t>(file.gcount());
+        buffer.resize(carried + got);
+        const bool atEOF = got < LOG_READ_CHUNK;
+
+        const string_view data(buffer);
+        size_t start = 0;
+        for (size_t end; (end = data.find('\n', start)) != string_view::npos; start = end + 1) {
+            ingestLine(data.substr(start, end - start));
+        }
+        if (atEOF) {
+            if (start < data.size()) ingestLine(data.substr(start));
+            break;
+        }
+        buffer.erase(0, start);
+    }
+    return true;
+}
+
+void AccessLogIngester::ingestLine(string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty()) return;
+    ++counters.lines;
+
+    AccessLogRecord record;
+    if (!parseAccessLogLine(line, options.convertToUTC, record)) {
+        ++counters.malformed;
+        return;
+    }
+    if (!isPageLoad(record, options.countAssets)) return;
+    ++counters.pageLoads;
+
+    const int64_t step = bucketSeconds();
+    const int64_t key = (record.timestamp >= 0 ? record.timestamp : record.timestamp - step + 1) / step;
+    auto [it, inserted] = buckets.try_emplace(key);
+    Bucket &bucket = it->second;
+    ++bucket.pageLoads;
+
+    if (inserted && key >= closedBefore) {
+        bucket.visitors.emplace(options.hllPrecision);
+        if (seenVisitors) bucket.firstTime.emplace(options.hllPrecision);
+        ++openBuckets;
+    }
+    if (!bucket.visitors) {
+        ++counters.late;
+        return;
+    }
+
+    // Посетитель — пара адрес + User-Agent
+    const uint64_t visitor = hashBytes(record.userAgent, hashBytes(record.host));
+    bucket.visitors->addHash(visitor);
+    if (seenVisitors && seenVisitors->insert(visitor) && bucket.firstTime) {
+        bucket.firstTime->addHash(visitor);
+    }
+    if (inserted) closeOldBuckets();
+}
+
+/**
+ * Закрывает самые старые открытые интервалы, пока их больше maxOpenBuckets.
+ * Открытыми всегда остаются интервалы с ключом не меньше closedBefore.
+ */
+void AccessLogIngester::closeOldBuckets() {
+    while (openBuckets > options.maxOpenBuckets) {
+        const auto it = buckets.lower_bound(closedBefore);
+        Bucket &bucket = it->second;
+        bucket.uniqueVisitors = bucket.visitors->estimate();
+        bucket.firstTimeVisitors = bucket.firstTime ? bucket.firstTime->estimate() : 0;
+        bucket.visitors.reset();
+        bucket.firstTime.reset();
+        closedBefore = it->first + 1;
+        --openBuckets;
+    }
+}
+
+Dataset AccessLogIngester::toDataset(size_t *outliers) const {
+    Dataset dataset;
+    if (outliers) *outliers = 0;
+    if (buckets.empty()) return dataset;
+
+    const int64_t step = bucketSeconds();
+    // Группы соседних интервалов без разрывов длиннее maxGapSeconds; берём группу с наибольшим числом загрузок
+    const int64_t maxGap = max<int64_t>(options.maxGapSeconds / step, 1);
+    auto first = buckets.begin(), last = buckets.begin();
+    uint64_t bestLoads = 0, totalLoads = 0;
+    for (auto groupStart = buckets.begin(); groupStart != buckets.end();) {
+        auto groupEnd = groupStart;
+        uint64_t loads = groupEnd->second.pageLoads;
+        for (auto next = std::next(groupEnd); next != buckets.end() && next->first - groupEnd->first <= maxGap; ++next) {
+            groupEnd = next;
+            loads += groupEnd->second.pageLoads;
+        }
+        if (loads > bestLoads) {
+            bestLoads = loads;
+            first = groupStart;
+            last = groupEnd;
+        }
+        totalLoads += loads;
+        groupStart = std::next(groupEnd);
+    }
+    if (outliers) *outliers = static_cast<size_t>(totalLoads - bestLoads);
+
+    vector<DatasetValue> rows;
+    rows.reserve(static_cast<size_t>(last->first - first->first + 1));
+    auto it = first;
+    for (int64_t key = first->first; key <= last->first; ++key) {
+        uint64_t pageLoads = 0, uniqueVisitors = 0, firstTimeVisitors = 0;
+        if (it->first == key) {
+            const Bucket &bucket = it->second;
+            pageLoads = bucket.pageLoads;
+            uniqueVisitors = bucket.visitors ? bucket.visitors->estimate() : bucket.uniqueVisitors;
+            firstTimeVisitors = bucket.firstTime ? bucket.firstTime->estimate() : bucket.firstTimeVisitors;
+            // Оценки независимы, поэтому новых может оказаться больше уникальных
+            firstTimeVisitors = min(firstTimeVisitors, uniqueVisitors);
+            ++it;
+        }
+        const int64_t start = key * step;
+        const int64_t days = start >= 0 ? start / SECONDS_PER_DAY : (start - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY;
+        rows.emplace_back(weekdayName(days), weekdayFromDays(days) + 1, static_cast<time_t>(start),
+                          static_cast<int>(min<uint64_t>(pageLoads, INT32_MAX)),
+                          static_cast<int>(min<uint64_t>(uniqueVisitors, INT32_MAX)),
+                          static_cast<int>(min<uint64_t>(firstTimeVisitors, INT32_MAX)),
+                          static_cast<int>(min<uint64_t>(uniqueVisitors - firstTimeVisitors, INT32_MAX)));
+    }
+    dataset.setRows(std::move(rows));
+    return dataset;
+}
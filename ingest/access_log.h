@@ -0,0 +1,162 @@
+#ifndef TRAFFIC_FORECAST_ACCESS_LOG_H
+#define TRAFFIC_FORECAST_ACCESS_LOG_H
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "Dataset.h"
+#include "sketch.h"
+
+using namespace std;
+
+/**
+ * @brief Размер интервала, по которому группируются запросы.
+ */
+enum class LogBucket {
+    Day,  ///< Сутки
+    Hour  ///< Час
+};
+
+/**
+ * @brief Параметры разбора журнала доступа.
+ */
+struct AccessLogOptions {
+    LogBucket bucket = LogBucket::Day;                   ///< Размер интервала
+    bool convertToUTC = false;                           ///< Приводить время к UTC по смещению из журнала (иначе — местное время сервера)
+    bool countAssets = false;                            ///< Учитывать запросы статических файлов (css, js, картинки) как загрузки страниц
+    uint8_t hllPrecision = HyperLogLog::DEFAULT_PRECISION; ///< Точность HyperLogLog для уникальных посетителей
+    size_t maxOpenBuckets = 48;                          ///< Сколько интервалов держать открытыми для запоздавших строк
+    int64_t maxGapSeconds = 366 * SECONDS_PER_DAY;       ///< Разрыв без запросов, за которым интервалы считаются выбросами (см. toDataset)
+};
+
+/**
+ * @brief Одна запись журнала в формате combined (nginx/Apache).
+ *
+ * Все строковые поля ссылаются на исходную строку журнала.
+ */
+struct AccessLogRecord {
+    string_view host;       ///< Адрес клиента
+    int64_t timestamp = 0;  ///< Время запроса, секунды с начала эпохи
+    string_view method;     ///< Метод HTTP
+    string_view path;       ///< Запрошенный путь (с параметрами)
+    int status = 0;         ///< Код ответа
+    string_view userAgent;  ///< User-Agent (пусто, если поле отсутствует)
+};
+
+/**
+ * @brief Разобрать строку журнала в формате combined или common.
+ *
+ * Формат: host ident user [dd/Mon/yyyy:hh:mm:ss +zzzz] "METHOD path PROTO" status bytes "referer" "agent".
+ * Поля referer и agent необязательны.
+ *
+ * @param line Строка журнала без перевода строки.
+ * @param convertToUTC Вычитать ли смещение часового пояса из времени.
+ * @param record [out] Разобранная запись.
+ * @return true, если строка разобрана.
+ */
+bool parseAccessLogLine(string_view line, bool convertToUTC, AccessLogRecord &record);
+
+/**
+ * @brief Статистика разбора журнала.
+ */
+struct AccessLogStats {
+    size_t lines = 0;       ///< Прочитано строк
+    size_t malformed = 0;   ///< Строк, которые не удалось разобрать
+    size_t pageLoads = 0;   ///< Учтено загрузок страниц
+    size_t late = 0;        ///< Загрузок, пришедших после закрытия своего интервала (уникальные посетители по ним не учтены)
+};
+
+/**
+ * @brief Потоковый разбор журналов доступа в набор данных.
+ *
+ * Файлы читаются блоками по 1 МиБ, строки разбираются без копирования.
+ * Загрузкой страницы считается успешный (2xx или 304) запрос GET к
+ * не статическому ресурсу. Посетитель определяется парой адрес + User-Agent;
+ * уникальные посетители интервала оцениваются HyperLogLog-скетчем.
+ *
+ * Память ограничена: открытыми держатся не более maxOpenBuckets последних
+ * интервалов, более старые закрываются (скетч заменяется итоговой оценкой).
+ * Журналы почти упорядочены по времени, поэтому запоздавшие строки редки;
+ * их загрузки учитываются, а посетители — нет (см. AccessLogStats::late).
+ */
+class AccessLogIngester {
+public:
+    explicit AccessLogIngester(AccessLogOptions options = {});
+
+    /**
+     * @brief Прочитать журнал целиком.
+     *
+     * Можно вызывать несколько раз для разных файлов (например, ротированных журналов).
+     *
+     * @param path Путь к файлу журнала.
+     * @return false, если файл не удалось открыть.
+     */
+    bool ingestFile(const string &path);
+
+    /**
+     * @brief Учесть одну строку журнала.
+     */
+    void ingestLine(string_view line);
+
+    /**
+     * @brief Включить разделение посетителей на новых и вернувшихся.
+     *
+     * Посетитель, которого ещё нет в фильтре, считается новым в интервале
+     * своего первого запроса и добавляется в фильтр; количество новых
+     * посетителей интервала оценивается отдельным HyperLogLog-скетчем,
+     * вернувшиеся — как разность уникальных и новых. Фильтр хранит всех
+     * посетителей за прошлые запуски, поэтому его нужно сохранять между
+     * ними (ScalableBloomFilter::save / load). Журналы должны подаваться
+     * в хронологическом порядке.
+     *
+     * Вызывается до разбора журналов; фильтр должен жить дольше разборщика.
+     *
+     * @param filter Фильтр уже встречавшихся посетителей (nullptr — выключить).
+     */
+    void setVisitorFilter(ScalableBloomFilter *filter) { seenVisitors = filter; }
+
+    /**
+     * @brief Построить набор данных по накопленным интервалам.
+     *
+     * Интервалы без запросов между первым и последним заполняются нулями,
+     * чтобы ряд оставался непрерывным. Поля firstTimeVisitors и
+     * returningVisitors заполняются, только если задан фильтр посетителей
+     * (см. setVisitorFilter), иначе равны нулю.
+     *
+     * Интервалы делятся на группы разрывами длиннее maxGapSeconds; в набор
+     * попадает только группа с наибольшим числом загрузок. Так одна строка
+     * с ошибочным годом (например, 9999) не растягивает ряд на миллионы
+     * пустых интервалов.
+     *
+     * @param outliers [out] если не нулевой — загрузок в отброшенных интервалах.
+     */
+    [[nodiscard]] Dataset toDataset(size_t *outliers = nullptr) const;
+
+    [[nodiscard]] const AccessLogStats &stats() const { return counters; }
+
+private:
+    /// Интервал: открытый хранит скетч, закрытый — только итоговую оценку
+    struct Bucket {
+        uint64_t pageLoads = 0;
+        uint64_t uniqueVisitors = 0;
+        uint64_t firstTimeVisitors = 0;
+        optional<HyperLogLog> visitors{};
+        optional<HyperLogLog> firstTime{};
+    };
+
+    AccessLogOptions options;
+    AccessLogStats counters;
+    map<int64_t, Bucket> buckets;
+    size_t openBuckets = 0;
+    int64_t closedBefore = INT64_MIN; ///< Интервалы с меньшим ключом закрыты
+    ScalableBloomFilter *seenVisitors = nullptr;
+
+    [[nodiscard]] int64_t bucketSeconds() const;
+    void closeOldBuckets();
+};
+
+#endif
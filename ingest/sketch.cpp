@@ -0,0 +1,309 @@
+#include "sketch.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "forecast_utils.h"
+
+namespace {
+    /**
+     * Заголовок файла фильтра Блума (40 байт).
+     */
+    struct BloomHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t layerCount;
+        uint64_t initialCapacity;
+        double errorRate;
+        uint64_t checksum;
+    };
+    static_assert(sizeof(BloomHeader) == 40, "BloomHeader must be 40 bytes");
+
+    /**
+     * Описание слоя в файле (32 байта); битовые массивы следуют за каталогом в том же порядке.
+     */
+    struct BloomLayerInfo {
+        uint64_t bitCount;
+        uint32_t hashCount;
+        uint32_t reserved;
+        uint64_t capacity;
+        uint64_t count;
+    };
+    static_assert(sizeof(BloomLayerInfo) == 32, "BloomLayerInfo must be 32 bytes");
+
+    /// Во сколько раз растёт ёмкость каждого следующего слоя
+    constexpr uint64_t BLOOM_GROWTH = 2;
+    /// Во сколько раз уменьшается вероятность ошибки каждого следующего слоя
+    constexpr double BLOOM_TIGHTENING = 0.5;
+    /// Ограничение на количество слоёв (защита от повреждённых файлов)
+    constexpr uint32_t BLOOM_MAX_LAYERS = 48;
+
+    /**
+     * Вторая хеш-функция для двойного хеширования (Kirsch–Mitzenmacher);
+     * нечётна, чтобы последовательность индексов не зацикливалась раньше времени.
+     */
+    uint64_t secondHash(const uint64_t hash) {
+        return mixHash(hash ^ 0x9e3779b97f4a7c15ULL) | 1;
+    }
+}
+
+uint64_t hashBytes(const string_view data, const uint64_t seed) {
+    return mixHash(fnv1a64(data.data(), data.size(), 0xcbf29ce484222325ULL ^ mixHash(seed)));
+}
+
+HyperLogLog::HyperLogLog(const uint8_t precision)
+    : precision(clamp(precision, MIN_PRECISION, MAX_PRECISION)),
+      registers(size_t{1} << this->precision, 0) {}
+
+/**
+ * Индекс регистра — старшие precision бит хеша, ранг — номер первой
+ * единицы в оставшихся битах.
+ */
+void HyperLogLog::addHash(const uint64_t hash) {
+    const size_t index = hash >> (64 - precision);
+    const uint64_t rest = hash << precision;
+    const int maxRank = 64 - precision + 1;
+    const int rank = rest == 0 ? maxRank : min(countl_zero(rest) + 1, maxRank);
+    if (registers[index] < rank) {
+        registers[index] = static_cast<uint8_t>(rank);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const {
+    const double m = static_cast<double>(registers.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (const uint8_t r : registers) {
+        sum += ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+    // Поправка для малых кардинальностей: линейный подсчёт по пустым регистрам.
+    // Коррекция больших значений не нужна — хеш 64-битный.
+    if (raw <= 2.5 * m && zeros > 0) {
+        return static_cast<uint64_t>(llround(m * log(m / static_cast<double>(zeros))));
+    }
+    return static_cast<uint64_t>(llround(raw));
+}
+
+bool HyperLogLog::merge(const HyperLogLog &other) {
+    if (other.precision != precision) {
+        return false;
+    }
+    for (size_t i = 0; i < registers.size(); ++i) {
+        registers[i] = max(registers[i], other.registers[i]);
+    }
+    return true;
+}
+
+void HyperLogLog::clear() {
+    ranges::fill(registers, 0);
+}
+
+bool HyperLogLog::empty() const {
+    return ranges::all_of(registers, [](const uint8_t r) { return r == 0; });
+}
+
+ScalableBloomFilter::ScalableBloomFilter(const uint64_t initialCapacity, const double errorRate)
+    : initialCapacity(max<uint64_t>(initialCapacity, 1)),
+      errorRate(errorRate > 0.0 && errorRate < 1.0 ? errorRate : 0.001) {
+    addLayer();
+}
+
+ScalableBloomFilter::~ScalableBloomFilter() {
+    unmap();
+}
+
+ScalableBloomFilter::ScalableBloomFilter(ScalableBloomFilter &&other) noexcept
+    : initialCapacity(other.initialCapacity), errorRate(other.errorRate), layers(std::move(other.layers)),
+      mapping(exchange(other.mapping, nullptr)), mappingSize(exchange(other.mappingSize, 0)) {}
+
+ScalableBloomFilter &ScalableBloomFilter::operator=(ScalableBloomFilter &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        initialCapacity = other.initialCapacity;
+        errorRate = other.errorRate;
+        layers = std::move(other.layers);
+        mapping = exchange(other.mapping, nullptr);
+        mappingSize = exchange(other.mappingSize, 0);
+    }
+    return *this;
+}
+
+void ScalableBloomFilter::unmap() {
+    if (mapping) ::munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+/**
+ * Слой i имеет ёмкость initialCapacity * 2^i и вероятность ошибки
+ * errorRate * (1 - r) * r^i, так что сумма по всем слоям не превышает errorRate.
+ * Размер: m = -n ln p / ln² 2 бит, k = log2(1 / p) хеш-функций.
+ */
+void ScalableBloomFilter::addLayer() {
+    const size_t index = layers.size();
+    Layer layer;
+    layer.capacity = index == 0 ? initialCapacity : layers.back().capacity * BLOOM_GROWTH;
+    const double p = errorRate * (1.0 - BLOOM_TIGHTENING) * pow(BLOOM_TIGHTENING, static_cast<double>(index));
+    const double bits = -static_cast<double>(layer.capacity) * log(p) / (M_LN2 * M_LN2);
+    layer.bitCount = (static_cast<uint64_t>(ceil(bits)) + 63) / 64 * 64;
+    layer.hashCount = max<uint32_t>(1, static_cast<uint32_t>(ceil(-log2(p))));
+    layer.storage.assign(layer.bitCount / 64, 0);
+    layer.words = layer.storage.data();
+    layers.push_back(std::move(layer));
+}
+
+bool ScalableBloomFilter::contains(const uint64_t hash) const {
+    const uint64_t step = secondHash(hash);
+    for (const Layer &layer : layers) {
+        bool found = true;
+        uint64_t h = hash;
+        for (uint32_t i = 0; i < layer.hashCount; ++i, h += step) {
+            const uint64_t bit = h % layer.bitCount;
+            if (!(layer.words[bit / 64] & (uint64_t{1} << (bit % 64)))) {
+                found = false;
+                break;
+            }
+        }
+        if (found) return true;
+    }
+    return false;
+}
+
+bool ScalableBloomFilter::insert(const uint64_t hash) {
+    if (contains(hash)) return false;
+    if (layers.back().count >= layers.back().capacity && layers.size() < BLOOM_MAX_LAYERS) {
+        addLayer();
+    }
+
+    Layer &layer = layers.back();
+    const uint64_t step = secondHash(hash);
+    uint64_t h = hash;
+    for (uint32_t i = 0; i < layer.hashCount; ++i, h += step) {
+        const uint64_t bit = h % layer.bitCount;
+        layer.words[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+    ++layer.count;
+    return true;
+}
+
+uint64_t ScalableBloomFilter::size() const {
+    uint64_t total = 0;
+    for (const Layer &layer : layers) total += layer.count;
+    return total;
+}
+
+size_t ScalableBloomFilter::memoryBytes() const {
+    size_t total = 0;
+    for (const Layer &layer : layers) total += layer.bitCount / 8;
+    return total;
+}
+
+bool ScalableBloomFilter::save(const string &path) const {
+    vector<BloomLayerInfo> directory;
+    directory.reserve(layers.size());
+    for (const Layer &layer : layers) {
+        directory.push_back(BloomLayerInfo{layer.bitCount, layer.hashCount, 0, layer.capacity, layer.count});
+    }
+
+    BloomHeader header{};
+    memcpy(header.magic, MAGIC.data(), MAGIC.size());
+    header.version = VERSION;
+    header.layerCount = static_cast<uint32_t>(layers.size());
+    header.initialCapacity = initialCapacity;
+    header.errorRate = errorRate;
+    header.checksum = fnv1a64(directory.data(), directory.size() * sizeof(BloomLayerInfo));
+
+    const string tmpPath = path + ".tmp";
+    {
+        ofstream file(tmpPath, ios::binary | ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(directory.data()),
+                   static_cast<streamsize>(directory.size() * sizeof(BloomLayerInfo)));
+        for (const Layer &layer : layers) {
+            file.write(reinterpret_cast<const char *>(layer.words), static_cast<streamsize>(layer.bitCount / 8));
+        }
+        if (!file.good()) {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Битовые массивы не копируются: слои указывают прямо в отображение файла.
+ * Заголовок и каталог кратны 8 байтам, поэтому массивы выровнены.
+ */
+bool ScalableBloomFilter::load(const string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    void *data = MAP_FAILED;
+    size_t size = 0;
+    if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(BloomHeader))) {
+        size = static_cast<size_t>(st.st_size);
+        data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    const auto *bytes = static_cast<unsigned char *>(data);
+    BloomHeader header{};
+    memcpy(&header, bytes, sizeof(header));
+    const size_t directorySize = static_cast<size_t>(header.layerCount) * sizeof(BloomLayerInfo);
+    bool valid = memcmp(header.magic, MAGIC.data(), MAGIC.size()) == 0 && header.version == VERSION &&
+                 header.layerCount > 0 && header.layerCount <= BLOOM_MAX_LAYERS &&
+                 size >= sizeof(header) + directorySize &&
+                 fnv1a64(bytes + sizeof(header), directorySize) == header.checksum;
+
+    vector<Layer> loaded;
+    size_t offset = sizeof(header) + directorySize;
+    for (uint32_t i = 0; valid && i < header.layerCount; ++i) {
+        BloomLayerInfo info{};
+        memcpy(&info, bytes + sizeof(header) + i * sizeof(BloomLayerInfo), sizeof(info));
+        if (info.bitCount == 0 || info.bitCount % 64 != 0 || info.hashCount == 0 || size - offset < info.bitCount / 8) {
+            valid = false;
+            break;
+        }
+        Layer layer;
+        layer.bitCount = info.bitCount;
+        layer.hashCount = info.hashCount;
+        layer.capacity = info.capacity;
+        layer.count = info.count;
+        layer.words = reinterpret_cast<uint64_t *>(static_cast<unsigned char *>(data) + offset);
+        offset += info.bitCount / 8;
+        loaded.push_back(std::move(layer));
+    }
+    if (!valid) {
+        ::munmap(data, size);
+        return false;
+    }
+
+    unmap();
+    mapping = data;
+    mappingSize = size;
+    initialCapacity = header.initialCapacity;
+    errorRate = header.errorRate;
+    layers = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,195 @@
+#ifndef TRAFFIC_FORECAST_SKETCH_H
+#define TRAFFIC_FORECAST_SKETCH_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief 64-битный хеш строки для вероятностных структур.
+ *
+ * FNV-1a с финальным перемешиванием (fmix64 из MurmurHash3): у чистого
+ * FNV-1a старшие биты распределены плохо, а HyperLogLog берёт индекс
+ * регистра именно из них.
+ *
+ * @param data Хешируемые байты.
+ * @param seed Начальное значение (для получения независимых хешей).
+ */
+uint64_t hashBytes(string_view data, uint64_t seed = 0);
+
+/**
+ * @brief Финальное перемешивание 64-битного значения (fmix64).
+ */
+constexpr uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @brief Оценка количества различных элементов (HyperLogLog).
+ *
+ * Хранит 2^precision однобайтовых регистров: при precision = 12 это 4 КиБ
+ * и стандартная ошибка около 1.04 / sqrt(4096) ≈ 1.6%. Для малых
+ * кардинальностей используется линейный подсчёт по пустым регистрам.
+ */
+class HyperLogLog {
+    uint8_t precision;
+    vector<uint8_t> registers;
+
+public:
+    /// Минимальная поддерживаемая точность
+    static constexpr uint8_t MIN_PRECISION = 4;
+    /// Максимальная поддерживаемая точность
+    static constexpr uint8_t MAX_PRECISION = 18;
+    /// Точность по умолчанию
+    static constexpr uint8_t DEFAULT_PRECISION = 12;
+
+    /**
+     * @param precision Количество бит хеша для индекса регистра
+     *        (ограничивается диапазоном [MIN_PRECISION, MAX_PRECISION]).
+     */
+    explicit HyperLogLog(uint8_t precision = DEFAULT_PRECISION);
+
+    /**
+     * @brief Учесть элемент по его 64-битному хешу.
+     */
+    void addHash(uint64_t hash);
+
+    /**
+     * @brief Учесть элемент.
+     */
+    void add(string_view item) { addHash(hashBytes(item)); }
+
+    /**
+     * @brief Оценить количество различных элементов.
+     */
+    [[nodiscard]] uint64_t estimate() const;
+
+    /**
+     * @brief Объединить с другим скетчем той же точности.
+     * @return false, если точности различаются (скетч не изменяется).
+     */
+    bool merge(const HyperLogLog &other);
+
+    /**
+     * @brief Сбросить все регистры.
+     */
+    void clear();
+
+    /**
+     * @brief Были ли добавлены элементы.
+     */
+    [[nodiscard]] bool empty() const;
+
+    [[nodiscard]] uint8_t getPrecision() const { return precision; }
+};
+
+/**
+ * @brief Масштабируемый фильтр Блума (Almeida et al., 2007).
+ *
+ * Состоит из слоёв — обычных фильтров Блума. Когда последний слой заполнен
+ * до своей ёмкости, добавляется новый слой вдвое большей ёмкости с вдвое
+ * меньшей вероятностью ложного срабатывания, поэтому суммарная вероятность
+ * не превышает errorRate при любом числе элементов. На элемент расходуется
+ * около 1.44 * log2(1 / errorRate) бит независимо от длины идентификатора.
+ *
+ * Ложноотрицательных ответов нет; ложноположительные — с вероятностью не
+ * выше errorRate.
+ *
+ * Формат файла (little-endian): заголовок (магическое значение "TFBLOOM",
+ * версия, количество слоёв, параметры, FNV-1a каталога слоёв), каталог
+ * слоёв и битовые массивы слоёв. При загрузке файл отображается в память
+ * (mmap, MAP_PRIVATE): страницы читаются с диска по мере обращения, а
+ * изменённые копируются только в памяти процесса до следующего save.
+ */
+class ScalableBloomFilter {
+public:
+    /// Магическое значение в начале файла
+    static constexpr array<char, 8> MAGIC = {'T', 'F', 'B', 'L', 'O', 'O', 'M', '\0'};
+    /// Текущая версия формата
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @param initialCapacity Ёмкость первого слоя (количество элементов).
+     * @param errorRate Допустимая вероятность ложного срабатывания (0 < errorRate < 1).
+     */
+    explicit ScalableBloomFilter(uint64_t initialCapacity = 1 << 16, double errorRate = 0.001);
+    ~ScalableBloomFilter();
+
+    ScalableBloomFilter(const ScalableBloomFilter &) = delete;
+    ScalableBloomFilter &operator=(const ScalableBloomFilter &) = delete;
+    ScalableBloomFilter(ScalableBloomFilter &&other) noexcept;
+    ScalableBloomFilter &operator=(ScalableBloomFilter &&other) noexcept;
+
+    /**
+     * @brief Встречался ли элемент с таким хешем.
+     */
+    [[nodiscard]] bool contains(uint64_t hash) const;
+
+    /**
+     * @brief Добавить элемент.
+     * @return true, если элемента ещё не было (он добавлен), false — если уже встречался.
+     */
+    bool insert(uint64_t hash);
+
+    /**
+     * @brief Количество добавленных элементов.
+     */
+    [[nodiscard]] uint64_t size() const;
+
+    /**
+     * @brief Количество слоёв.
+     */
+    [[nodiscard]] size_t layerCount() const { return layers.size(); }
+
+    /**
+     * @brief Объём битовых массивов в байтах.
+     */
+    [[nodiscard]] size_t memoryBytes() const;
+
+    /**
+     * @brief Сохранить фильтр в файл (через временный файл и rename).
+     * @return true при успешном сохранении.
+     */
+    [[nodiscard]] bool save(const string &path) const;
+
+    /**
+     * @brief Загрузить фильтр из файла через mmap.
+     *
+     * При ошибке (нет файла, неверный формат или контрольная сумма) фильтр
+     * не изменяется.
+     *
+     * @return true при успешной загрузке.
+     */
+    [[nodiscard]] bool load(const string &path);
+
+private:
+    /// Слой — обычный фильтр Блума
+    struct Layer {
+        uint64_t bitCount = 0;     ///< Размер битового массива (кратен 64)
+        uint32_t hashCount = 0;    ///< Количество хеш-функций
+        uint64_t capacity = 0;     ///< Ёмкость слоя
+        uint64_t count = 0;        ///< Добавлено элементов
+        uint64_t *words = nullptr; ///< Битовый массив (в storage или в отображении файла)
+        vector<uint64_t> storage;  ///< Собственный битовый массив (пуст для слоёв из файла)
+    };
+
+    uint64_t initialCapacity;
+    double errorRate;
+    vector<Layer> layers;
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+
+    void addLayer();
+    void unmap();
+};
+
+#endif
@@ -1,108 +1,473 @@
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include "Dataset.h"
+#include "SeriesSet.h"
+#include "access_log.h"
+#include "arena.h"
+#include "executor.h"
 #include "forecast.h"
 #include "forecast_utils.h"
+#include "output_file.h"
 #include "crypt.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
 using namespace std;
 
+namespace {
+    /**
+     * @brief Прогнозируемая метрика набора данных.
+     */
+    struct MetricSpec {
+        string_view key;                      ///< Имя для --metrics
+        string_view title;                    ///< Название в выводе коэффициентов
+        string_view column;                   ///< Заголовок столбца выходного CSV
+        int (DatasetValue::*value)() const;   ///< Значение метрики в записи
+    };
+
+    /// Все метрики в порядке столбцов прогноза. Заголовок последнего столбца
+    /// с пробелом сохранён как в прежнем формате файла.
+    constexpr MetricSpec METRICS[] = {
+        {"pageLoads", "Page Loads", "Page Loads", &DatasetValue::getPageLoads},
+        {"uniqueVisitors", "Unique Visitors", "Unique Visitors", &DatasetValue::getUniqueVisitors},
+        {"firstTimeVisitors", "First Time Visitors", "First Time Visitors", &DatasetValue::getFirstTimeVisitors},
+        {"returningVisitors", "Returning Visitors", " Returning Visitors", &DatasetValue::getReturningVisitors},
+    };
+
+    /**
+     * @brief Выбирает метрики по именам из --metrics (пустой список — все).
+     *
+     * Порядок результата — порядок METRICS, независимо от порядка имён.
+     *
+     * @return false, если встретилось неизвестное имя.
+     */
+    bool selectMetrics(const vector<string> &names, vector<const MetricSpec *> &selected) {
+        for (const string &name : names) {
+            if (ranges::none_of(METRICS, [&](const MetricSpec &metric) { return metric.key == name; })) {
+                cerr << "Ошибка: неизвестная метрика " << name << ". Доступны:";
+                for (const auto &metric : METRICS) cerr << ' ' << metric.key;
+                cerr << endl;
+                return false;
+            }
+        }
+        for (const auto &metric : METRICS) {
+            if (names.empty() || ranges::find(names, metric.key) != names.end()) selected.push_back(&metric);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Модель одной метрики: история, подобранные коэффициенты и онлайн-модель.
+     */
+    struct MetricForecast {
+        const MetricSpec *metric = nullptr;
+        pmr::vector<int> history{};
+        SmoothingOdds odds{};
+        optional<HoltWintersModel> model{};
+    };
+
+    /// Размер буфера вывода, после которого отформатированные строки записываются в файл
+    constexpr size_t OUTPUT_FLUSH_SIZE = 256 << 10;
+
+    /**
+     * @brief Записывает прогноз в CSV, начиная со дня, следующего за lastRow.
+     *
+     * Строки форматируются в буфер, который записывается через временный
+     * файл каждые OUTPUT_FLUSH_SIZE байт. С криптором каждая такая порция
+     * сразу шифруется (см. AtomicOutputFile), поэтому открытый текст
+     * прогноза целиком в памяти не собирается.
+     *
+     * @param metrics Прогнозируемые метрики (столбцы файла).
+     * @param forecasts Прогноз длиной H для каждой метрики, в том же порядке.
+     * @param cryptor Криптор для шифрования файла (nullptr — открытый текст).
+     * @param mode Режим шифрования.
+     * @return false, если файл не удалось записать.
+     */
+    bool writeForecast(
+        const string &path,
+        const DatasetValue &lastRow,
+        const int H,
+        const vector<const MetricSpec *> &metrics,
+        const vector<vector<int>> &forecasts,
+        const SeedCryptor *cryptor,
+        const CipherMode mode
+    ) {
+        AtomicOutputFile outFile(path, cryptor, mode);
+        if (!outFile.good()) {
+            return false;
+        }
+        OutputBuffer buffer;
+        buffer.append("Day,Date");
+        for (const MetricSpec *metric : metrics) buffer.append(',').append(metric->column);
+        buffer.append('\n');
+        string day = lastRow.getDay();
+        time_t date = lastRow.getDate();
+        for (int i = 0; i < H; ++i) {
+            day = nextDayString(day);
+            date = nextDayTimeT(date);
+            buffer.append(day).append(',').appendDateMDY(timeTToDays(date));
+            for (const auto &values : forecasts) buffer.append(',').appendInt(values[i]);
+            buffer.append('\n');
+            if (buffer.size() >= OUTPUT_FLUSH_SIZE) {
+                if (!outFile.write(buffer.view())) return false;
+                buffer.clear();
+            }
+        }
+        return outFile.write(buffer.view()) && outFile.commit();
+    }
+
+    /**
+     * @brief Прогноз всех моделей на H точек.
+     */
+    vector<vector<int>> forecastAll(const vector<MetricForecast> &metrics, const int H) {
+        vector<vector<int>> forecasts;
+        forecasts.reserve(metrics.size());
+        for (const auto &metric : metrics) forecasts.push_back(metric.model->forecast(H));
+        return forecasts;
+    }
+
+    /// Рядов, которые одна задача прогнозирует и форматирует в свой буфер
+    constexpr size_t SERIES_PER_TASK = 64;
+
+    /**
+     * @brief Строит прогноз для каждого ряда набора и записывает его в длинном формате.
+     *
+     * Ряды обрабатываются пакетами: каждая задача пакета прогнозирует
+     * SERIES_PER_TASK подряд идущих рядов и форматирует строки в свой буфер,
+     * затем буферы пакета записываются по порядку одним вызовом writev.
+     * Поэтому файл совпадает с последовательной записью, а память ограничена
+     * буферами одного пакета. Ряды короче 2 * m пропускаются. С криптором
+     * буферы пакета шифруются по мере записи.
+     *
+     * @return false, если файл не удалось записать.
+     */
+    bool writeLongForecast(const string &path, const SeriesSet &set, const int H, const int m, size_t &skipped,
+                           const SeedCryptor *cryptor, const CipherMode mode) {
+        AtomicOutputFile outFile(path, cryptor, mode);
+        if (!outFile.good()) {
+            return false;
+        }
+        outFile.write("site_id,date,metric,value\n");
+
+        const size_t tasks = static_cast<size_t>(Executor::global().concurrency()) * 4;
+        vector<OutputBuffer> buffers;
+        buffers.reserve(tasks);
+        for (size_t i = 0; i < tasks; ++i) buffers.emplace_back(64 << 10);
+        vector<size_t> taskSkipped(tasks, 0);
+        vector<string_view> views(tasks);
+
+        for (size_t batch = 0; batch < set.size(); batch += tasks * SERIES_PER_TASK) {
+            parallelFor(0, tasks, [&](const size_t task) {
+                OutputBuffer &buffer = buffers[task];
+                buffer.clear();
+                // Временные объекты прогноза одного ряда живут в арене и освобождаются перед следующим рядом
+                Arena seriesArena("long_format.series");
+                ArenaScope scope(seriesArena);
+                const size_t first = min(set.size(), batch + task * SERIES_PER_TASK);
+                const size_t last = min(set.size(), first + SERIES_PER_TASK);
+                for (size_t i = first; i < last; ++i) {
+                    const SeriesView series = set[i];
+                    if (series.values.size() < static_cast<size_t>(m * 2)) {
+                        ++taskSkipped[task];
+                        continue;
+                    }
+                    seriesArena.reset();
+                    const auto odds = betterCoefficient(series.values, m);
+                    const auto forecast = exponentialSmoothing(series.values, odds.alpha, odds.beta, odds.gamma, m, H);
+                    int64_t day = timeTToDays(series.dates.back());
+                    for (const int value : forecast) {
+                        buffer.append(series.site).append(',').appendDateISO(++day).append(',')
+                              .append(series.metric).append(',').appendInt(value).append('\n');
+                    }
+                }
+                views[task] = buffer.view();
+            }, 1);
+            if (!outFile.write(views)) {
+                return false;
+            }
+        }
+
+        skipped = 0;
+        for (const size_t count : taskSkipped) skipped += count;
+        return outFile.commit();
+    }
+
+    /**
+     * @brief Выводит статистику арен: уничтоженных (из общего отчёта) и ещё живых.
+     */
+    void printArenaStats(const vector<const Arena *> &live = {}) {
+        vector<ArenaReport> rows = arenaReports();
+        for (const Arena *arena : live) rows.push_back(arena->report());
+        cout << "----------" << endl;
+        cout << "Арены временной памяти (имя: арен, выделений, пик занятой памяти, пик блоков):" << endl;
+        for (const auto &row : rows) {
+            cout << "  " << row.name << ": " << row.instances << ", " << row.allocations << ", "
+                 << row.highWater << " Б, " << row.reserved << " Б" << endl;
+        }
+    }
+
+    /**
+     * @brief Ожидание изменений файла через inotify.
+     *
+     * Наблюдает за каталогом файла, а не за самим файлом, поэтому замена файла
+     * (запись во временный файл и rename) тоже обнаруживается.
+     */
+    class FileWatcher {
+    public:
+        explicit FileWatcher(const string &path) {
+#ifdef __linux__
+            const size_t slash = path.find_last_of('/');
+            const string dir = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+            _name = slash == string::npos ? path : path.substr(slash + 1);
+            _fd = inotify_init1(IN_CLOEXEC);
+            if (_fd >= 0 && inotify_add_watch(_fd, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+                close(_fd);
+                _fd = -1;
+            }
+#else
+            (void) path;
+#endif
+        }
+
+        ~FileWatcher() {
+#ifdef __linux__
+            if (_fd >= 0) close(_fd);
+#endif
+        }
+
+        FileWatcher(const FileWatcher &) = delete;
+        FileWatcher &operator=(const FileWatcher &) = delete;
+
+        [[nodiscard]] bool isValid() const { return _fd >= 0; }
+
+        /**
+         * @brief Блокируется до изменения файла.
+         * @return false при ошибке чтения событий.
+         */
+        bool wait() {
+#ifdef __linux__
+            alignas(inotify_event) char buf[4096];
+            while (true) {
+                const ssize_t len = read(_fd, buf, sizeof(buf));
+                if (len <= 0) return false;
+                for (ssize_t off = 0; off < len;) {
+                    const auto *event = reinterpret_cast<const inotify_event *>(buf + off);
+                    if (event->len > 0 && _name == event->name) return true;
+                    off += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+#else
+            return false;
+#endif
+        }
+
+    private:
+        int _fd = -1;
+        string _name;
+    };
+
+    /**
+     * @brief Является ли вход несохраняемым потоком: "-" (stdin) или именованный канал.
+     *
+     * Такой вход нельзя перечитать или отобразить в память, поэтому он
+     * читается через кольцо буферов Dataset::appendFromFD.
+     */
+    bool isStreamInput(const string &path) {
+        if (path == "-") return true;
+        struct stat info {};
+        return stat(path.c_str(), &info) == 0 && S_ISFIFO(info.st_mode);
+    }
+
+    /**
+     * @brief Зашифрован ли входной файл: заголовок CTR/Chunked или явный --encrypted-input (CBC).
+     *
+     * Такой файл при заданном ключе расшифровывается прямо в кольцо буферов
+     * Dataset::appendFromEncrypted, без открытого текста на диске.
+     */
+    bool isEncryptedInput(const Args &args) {
+        if (args.encrypted_input) return true;
+        std::ifstream in(args.csv_path, std::ios::binary);
+        std::byte head[SeedCryptor::HEADER_SIZE];
+        in.read(reinterpret_cast<char *>(head), sizeof(head));
+        return SeedCryptor::hasFormatHeader(span<const std::byte>(head, static_cast<size_t>(in.gcount())));
+    }
+
+    /**
+     * @brief Криптор для расшифровки файла: ключ выбирается по ID из заголовка.
+     * @return nullptr (с сообщением об ошибке), если для ID файла нет ключа.
+     */
+    shared_ptr<const SeedCryptor> cryptorForFile(const KeyManager &keys, const string &path) {
+        std::ifstream in(path, std::ios::binary);
+        std::byte head[SeedCryptor::HEADER_SIZE];
+        in.read(reinterpret_cast<char *>(head), sizeof(head));
+        try {
+            return keys.cryptorFor(span<const std::byte>(head, static_cast<size_t>(in.gcount())));
+        } catch (const std::exception &e) {
+            cerr << "Ошибка: " << e.what() << " для " << path << endl;
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief Криптор для шифрования: ключ --key-id.
+     * @return nullptr (с сообщением об ошибке), если такого ключа нет.
+     */
+    shared_ptr<const SeedCryptor> writeCryptor(const Args &args) {
+        try {
+            return args.keys->cryptor(args.key_id);
+        } catch (const std::exception &e) {
+            cerr << "Ошибка: " << e.what() << " (ключ для шифрования выбирается параметром --key-id)" << endl;
+            return nullptr;
+        }
+    }
+}
+
 int main(const int argc, char** argv) {
     const auto args = parseArgs(argc, argv);
     if (args.has_error) {
         return 1;
     }
+    Executor::configureGlobal(args.threads, args.pin_threads);
+
     if (args.help) {
-        cout << "Использование: " << argv[0] << " <csv_path> [--output <output_path>] [--H <forecast_horizon>] [--season_m <season_length>] [--crypt <key>] [--newCryptKey <key_file>] [--decrypt <output_file>] [--encrypt <output_file>]\n";
+        cout << "Использование: " << argv[0] << " <csv_path> [--output <output_path>] [--H <forecast_horizon>] [--season_m <season_length>] [--crypt <key>] [--newCryptKey <key_file>] [--decrypt <output_file>] [--encrypt <output_file>] [--snapshot <snapshot_file>] [--watch] [--from <date>] [--to <date>] [--access-log] [--visitor-filter <filter_file>] [--long-format] [--shard <csv_path>]... [--duplicates first|last] [--fill-gaps linear|seasonal] [--arena-stats] [--threads <n>] [--pin-threads] [--metrics <list>] [--cipher cbc|ctr|chunked] [--keyring <file>] [--key-id <n>] [--encrypted-input]\n";
         cout << "Параметры:\n";
-        cout << "  <csv_path>            Путь к входному CSV файлу с данными.\n";
+        cout << "  <csv_path>            Путь к входному CSV файлу с данными; \"-\" или именованный канал — чтение потоком.\n";
         cout << "  --output <output_path> Путь к выходному CSV файлу для сохранения прогноза (по умолчанию forecast.csv).\n";
         cout << "  --H <forecast_horizon> Количество точек для прогноза (по умолчанию 30).\n";
         cout << "  --season_m <season_length> Длина сезона для экспоненциального сглаживания (по умолчанию 7).\n";
-        cout << "  --crypt <key>         Путь к файлу ключа для шифрования выходного CSV файла.\n";
+        cout << "  --crypt <key>         Путь к файлу ключа: выходной CSV шифруется (режим --cipher), зашифрованный csv_path\n";
+        cout << "                        расшифровывается при загрузке в памяти.\n";
         cout << "  --newCryptKey <key_file> Генерирует новый ключ шифрования и сохраняет его в указанный файл.\n";
+        cout << "  --keyring <file>      Файл связки ключей: строки \"<id> <ключ из 32 hex-цифр>\". Ключ расшифровки\n";
+        cout << "                        выбирается по ID из заголовка файла.\n";
+        cout << "  --key-id <n>          ID ключа для шифрования (по умолчанию 0 — ключ из --crypt); записывается в заголовок.\n";
+        cout << "  --encrypted-input     csv_path зашифрован в формате CBC (без заголовка); файлы CTR и chunked\n";
+        cout << "                        распознаются по заголовку и без этого параметра.\n";
         cout << "  --decrypt <output_file> Расшифровывает файл по пути csv_path и сохраняет результат в output_file.\n";
         cout << "  --encrypt <output_file> Шифрует файл по пути csv_path и сохраняет результат в output_file.\n";
+        cout << "  --cipher cbc|ctr|chunked Режим для --encrypt и шифрования прогноза (по умолчанию chunked — порции с проверкой целостности\n";
+        cout << "                        и произвольным доступом); --decrypt определяет режим по заголовку файла.\n";
+        cout << "  --snapshot <snapshot_file> Кэширует датасет в бинарном снимке; снимок перестраивается при изменении CSV.\n";
+        cout << "  --watch               После прогноза ждёт дописывания CSV (inotify) и обновляет прогноз по новым строкам.\n";
+        cout << "  --from <date>         Использовать историю начиная с даты (MM/DD/YYYY или YYYY-MM-DD).\n";
+        cout << "  --to <date>           Использовать историю до даты включительно (MM/DD/YYYY или YYYY-MM-DD).\n";
+        cout << "  --access-log          csv_path — журнал доступа nginx/Apache (combined); строится дневной ряд.\n";
+        cout << "  --visitor-filter <filter_file> Фильтр Блума всех встречавшихся посетителей (с --access-log):\n";
+        cout << "                        разделяет новых и вернувшихся; создаётся при отсутствии и обновляется после разбора.\n";
+        cout << "  --long-format         csv_path в длинном формате site_id,date,metric,value; прогноз строится\n";
+        cout << "                        для каждой пары (сайт, метрика) и сохраняется в том же формате.\n";
+        cout << "  --shard <csv_path>    Дополнительный CSV-файл ряда (например, за другой месяц); можно указать несколько раз.\n";
+        cout << "                        Файлы разбираются параллельно и объединяются по дате.\n";
+        cout << "  --duplicates first|last Какую запись оставлять, если дата есть в нескольких файлах (по умолчанию last).\n";
+        cout << "  --fill-gaps linear|seasonal Заполнять пропущенные дни перед прогнозом: линейной интерполяцией\n";
+        cout << "                        или значением того же дня предыдущего сезона.\n";
+        cout << "  --arena-stats         Вывести статистику арен временной памяти (пиковое заполнение) после прогноза.\n";
+        cout << "  --threads <n>         Общее число потоков для разбора и подбора коэффициентов (по умолчанию — по числу ядер).\n";
+        cout << "  --pin-threads         Закрепить рабочие потоки за ядрами процессора.\n";
+        cout << "  --metrics <list>      Прогнозируемые метрики через запятую (по умолчанию все):\n";
+        cout << "                        pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors.\n";
         return 0;
     }
 
+    vector<const MetricSpec *> selectedMetrics;
+    if (!selectMetrics(args.metrics, selectedMetrics)) {
+        return 1;
+    }
+
     // Режим расшифровки файла
     if (args.decrypt) {
-        if (!args.crypt_key.isValid()) {
-            cerr << "Ошибка: для расшифровки необходимо указать ключ с помощью --crypt <key_file>\n";
+        if (!args.keys) {
+            cerr << "Ошибка: для расшифровки необходимо указать ключ с помощью --crypt <key_file> или --keyring <file>\n";
+            return 1;
+        }
+        const auto cryptor = cryptorForFile(*args.keys, args.csv_path);
+        if (!cryptor) {
             return 1;
         }
 
         cout << "Расшифровка файла " << args.csv_path << "..." << endl;
 
-        // Читаем зашифрованный файл
         std::ifstream inFile(args.csv_path, std::ios::binary);
         if (!inFile) {
             cerr << "Ошибка: не удалось открыть файл " << args.csv_path << endl;
             return 1;
         }
 
-        std::string encryptedContent((std::istreambuf_iterator<char>(inFile)),
-                                      std::istreambuf_iterator<char>());
-        inFile.close();
+        // Расшифровываем потоком во временный файл (AtomicOutputFile): при ошибке (неверный ключ,
+        // обрезанный файл) по пути decrypt_output_path не останется частичного результата
+        AtomicOutputFile outFile(args.decrypt_output_path);
+        if (!outFile.good()) {
+            cerr << "Ошибка: не удалось создать файл " << args.decrypt_output_path << endl;
+            return 1;
+        }
 
-        // Расшифровываем
-        SeedCryptor cryptor = args.cryptor;
-        std::string decryptedContent;
         try {
-            decryptedContent = cryptor.decrypt(encryptedContent);
+            AtomicOutputStreamBuf outBuf(outFile);
+            std::ostream out(&outBuf);
+            cryptor->decryptStream(inFile, out);
         } catch (const std::exception& e) {
             cerr << "Ошибка при расшифровке: " << e.what() << endl;
             return 1;
         }
-
-        // Записываем расшифрованный файл
-        std::ofstream outFile(args.decrypt_output_path);
-        if (!outFile) {
-            cerr << "Ошибка: не удалось создать файл " << args.decrypt_output_path << endl;
+        if (!outFile.commit()) {
+            cerr << "Ошибка: не удалось записать файл " << args.decrypt_output_path << endl;
             return 1;
         }
 
-        outFile << decryptedContent;
-        outFile.close();
-
         cout << "Файл успешно расшифрован и сохранён в " << args.decrypt_output_path << endl;
         return 0;
     }
 
     // Режим шифрования файла
     if (args.encrypt_file) {
-        if (!args.crypt_key.isValid()) {
-            cerr << "Ошибка: для шифрования необходимо указать ключ с помощью --crypt <key_file> или --newCryptKey <key_file>\n";
+        if (!args.keys) {
+            cerr << "Ошибка: для шифрования необходимо указать ключ с помощью --crypt <key_file>, --newCryptKey <key_file> или --keyring <file>\n";
+            return 1;
+        }
+        const auto cryptor = writeCryptor(args);
+        if (!cryptor) {
             return 1;
         }
 
         cout << "Шифрование файла " << args.csv_path << "..." << endl;
 
-        // Читаем исходный файл
         std::ifstream inFile(args.csv_path, std::ios::binary);
         if (!inFile) {
             cerr << "Ошибка: не удалось открыть файл " << args.csv_path << endl;
             return 1;
         }
 
-        std::string plainContent((std::istreambuf_iterator<char>(inFile)),
-                                  std::istreambuf_iterator<char>());
-        inFile.close();
-
-        // Шифруем
-        SeedCryptor cryptor = args.cryptor;
-        std::string encryptedContent = cryptor.encrypt(plainContent);
-
-        // Записываем зашифрованный файл
-        std::ofstream outFile(args.encrypt_output_path, std::ios::binary);
-        if (!outFile) {
+        // Как и при расшифровке, файл появляется по пути encrypt_output_path только целиком
+        AtomicOutputFile outFile(args.encrypt_output_path);
+        if (!outFile.good()) {
             cerr << "Ошибка: не удалось создать файл " << args.encrypt_output_path << endl;
             return 1;
         }
 
-        outFile << encryptedContent;
-        outFile.close();
+        // Шифруем потоком порциями по SeedCryptor::STREAM_CHUNK_SIZE
+        try {
+            AtomicOutputStreamBuf outBuf(outFile);
+            std::ostream out(&outBuf);
+            cryptor->encryptStream(inFile, out, args.cipher_mode);
+        } catch (const std::exception& e) {
+            cerr << "Ошибка при шифровании: " << e.what() << endl;
+            return 1;
+        }
+        if (!outFile.commit()) {
+            cerr << "Ошибка: не удалось записать файл " << args.encrypt_output_path << endl;
+            return 1;
+        }
 
         cout << "Файл успешно зашифрован и сохранён в " << args.encrypt_output_path << endl;
         return 0;
@@ -110,131 +475,283 @@ int main(const int argc, char** argv) {
 
     int H = args.H > 0 ? args.H : 30;
     int m = args.season_m > 0 ? args.season_m : 7;
+    // С ключом прогноз записывается зашифрованным
+    shared_ptr<const SeedCryptor> outputCryptor;
+    if (args.keys) {
+        outputCryptor = writeCryptor(args);
+        if (!outputCryptor) {
+            return 1;
+        }
+    }
+    const string savedTo = outputCryptor ? " (зашифрован)" : "";
+
+    if (args.long_format) {
+        cout << "Загрузка рядов в длинном формате..." << endl;
+        SeriesSet series;
+        const auto loaded = series.fromLongCSV(args.csv_path);
+        if (!loaded.opened) {
+            cerr << "Ошибка: не удалось открыть файл " << args.csv_path << endl;
+            return 1;
+        }
+        cout << "Рядов: " << series.size() << ", строк: " << loaded.rows
+             << ", нераспознанных строк: " << loaded.malformed << ", повторов дат: " << loaded.duplicates << endl;
+
+        size_t skipped = 0;
+        if (!writeLongForecast(args.output_path, series, H, m, skipped, outputCryptor.get(), args.cipher_mode)) {
+            cerr << "Ошибка: не удалось записать прогноз в " << args.output_path << endl;
+            return 1;
+        }
+        if (skipped > 0) {
+            cerr << "Пропущено рядов короче " << m * 2 << " точек: " << skipped << endl;
+        }
+        cout << "Прогноз сохранён в " << args.output_path << savedTo << endl;
+        if (args.arena_stats) printArenaStats();
+        return 0;
+    }
+
+    // Для прогноза нужны только название дня, дата и метрики
+    CSVLoadOptions loadOptions;
+    loadOptions.columns = CSVLoadOptions::columnBit(DatasetColumn::Day) |
+                          CSVLoadOptions::columnBit(DatasetColumn::Date) |
+                          CSVLoadOptions::columnBit(DatasetColumn::PageLoads) |
+                          CSVLoadOptions::columnBit(DatasetColumn::UniqueVisitors) |
+                          CSVLoadOptions::columnBit(DatasetColumn::FirstTimeVisitors) |
+                          CSVLoadOptions::columnBit(DatasetColumn::ReturningVisitors);
+    loadOptions.from = args.date_from;
+    loadOptions.to = args.date_to;
 
-    cout << "Загрузка датасета из CSV..." << endl;
     Dataset dataset;
-    dataset.fromCSV(args.csv_path);
+    CSVCursor cursor;
+    if (args.access_log) {
+        if (args.watch) {
+            cerr << "Ошибка: --watch не поддерживается вместе с --access-log\n";
+            return 1;
+        }
+        cout << "Разбор журнала доступа..." << endl;
+        AccessLogIngester ingester;
+        ScalableBloomFilter visitorFilter;
+        if (!args.visitor_filter_path.empty()) {
+            if (visitorFilter.load(args.visitor_filter_path)) {
+                cout << "Загружен фильтр посетителей " << args.visitor_filter_path
+                     << ", посетителей: " << visitorFilter.size() << endl;
+            } else if (std::ifstream(args.visitor_filter_path)) {
+                cerr << "Ошибка: файл " << args.visitor_filter_path << " не является фильтром посетителей\n";
+                return 1;
+            }
+            ingester.setVisitorFilter(&visitorFilter);
+        }
+        if (!ingester.ingestFile(args.csv_path)) {
+            cerr << "Ошибка: не удалось открыть файл " << args.csv_path << endl;
+            return 1;
+        }
+        const auto &stats = ingester.stats();
+        cout << "Строк журнала: " << stats.lines << ", загрузок страниц: " << stats.pageLoads
+             << ", нераспознанных строк: " << stats.malformed << endl;
+        if (!args.visitor_filter_path.empty() && !visitorFilter.save(args.visitor_filter_path)) {
+            cerr << "Ошибка: не удалось сохранить фильтр посетителей в " << args.visitor_filter_path << endl;
+            return 1;
+        }
+        size_t outliers = 0;
+        dataset = ingester.toDataset(&outliers);
+        if (outliers > 0) {
+            cerr << "Предупреждение: отброшено загрузок с выбивающимся временем: " << outliers << endl;
+        }
+        if (args.date_from || args.date_to) {
+            dataset.retainDateRange(args.date_from.value_or(numeric_limits<time_t>::min()),
+                                    args.date_to.value_or(numeric_limits<time_t>::max()));
+        }
+    } else if (!args.shard_paths.empty()) {
+        if (args.watch || !args.snapshot_path.empty()) {
+            cerr << "Ошибка: --watch и --snapshot не поддерживаются вместе с --shard\n";
+            return 1;
+        }
+        cout << "Загрузка и объединение " << args.shard_paths.size() + 1 << " CSV-файлов..." << endl;
+        vector<string> files{args.csv_path};
+        files.insert(files.end(), args.shard_paths.begin(), args.shard_paths.end());
+        CSVMergeOptions mergeOptions;
+        mergeOptions.load = loadOptions;
+        mergeOptions.duplicates = args.keep_first_duplicate ? DuplicatePolicy::KeepFirst : DuplicatePolicy::KeepLast;
+        const auto merged = dataset.fromCSVFiles(files, mergeOptions);
+        for (const auto &failed : merged.failed) {
+            cerr << "Ошибка: не удалось открыть файл " << failed << endl;
+        }
+        if (!merged.failed.empty()) {
+            return 1;
+        }
+        cout << "Повторов дат отброшено: " << merged.duplicates << endl;
+        char fromBuf[FORMATTED_DATE_LENGTH], toBuf[FORMATTED_DATE_LENGTH];
+        for (const auto &gap : merged.gaps) {
+            cerr << "Предупреждение: пропущено дней: " << gap.missing << " ("
+                 << string_view(fromBuf, formatDateMDY(timeTToDays(gap.from), fromBuf)) << " - "
+                 << string_view(toBuf, formatDateMDY(timeTToDays(gap.to), toBuf)) << ")" << endl;
+        }
+    } else if (!args.visitor_filter_path.empty()) {
+        cerr << "Ошибка: --visitor-filter используется только вместе с --access-log\n";
+        return 1;
+    } else if (args.keys && !isStreamInput(args.csv_path) && isEncryptedInput(args)) {
+        // Снимок и --watch сохранили бы на диск данные, полученные из открытого текста
+        if (args.watch || !args.snapshot_path.empty()) {
+            cerr << "Ошибка: --watch и --snapshot не поддерживаются для зашифрованного датасета\n";
+            return 1;
+        }
+        const auto inputCryptor = cryptorForFile(*args.keys, args.csv_path);
+        if (!inputCryptor) {
+            return 1;
+        }
+        cout << "Загрузка зашифрованного датасета из " << args.csv_path << "..." << endl;
+        // С --from/--to из файла с порциями расшифровываются только порции диапазона
+        const auto streamed = dataset.appendDateRangeFromEncrypted(args.csv_path, *inputCryptor, loadOptions);
+        if (streamed.readError) {
+            cerr << "Ошибка при расшифровке " << args.csv_path;
+            if (!streamed.error.empty()) cerr << ": " << streamed.error;
+            cerr << endl;
+            return 1;
+        }
+    } else if (isStreamInput(args.csv_path)) {
+        if (args.watch || !args.snapshot_path.empty()) {
+            cerr << "Ошибка: --watch и --snapshot не поддерживаются при чтении из потока\n";
+            return 1;
+        }
+        const bool fromStdin = args.csv_path == "-";
+        const int fd = fromStdin ? STDIN_FILENO : open(args.csv_path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            cerr << "Ошибка: не удалось открыть файл " << args.csv_path << endl;
+            return 1;
+        }
+        cout << "Потоковая загрузка датасета из " << (fromStdin ? "stdin" : args.csv_path) << "..." << endl;
+        const auto streamed = dataset.appendFromFD(fd, loadOptions);
+        if (!fromStdin) close(fd);
+        if (streamed.readError) {
+            cerr << "Ошибка: чтение из " << args.csv_path << " прервано" << endl;
+            return 1;
+        }
+    } else if (args.snapshot_path.empty()) {
+        cout << "Загрузка датасета из CSV..." << endl;
+        // Без --watch файл читается один раз, и последняя строка без '\n' тоже принимается
+        dataset.appendFromCSV(args.csv_path, cursor, loadOptions, !args.watch);
+    } else {
+        cout << "Загрузка датасета из CSV..." << endl;
+        if (dataset.fromCSVCached(args.csv_path, args.snapshot_path, &cursor)) {
+            cout << "Использован бинарный снимок " << args.snapshot_path << endl;
+        }
+        if (args.date_from || args.date_to) {
+            dataset.retainDateRange(args.date_from.value_or(numeric_limits<time_t>::min()),
+                                    args.date_to.value_or(numeric_limits<time_t>::max()));
+        }
+    }
     cout << "Датасет загружен, строк: " << dataset.size() << endl;
 
+    const ImputeMethod imputeMethod = args.fill_gaps == "linear" ? ImputeMethod::Linear : ImputeMethod::SeasonalNaive;
+    if (!args.fill_gaps.empty()) {
+        const auto filled = dataset.fillGaps(imputeMethod, m);
+        if (filled.unsorted) {
+            cerr << "Ошибка: даты в данных не упорядочены по возрастанию, заполнение пропусков невозможно\n";
+            return 1;
+        }
+        cout << "Заполнено пропущенных дней: " << filled.filled << " (пропусков: " << filled.gaps.size() << ")" << endl;
+    }
+
     if (dataset.size() < static_cast<size_t>(m * 2)) {
         cerr << "Датасет слишком маленький, минимум строк для выбранного season_m = " << m * 2 << endl;
         return 1;
     }
 
-    vector<int> pageLoadsData;
-    vector<int> uniqueVisitorsData;
-    vector<int> firstTimeVisitsData;
-    vector<int> returningVisitsData;
-    for (size_t i = 0; i < dataset.size(); ++i) {
-        auto row = dataset.getRow(i);
-        pageLoadsData.push_back(row.getPageLoads());
-        uniqueVisitorsData.push_back(row.getUniqueVisitors());
-        firstTimeVisitsData.push_back(row.getFirstTimeVisitors());
-        returningVisitsData.push_back(row.getReturningVisitors());
-    }
-
-    auto pageLoadsOdds = betterCoefficient(pageLoadsData, m);
-    auto uniqueVisitorsOdds = betterCoefficient(uniqueVisitorsData, m);
-    auto firstTimeVisitsOdds = betterCoefficient(firstTimeVisitsData, m);
-    auto returningVisitsOdds = betterCoefficient(returningVisitsData, m);
-
-    vector<int> pageLoadsForecast = exponentialSmoothing(
-        pageLoadsData,
-        pageLoadsOdds.alpha,
-        pageLoadsOdds.beta,
-        pageLoadsOdds.gamma,
-        m,
-        H
-    );
-
-
-    vector<int> uniqueVisitorsForecast = exponentialSmoothing(
-        uniqueVisitorsData,
-        uniqueVisitorsOdds.alpha,
-        uniqueVisitorsOdds.beta,
-        uniqueVisitorsOdds.gamma,
-        m,
-        H
-    );
-    vector<int> firstTimeVisitsForecast = exponentialSmoothing(
-        firstTimeVisitsData,
-        firstTimeVisitsOdds.alpha,
-        firstTimeVisitsOdds.beta,
-        firstTimeVisitsOdds.gamma,
-        m,
-        H
-    );
-    vector<int> returningVisitsForecast = exponentialSmoothing(
-        returningVisitsData,
-        returningVisitsOdds.alpha,
-        returningVisitsOdds.beta,
-        returningVisitsOdds.gamma,
-        m,
-        H
-    );
-
-    struct ForecastEntry {
-        string day;
-        time_t date;
-        int pageLoads;
-        int uniqueVisitors;
-        int firstTimeVisitors;
-        int returningVisitors;
-    };
+    // Ряды метрик и временные объекты прогноза выделяются из арены задачи
+    Arena jobArena("main.job");
+    ArenaScope jobScope(jobArena);
+    vector<MetricForecast> metrics;
+    metrics.reserve(selectedMetrics.size());
+    for (const MetricSpec *metric : selectedMetrics) {
+        MetricForecast &entry = metrics.emplace_back(MetricForecast{.metric = metric, .history = pmr::vector<int>(&jobArena)});
+        entry.history.reserve(dataset.size());
+        for (const auto &row : dataset.getRows()) entry.history.push_back((row.*metric->value)());
+    }
 
-    vector<ForecastEntry> forecast;
-    forecast.push_back(ForecastEntry{
-        nextDayString(dataset.getRow(dataset.size() - 1).getDay()),
-        nextDayTimeT(dataset.getRow(dataset.size() - 1).getDate()),
-        pageLoadsForecast[0],
-        uniqueVisitorsForecast[0],
-        firstTimeVisitsForecast[0],
-        returningVisitsForecast[0]
-    });
-
-    for (int i = 1; i < H; ++i) {
-        forecast.push_back(ForecastEntry{
-            nextDayString(forecast[i - 1].day),
-            nextDayTimeT(forecast[i - 1].date),
-            pageLoadsForecast[i],
-            uniqueVisitorsForecast[i],
-            firstTimeVisitsForecast[i],
-            returningVisitsForecast[i]
-        });
-    }
-
-    std::ofstream outFile(args.output_path);
-    outFile << "Day,Date,Page Loads,Unique Visitors,First Time Visitors, Returning Visitors\n";
-    for (const auto&[day, date, pageLoads, uniqueVisitors, firstTimeVisitors, returningVisitors] : forecast) {
-        outFile << day << ','
-                << std::put_time(std::localtime(&date), "%m/%d/%Y") << ','
-                << pageLoads << ','
-                << uniqueVisitors << ','
-                << firstTimeVisitors << ','
-                << returningVisitors << '\n';
-   }
-
-    cout << "Прогноз сохранён в forecast.csv" << endl;
+    // Метрики независимы: коэффициенты подбираются и модели обучаются параллельно,
+    // результаты лежат в metrics по порядку столбцов, поэтому вывод не зависит от расписания
+    parallelFor(0, metrics.size(), [&](const size_t i) {
+        MetricForecast &entry = metrics[i];
+        entry.odds = betterCoefficient(entry.history, m);
+        // Онлайн-модель: в режиме --watch дообучается на дописанных строках без пересчёта всего ряда
+        entry.model.emplace(entry.odds, m);
+        entry.model->fit(entry.history);
+    }, 1);
+
+    if (!writeForecast(args.output_path, dataset.getRows().back(), H, selectedMetrics, forecastAll(metrics, H),
+                       outputCryptor.get(), args.cipher_mode)) {
+        cerr << "Ошибка: не удалось записать прогноз в " << args.output_path << endl;
+        return 1;
+    }
+
+    cout << "Прогноз сохранён в " << args.output_path << savedTo << endl;
 
     cout << "----------" << endl;
     cout << "Сезоны m: " << m << endl;
     cout << "Количество прогнозируемых точек H: " << H << endl;
-    cout << "Page Loads коэффициенты: alpha=" << pageLoadsOdds.alpha
-        << ", beta=" << pageLoadsOdds.beta
-        << ", gamma=" << pageLoadsOdds.gamma
-        << ", WAPETest=" << pageLoadsOdds.WAPETest << endl;
-    cout << "Unique Visitors коэффициенты: alpha=" << uniqueVisitorsOdds.alpha
-        << ", beta=" << uniqueVisitorsOdds.beta
-        << ", gamma=" << uniqueVisitorsOdds.gamma
-        << ", WAPETest=" << uniqueVisitorsOdds.WAPETest << endl;
-    cout << "First Time Visitors коэффициенты: alpha=" << firstTimeVisitsOdds.alpha
-        << ", beta=" << firstTimeVisitsOdds.beta
-        << ", gamma=" << firstTimeVisitsOdds.gamma
-        << ", WAPETest=" << firstTimeVisitsOdds.WAPETest << endl;
-    cout << "Returning Visitors коэффициенты: alpha=" << returningVisitsOdds.alpha
-        << ", beta=" << returningVisitsOdds.beta
-        << ", gamma=" << returningVisitsOdds.gamma
-        << ", WAPETest=" << returningVisitsOdds.WAPETest << endl;
+    for (const auto &entry : metrics) {
+        cout << entry.metric->title << " коэффициенты: alpha=" << entry.odds.alpha
+            << ", beta=" << entry.odds.beta
+            << ", gamma=" << entry.odds.gamma
+            << ", WAPETest=" << entry.odds.WAPETest << endl;
+    }
+
+    if (args.arena_stats) {
+        printArenaStats({&jobArena});
+    }
+
+    if (!args.watch) {
+        return 0;
+    }
+
+    // Режим наблюдения: дочитываем только новые строки и обновляем прогноз
+    FileWatcher watcher(args.csv_path);
+    if (!watcher.isValid()) {
+        cerr << "Ошибка: режим --watch недоступен для " << args.csv_path << endl;
+        return 1;
+    }
+    cout << "Ожидание изменений " << args.csv_path << " (Ctrl+C для выхода)..." << endl;
+
+    while (watcher.wait()) {
+        const size_t before = dataset.size();
+        const auto appended = dataset.appendFromCSV(args.csv_path, cursor, loadOptions);
+        if (!appended.opened || (!appended.reloaded && appended.rowsAppended == 0)) {
+            continue;
+        }
+        if (!args.fill_gaps.empty()) {
+            // Ряд до before уже без пропусков, поэтому новые записи добавляются только после него
+            if (dataset.fillGaps(imputeMethod, m).unsorted) {
+                cerr << "Ошибка: новые строки нарушают порядок дат, заполнение пропусков и прогноз пропущены\n";
+                continue;
+            }
+        }
+        if (dataset.size() < static_cast<size_t>(m * 2)) {
+            cerr << "Датасет слишком маленький, минимум строк для выбранного season_m = " << m * 2 << endl;
+            continue;
+        }
+
+        if (appended.reloaded) {
+            // Файл перезаписан: обучаем модели заново на всём ряде
+            for (auto &entry : metrics) {
+                vector<int> history;
+                history.reserve(dataset.size());
+                for (const auto &row : dataset.getRows()) history.push_back((row.*entry.metric->value)());
+                entry.model->fit(history);
+            }
+        } else {
+            for (size_t i = before; i < dataset.size(); ++i) {
+                const auto &row = dataset.getRows()[i];
+                for (auto &entry : metrics) entry.model->update((row.*entry.metric->value)());
+            }
+        }
+
+        if (!writeForecast(args.output_path, dataset.getRows().back(), H, selectedMetrics, forecastAll(metrics, H),
+                       outputCryptor.get(), args.cipher_mode)) {
+            cerr << "Ошибка: не удалось записать прогноз в " << args.output_path << endl;
+            continue;
+        }
+        cout << "Добавлено строк: " << (appended.reloaded ? dataset.size() : appended.rowsAppended)
+             << ", всего: " << dataset.size() << ". Прогноз обновлён в " << args.output_path << savedTo << endl;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
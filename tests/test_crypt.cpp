@@ -1,16 +1,25 @@
 /**
  * @file test_crypt.cpp
- * @brief Модульные тесты для классов SeedKey и SeedCryptor
+ * @brief Модульные тесты для классов SeedKey, SeedCryptor, KeyManager и генератора Drbg
  *
  * Содержит тесты для проверки корректности генерации ключей,
  * сохранения/загрузки из файлов, шифрования и расшифрования
  */
 
 #include "crypt.h"
+#include "drbg.h"
+#include "key_manager.h"
+#include "executor.h"
 #include <gtest/gtest.h>
 #include <fstream>
 #include <filesystem>
 #include <sstream>
+#include <cstring>
+#include <span>
+#include <atomic>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // ============================================================================
 // Тесты для класса SeedKey
@@ -438,3 +447,678 @@ TEST(SeedCryptorTest, EncryptedDataSizeIsCorrect) {
     EXPECT_EQ(encrypted17.size(), 16 + 32); // IV + 2 блока
 }
 
+
+// ============================================================================
+// Тесты потокового шифрования
+// ============================================================================
+
+/**
+ * @brief Тест: потоковое шифрование совместимо с encrypt()/decrypt()
+ *
+ * Размеры охватывают пустые данные, неполный и целый блок, границу порции
+ * STREAM_CHUNK_SIZE и несколько порций.
+ */
+TEST(SeedCryptorTest, StreamRoundTripMatchesWholeBuffer) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const size_t chunk = SeedCryptor::STREAM_CHUNK_SIZE;
+    for (const size_t size : {size_t(0), size_t(15), size_t(16), chunk - 1, chunk, chunk + 1, chunk * 2 + 100}) {
+        std::string plain(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            plain[i] = static_cast<char>((i * 131 + size) & 0xFF);
+        }
+
+        std::istringstream in(plain);
+        std::ostringstream encrypted;
+        EXPECT_EQ(cryptor.encryptStream(in, encrypted), size);
+        const std::string cipher = encrypted.str();
+        EXPECT_EQ(cipher.size(), SeedCryptor::BLOCK_SIZE + (size / 16 + 1) * 16) << "Размер " << size;
+        EXPECT_EQ(cryptor.decrypt(cipher), plain) << "Размер " << size;
+
+        std::istringstream cipherIn(cryptor.encrypt(plain));
+        std::ostringstream decrypted;
+        EXPECT_EQ(cryptor.decryptStream(cipherIn, decrypted), size);
+        EXPECT_EQ(decrypted.str(), plain) << "Размер " << size;
+    }
+}
+
+/**
+ * @brief Тест: потоковое расшифрование отвергает обрезанные и испорченные данные
+ */
+TEST(SeedCryptorTest, DecryptStreamRejectsInvalidInput) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const std::string cipher = cryptor.encrypt(std::string(100, 'x'));
+
+    const auto decrypt = [&](const std::string& data) {
+        std::istringstream in(data);
+        std::ostringstream out;
+        cryptor.decryptStream(in, out);
+    };
+
+    EXPECT_THROW(decrypt(""), std::runtime_error);
+    EXPECT_THROW(decrypt(cipher.substr(0, 16)), std::runtime_error);
+    EXPECT_THROW(decrypt(cipher.substr(0, cipher.size() - 1)), std::runtime_error);
+    EXPECT_THROW(decrypt(cipher + "x"), std::runtime_error);
+
+    // Чужой ключ: ошибка паддинга или мусор вместо исходных данных
+    SeedCryptor wrong(SeedKey::generateRandom());
+    std::istringstream in(cipher);
+    std::ostringstream out;
+    try {
+        wrong.decryptStream(in, out);
+        EXPECT_NE(out.str(), std::string(100, 'x'));
+    } catch (const std::runtime_error&) {
+        SUCCEED();
+    }
+}
+
+// ============================================================================
+// Тесты API над std::span
+// ============================================================================
+
+/**
+ * @brief Тест: шифрование и расшифрование на месте совместимы с encrypt()/decrypt()
+ */
+TEST(SeedCryptorTest, InPlaceSpanRoundTrip) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    for (const size_t size : {size_t(0), size_t(1), size_t(16), size_t(31), size_t(1000)}) {
+        std::string plain(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            plain[i] = static_cast<char>((i * 7 + 3) & 0xFF);
+        }
+
+        // IV + открытые данные + запас под паддинг в одном буфере
+        std::vector<std::byte> buffer(SeedCryptor::encryptedSize(size));
+        std::memcpy(buffer.data() + SeedCryptor::BLOCK_SIZE, plain.data(), size);
+        EXPECT_EQ(cryptor.encryptInPlace(buffer, size), buffer.size());
+
+        const std::string cipher(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        EXPECT_EQ(cryptor.decrypt(cipher), plain) << "Размер " << size;
+
+        const auto decrypted = cryptor.decryptInPlace(buffer);
+        ASSERT_EQ(decrypted.size(), size);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(decrypted.data()), size), plain);
+        EXPECT_EQ(decrypted.data(), buffer.data() + SeedCryptor::BLOCK_SIZE);
+    }
+}
+
+/**
+ * @brief Тест: шифрование и расшифрование между разными буферами
+ */
+TEST(SeedCryptorTest, SpanIntoCallerBuffer) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const std::string text = "Date,Page Loads\n09/14/2014,2146\n";
+    const auto plain = std::as_bytes(std::span(text));
+
+    std::vector<std::byte> cipher(SeedCryptor::encryptedSize(text.size()));
+    EXPECT_EQ(cryptor.encryptInto(plain, cipher), cipher.size());
+
+    std::vector<std::byte> out(cipher.size() - SeedCryptor::BLOCK_SIZE);
+    const size_t size = cryptor.decryptInto(cipher, out);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(out.data()), size), text);
+
+    // Расшифрование в начало того же буфера
+    const size_t sameSize = cryptor.decryptInto(cipher, cipher);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(cipher.data()), sameSize), text);
+
+    std::vector<std::byte> small(cipher.size() - 1);
+    EXPECT_THROW(cryptor.encryptInto(plain, small), std::invalid_argument);
+    std::vector<std::byte> truncated(SeedCryptor::BLOCK_SIZE + 5);
+    EXPECT_THROW(cryptor.decryptInPlace(truncated), std::runtime_error);
+}
+
+/**
+ * @brief Тест: span-API определяет формат по заголовку, CTR и Chunked не расшифровываются как CBC
+ */
+TEST(SeedCryptorTest, SpanDecryptDispatchesOnHeader) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string text;
+    for (int i = 0; i < 3000; ++i) {
+        text += std::to_string(i) + ",";
+    }
+    const auto toBytes = [](const std::string& data) {
+        return std::vector<std::byte>(reinterpret_cast<const std::byte*>(data.data()),
+                                      reinterpret_cast<const std::byte*>(data.data()) + data.size());
+    };
+    const auto asText = [](const std::span<const std::byte> data) {
+        return std::string(reinterpret_cast<const char*>(data.data()), data.size());
+    };
+
+    const std::pair<std::string, size_t> cases[] = {
+        {cryptor.encryptCTR(text), SeedCryptor::CTR_OVERHEAD},
+        {cryptor.encryptChunked(text, 1024), SeedCryptor::CHUNKED_HEADER_SIZE},
+        {cryptor.encrypt(text), SeedCryptor::BLOCK_SIZE}};
+    for (const auto& [cipher, start] : cases) {
+        auto buffer = toBytes(cipher);
+        const auto decrypted = cryptor.decryptInPlace(buffer);
+        EXPECT_EQ(asText(decrypted), text) << "Смещение " << start;
+        EXPECT_EQ(decrypted.data(), buffer.data() + start);
+
+        // В начало того же буфера и в отдельный буфер
+        buffer = toBytes(cipher);
+        EXPECT_EQ(asText(std::span(buffer).first(cryptor.decryptInto(buffer, buffer))), text);
+        std::vector<std::byte> out(cipher.size());
+        EXPECT_EQ(asText(std::span(out).first(cryptor.decryptInto(toBytes(cipher), out))), text);
+        std::vector<std::byte> small(text.size() - 1);
+        EXPECT_THROW(cryptor.decryptInto(toBytes(cipher), small), std::invalid_argument);
+    }
+
+    // Подмена порции и чужой ID ключа обнаруживаются и в span-API
+    auto damaged = toBytes(cases[1].first);
+    damaged[SeedCryptor::CHUNKED_HEADER_SIZE + 1500] ^= std::byte{1};
+    EXPECT_THROW(cryptor.decryptInPlace(damaged), std::runtime_error);
+    auto keyed = toBytes(SeedCryptor(cryptor.getKey(), 9).encryptCTR(text));
+    EXPECT_THROW(cryptor.decryptInPlace(keyed), std::runtime_error);
+}
+
+// ============================================================================
+// Тесты параллельного расшифрования
+// ============================================================================
+
+/**
+ * @brief Тест: параллельное расшифрование совпадает с последовательным
+ *
+ * Данные занимают несколько участков PARALLEL_RANGE_SIZE с неполным последним;
+ * проверяются расшифрование в отдельный буфер, на месте и потоком.
+ */
+TEST(SeedCryptorTest, ParallelDecryptMatchesSerial) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain(SeedCryptor::PARALLEL_RANGE_SIZE * 5 + 37, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>((i * 2654435761u) >> 13);
+    }
+    const std::string cipher = cryptor.encrypt(plain);
+
+    for (const unsigned threads : {1u, 4u}) {
+        Executor::configureGlobal(threads);
+        EXPECT_EQ(cryptor.decrypt(cipher), plain) << "Потоков: " << threads;
+
+        std::vector<std::byte> buffer(reinterpret_cast<const std::byte*>(cipher.data()),
+                                      reinterpret_cast<const std::byte*>(cipher.data()) + cipher.size());
+        const auto decrypted = cryptor.decryptInPlace(buffer);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(decrypted.data()), decrypted.size()), plain);
+
+        std::istringstream in(cipher);
+        std::ostringstream out;
+        cryptor.decryptStream(in, out);
+        EXPECT_EQ(out.str(), plain) << "Потоков: " << threads;
+    }
+    Executor::configureGlobal(0);
+}
+
+// ============================================================================
+// Тесты режима CTR
+// ============================================================================
+
+/**
+ * @brief Тест: CTR без паддинга, расшифровывается через decrypt() и поток
+ */
+TEST(SeedCryptorTest, CtrRoundTrip) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    for (const size_t size : {size_t(0), size_t(1), size_t(16), size_t(17), SeedCryptor::PARALLEL_RANGE_SIZE * 3 + 5}) {
+        std::string plain(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            plain[i] = static_cast<char>((i * 31 + 7) & 0xFF);
+        }
+
+        const std::string cipher = cryptor.encryptCTR(plain);
+        ASSERT_EQ(cipher.size(), SeedCryptor::CTR_OVERHEAD + size);
+        EXPECT_EQ(SeedCryptor::detectMode(std::as_bytes(std::span(cipher))), CipherMode::CTR);
+        EXPECT_EQ(cryptor.decrypt(cipher), plain) << "Размер " << size;
+
+        std::istringstream in(cipher);
+        std::ostringstream out;
+        EXPECT_EQ(cryptor.decryptStream(in, out), size);
+        EXPECT_EQ(out.str(), plain) << "Размер " << size;
+    }
+}
+
+/**
+ * @brief Тест: параллельный и потоковый CTR дают тот же шифротекст, что и однопоточный
+ */
+TEST(SeedCryptorTest, CtrStreamMatchesParallelBuffer) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain(SeedCryptor::STREAM_CHUNK_SIZE * 2 + 1234, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>((i * 2654435761u) >> 11);
+    }
+
+    Executor::configureGlobal(4);
+    std::istringstream in(plain);
+    std::ostringstream encrypted;
+    EXPECT_EQ(cryptor.encryptStream(in, encrypted, CipherMode::CTR), plain.size());
+    const std::string cipher = encrypted.str();
+    ASSERT_EQ(cipher.size(), SeedCryptor::CTR_OVERHEAD + plain.size());
+
+    // Ключевой поток с тем же счётчиком, вычисленный в одном потоке
+    Executor::configureGlobal(1);
+    std::array<unsigned char, SeedCryptor::BLOCK_SIZE> counter;
+    std::copy(cipher.begin() + SeedCryptor::HEADER_SIZE, cipher.begin() + SeedCryptor::CTR_OVERHEAD, counter.begin());
+    std::string serial(plain.size(), '\0');
+    cryptor.transformCTR(std::as_bytes(std::span(plain)), std::as_writable_bytes(std::span(serial)), counter);
+    EXPECT_EQ(cipher.substr(SeedCryptor::CTR_OVERHEAD), serial);
+    Executor::configureGlobal(0);
+}
+
+/**
+ * @brief Тест: произвольный диапазон CTR расшифровывается без чтения всего файла
+ */
+TEST(SeedCryptorTest, CtrDecryptRange) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain(5000, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>('a' + i % 26);
+    }
+    std::istringstream in(cryptor.encryptCTR(plain));
+
+    for (const auto& [offset, length] : {std::pair<size_t, size_t>{0, 10}, {7, 100}, {4095, 1}, {4990, 100}, {6000, 5},
+                                         {123, SIZE_MAX}}) {
+        const auto range = cryptor.decryptRange(in, offset, length);
+        const std::string expected = offset < plain.size() ? plain.substr(offset, length) : std::string();
+        EXPECT_EQ(std::string(range.begin(), range.end()), expected) << "Смещение " << offset;
+    }
+
+    std::istringstream legacy(cryptor.encrypt(plain));
+    EXPECT_THROW(cryptor.decryptRange(legacy, 0, 10), std::runtime_error);
+}
+
+/**
+ * @brief Тест: файлы CBC без заголовка по-прежнему расшифровываются
+ */
+TEST(SeedCryptorTest, LegacyCbcStillDecrypts) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const std::string plain = "Row,Day,Date,Page.Loads\n1,Sunday,9/14/2014,\"2,146\"\n";
+    const std::string cipher = cryptor.encrypt(plain);
+    EXPECT_EQ(SeedCryptor::detectMode(std::as_bytes(std::span(cipher))), CipherMode::CBC);
+    EXPECT_EQ(cryptor.decrypt(cipher), plain);
+
+    std::istringstream in(cipher);
+    std::ostringstream out;
+    cryptor.decryptStream(in, out);
+    EXPECT_EQ(out.str(), plain);
+}
+
+// ============================================================================
+// Тесты многоблочного ядра
+// ============================================================================
+
+/**
+ * @brief Контрольные значения шифрования одного блока
+ *
+ * Входы взяты из RFC 4269; ожидаемые шифротексты — результат этой
+ * реализации SEED (зафиксированы, чтобы любое ядро давало те же файлы).
+ */
+struct BlockVector {
+    std::array<unsigned char, 16> key;
+    std::array<unsigned char, 16> plain;
+    std::array<unsigned char, 16> cipher;
+};
+
+static const BlockVector BLOCK_VECTORS[] = {
+    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+     {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
+     {0x4B, 0x1E, 0xBB, 0xB8, 0x4F, 0x1A, 0xBF, 0xBC, 0x88, 0xD6, 0x90, 0x62, 0x8C, 0xD2, 0x94, 0x66}},
+    {{0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
+     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+     {0x15, 0x26, 0x55, 0x8E, 0x15, 0x26, 0x55, 0x8E, 0x8D, 0xC0, 0xC0, 0xCD, 0x8D, 0xC0, 0xC0, 0xCD}},
+    {{0x47, 0x06, 0x48, 0x08, 0x51, 0xE6, 0x1B, 0xE8, 0x5D, 0x74, 0xBF, 0xB3, 0xFD, 0x95, 0x61, 0x85},
+     {0x83, 0xA2, 0xF8, 0xA2, 0x88, 0x64, 0x1F, 0xB9, 0xA4, 0xE9, 0xA5, 0xCC, 0x2F, 0x13, 0x1C, 0x7D},
+     {0x1A, 0xB3, 0x0F, 0xAF, 0x91, 0x49, 0xB6, 0x1E, 0xB9, 0x96, 0x91, 0xCD, 0xB2, 0x50, 0x76, 0xD6}},
+    {{0x28, 0xDB, 0xC3, 0xBC, 0x49, 0xFF, 0xD8, 0x7D, 0xCF, 0xA5, 0x09, 0xB1, 0x1D, 0x42, 0x2B, 0xE7},
+     {0xB4, 0x1E, 0x6B, 0xE2, 0xEB, 0xA8, 0x4A, 0x14, 0x8E, 0x2E, 0xED, 0x84, 0x59, 0x3C, 0x5E, 0xC7},
+     {0x64, 0x6B, 0x16, 0x44, 0xB3, 0x79, 0xA5, 0x07, 0x3D, 0x0A, 0xC1, 0x9F, 0x62, 0xBC, 0xE0, 0x69}},
+};
+
+/**
+ * @brief Тест: все ядра дают контрольные значения
+ *
+ * Ключевой поток CTR с начальным счётчиком P — это E(P), E(P+1), ...;
+ * 13 блоков задействуют и проход AVX2 по восемь блоков, и скалярный остаток.
+ */
+TEST(SeedCryptorTest, BlockKernelsMatchVectors) {
+    const BlockKernel initial = SeedCryptor::blockKernel();
+    for (const BlockKernel kernel : {BlockKernel::Scalar, BlockKernel::AVX2}) {
+        SeedCryptor::setBlockKernel(kernel);
+        for (const auto& vector : BLOCK_VECTORS) {
+            SeedCryptor cryptor{SeedKey(vector.key)};
+            std::vector<std::byte> keystream(13 * SeedCryptor::BLOCK_SIZE);
+            cryptor.transformCTR(keystream, keystream, vector.plain);
+            EXPECT_EQ(std::memcmp(keystream.data(), vector.cipher.data(), SeedCryptor::BLOCK_SIZE), 0);
+
+            // Остальные блоки совпадают со скалярным ядром
+            SeedCryptor::setBlockKernel(BlockKernel::Scalar);
+            std::vector<std::byte> expected(keystream.size());
+            cryptor.transformCTR(expected, expected, vector.plain);
+            SeedCryptor::setBlockKernel(kernel);
+            EXPECT_EQ(keystream, expected);
+        }
+    }
+    SeedCryptor::setBlockKernel(initial);
+}
+
+/**
+ * @brief Тест: расшифровка CBC любым ядром совпадает со скалярной
+ */
+TEST(SeedCryptorTest, BlockKernelsDecryptCbc) {
+    const BlockKernel initial = SeedCryptor::blockKernel();
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain(100000, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>((i * 7919) >> 3);
+    }
+    const std::string cipher = cryptor.encrypt(plain);
+    for (const BlockKernel kernel : {BlockKernel::Scalar, BlockKernel::AVX2}) {
+        SeedCryptor::setBlockKernel(kernel);
+        EXPECT_EQ(cryptor.decrypt(cipher), plain);
+    }
+    SeedCryptor::setBlockKernel(initial);
+}
+
+// ============================================================================
+// Тесты формата с порциями
+// ============================================================================
+
+/**
+ * @brief Тест: формат с порциями расшифровывается через decrypt() и поток
+ */
+TEST(SeedCryptorTest, ChunkedRoundTrip) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const size_t chunk = 64;
+    for (const size_t size : {size_t(0), size_t(1), chunk - 1, chunk, chunk * 3 + 7, chunk * 40}) {
+        std::string plain(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            plain[i] = static_cast<char>((i * 13 + 5) & 0xFF);
+        }
+
+        const std::string cipher = cryptor.encryptChunked(plain, chunk);
+        EXPECT_EQ(SeedCryptor::detectMode(std::as_bytes(std::span(cipher))), CipherMode::Chunked);
+        EXPECT_EQ(cryptor.decrypt(cipher), plain) << "Размер " << size;
+
+        std::istringstream layoutIn(cipher);
+        const ChunkedLayout layout = SeedCryptor::readChunkedLayout(layoutIn);
+        EXPECT_EQ(layout.chunkSize, chunk);
+        EXPECT_EQ(layout.plainSize, size);
+        EXPECT_EQ(layout.chunkCount, std::max<size_t>(1, (size + chunk - 1) / chunk));
+
+        std::istringstream in(cipher);
+        std::ostringstream out;
+        EXPECT_EQ(cryptor.decryptStream(in, out), size);
+        EXPECT_EQ(out.str(), plain) << "Размер " << size;
+    }
+}
+
+/**
+ * @brief Тест: диапазоны читаются по порциям, подмена обнаруживается
+ */
+TEST(SeedCryptorTest, ChunkedRangesAndTamperDetection) {
+    Executor::configureGlobal(4);
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const size_t chunk = 256;
+    std::string plain(10000, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>('A' + i % 23);
+    }
+    const std::string cipher = cryptor.encryptChunked(plain, chunk);
+    {
+        std::istringstream in(cipher);
+        EXPECT_NO_THROW(cryptor.verifyChunked(in));
+        for (const auto& [offset, length] : {std::pair<size_t, size_t>{0, 1}, {250, 20}, {1300, 2000}, {9990, 50}}) {
+            const auto range = cryptor.decryptRange(in, offset, length);
+            EXPECT_EQ(std::string(range.begin(), range.end()), plain.substr(offset, length)) << "Смещение " << offset;
+        }
+        // SIZE_MAX — «до конца файла»: длина обрезается, а не переполняет offset + length
+        for (const size_t offset : {size_t{0}, size_t{1}, size_t{4321}, plain.size() - 1, plain.size()}) {
+            const auto range = cryptor.decryptRange(in, offset, SIZE_MAX);
+            EXPECT_EQ(std::string(range.begin(), range.end()), plain.substr(offset)) << "Смещение " << offset;
+        }
+    }
+
+    // Испорченный байт в порции 5: остальные порции по-прежнему читаются
+    std::string damaged = cipher;
+    damaged[SeedCryptor::CHUNKED_HEADER_SIZE + 5 * chunk + 17] ^= 0x01;
+    {
+        std::istringstream in(damaged);
+        EXPECT_THROW(cryptor.verifyChunked(in), std::runtime_error);
+        EXPECT_THROW(cryptor.decryptRange(in, 5 * chunk + 3, 10), std::runtime_error);
+        const auto range = cryptor.decryptRange(in, chunk, 100);
+        EXPECT_EQ(std::string(range.begin(), range.end()), plain.substr(chunk, 100));
+        EXPECT_THROW(cryptor.decrypt(damaged), std::runtime_error);
+    }
+
+    // Переставленные порции
+    std::string swapped = cipher;
+    std::swap_ranges(swapped.begin() + SeedCryptor::CHUNKED_HEADER_SIZE,
+                     swapped.begin() + SeedCryptor::CHUNKED_HEADER_SIZE + chunk,
+                     swapped.begin() + SeedCryptor::CHUNKED_HEADER_SIZE + chunk);
+    EXPECT_THROW(cryptor.decrypt(swapped), std::runtime_error);
+
+    // Обрезанный файл и чужой ключ
+    EXPECT_THROW(cryptor.decrypt(cipher.substr(0, cipher.size() - 1)), std::runtime_error);
+    SeedCryptor wrong(SeedKey::generateRandom());
+    EXPECT_THROW(wrong.decrypt(cipher), std::runtime_error);
+    Executor::configureGlobal(0);
+}
+
+// Тест: зашифрованные данные распознаются только по заголовку формата, не по кодировке текста
+TEST(SeedCryptorTest, FormatHeaderDistinguishesCsv) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const std::string csv = "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n"
+                            "1,Пн,2,9/14/2014,2146,1582,1430,152\n";
+    const auto asBytes = [](const std::string &data) {
+        return std::span<const std::byte>(reinterpret_cast<const std::byte *>(data.data()), data.size());
+    };
+    EXPECT_FALSE(SeedCryptor::hasFormatHeader(asBytes(csv)));
+    // cp1251 и Latin-1 — не UTF-8, но это по-прежнему открытый текст
+    EXPECT_FALSE(SeedCryptor::hasFormatHeader(asBytes("\xcf\xed,\xc2\xf2,Caf\xe9\x01\x02\n")));
+    EXPECT_FALSE(SeedCryptor::hasFormatHeader(asBytes("SEED")));
+    for (const CipherMode mode : {CipherMode::CBC, CipherMode::CTR, CipherMode::Chunked}) {
+        std::istringstream in(csv);
+        std::ostringstream out;
+        cryptor.encryptStream(in, out, mode);
+        EXPECT_EQ(SeedCryptor::hasFormatHeader(asBytes(out.str())), mode != CipherMode::CBC);
+    }
+}
+
+// Тест: шифрование по частям совпадает по формату с потоковым и расшифровывается
+TEST(SeedCryptorTest, StreamEncryptorPiecewise) {
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain;
+    for (int i = 0; i < 30000; ++i) {
+        plain += std::to_string(i * 7919) + ",";
+    }
+    for (const CipherMode mode : {CipherMode::CBC, CipherMode::CTR, CipherMode::Chunked}) {
+        for (const size_t piece : {size_t(1), size_t(13), size_t(4096), plain.size()}) {
+            SeedStreamEncryptor writer(cryptor, mode, 1024);
+            std::string cipher;
+            for (size_t at = 0; at < plain.size(); at += piece) {
+                const auto out = writer.update(std::span(reinterpret_cast<const unsigned char*>(plain.data()) + at,
+                                                         std::min(piece, plain.size() - at)));
+                cipher.append(reinterpret_cast<const char*>(out.data()), out.size());
+            }
+            const auto tail = writer.finish();
+            cipher.append(reinterpret_cast<const char*>(tail.data()), tail.size());
+            EXPECT_THROW(writer.finish(), std::logic_error);
+            EXPECT_EQ(writer.plainSize(), plain.size());
+
+            std::istringstream in(cipher);
+            std::ostringstream out;
+            cryptor.decryptStream(in, out);
+            EXPECT_EQ(out.str(), plain) << "piece " << piece;
+            if (mode == CipherMode::Chunked) {
+                std::istringstream layoutIn(cipher);
+                EXPECT_EQ(SeedCryptor::readChunkedLayout(layoutIn).chunkCount, (plain.size() + 1023) / 1024);
+            }
+        }
+    }
+
+    // Пустые данные
+    SeedStreamEncryptor empty(cryptor);
+    const auto tail = empty.finish();
+    std::istringstream in(std::string(reinterpret_cast<const char*>(tail.data()), tail.size()));
+    std::ostringstream out;
+    EXPECT_EQ(cryptor.decryptStream(in, out), 0u);
+}
+
+// Тест: ID ключа записывается в заголовки CTR и Chunked и проверяется при расшифровке
+TEST(SeedCryptorTest, KeyIdInHeader) {
+    const SeedKey key = SeedKey::generateRandom();
+    const SeedCryptor keyed(key, 513);
+    const SeedCryptor plain(key);
+    const std::string text(70000, 'x');
+    const auto head = [](const std::string& data) {
+        return std::as_bytes(std::span(data.data(), std::min<size_t>(data.size(), 64)));
+    };
+
+    const std::string ctr = keyed.encryptCTR(text);
+    const std::string chunked = keyed.encryptChunked(text, 4096);
+    for (const std::string* cipher : {&ctr, &chunked}) {
+        EXPECT_EQ(SeedCryptor::keyIdOf(head(*cipher)), 513);
+        EXPECT_EQ(static_cast<unsigned>((*cipher)[4]), SeedCryptor::KEYED_FORMAT_VERSION);
+        EXPECT_EQ(keyed.decrypt(*cipher), text);
+        // Тот же ключ с другим ID не принимается
+        EXPECT_THROW(plain.decrypt(*cipher), std::runtime_error);
+    }
+    std::istringstream rangeIn(chunked);
+    EXPECT_EQ(keyed.decryptRange(rangeIn, 5000, 10), std::vector<unsigned char>(10, 'x'));
+
+    // ID входит в CMAC: подмена ID в заголовке обнаруживается
+    std::string swapped = chunked;
+    swapped[6] = 2;
+    swapped[7] = 2;
+    const SeedCryptor other(key, 0x0202);
+    EXPECT_THROW(other.decrypt(swapped), std::runtime_error);
+
+    // Без ID заголовок прежнего формата
+    const std::string legacy = plain.encryptCTR(text);
+    EXPECT_EQ(SeedCryptor::keyIdOf(head(legacy)), 0);
+    EXPECT_EQ(static_cast<unsigned>(legacy[4]), SeedCryptor::FORMAT_VERSION);
+    EXPECT_EQ(keyed.decrypt(legacy), text);
+    EXPECT_EQ(SeedCryptor::keyIdOf(head(plain.encrypt(text))), 0);
+}
+
+// Тест: связка ключей загружается из файла, крипторы по ID создаются один раз и выбираются по заголовку
+TEST(KeyManagerTest, KeyringAndConcurrentLookups) {
+    const std::string path = "tmp_keyring.txt";
+    {
+        std::ofstream out(path);
+        out << "# ключи сайтов\n"
+            << "0 000102030405060708090a0b0c0d0e0f\n"
+            << "\n"
+            << "  7\t00112233445566778899AABBCCDDEEFF  \n"
+            << "65535 ffffffffffffffffffffffffffffffff\n";
+    }
+    KeyManager keys;
+    keys.loadKeyring(path);
+    EXPECT_EQ(keys.size(), 3u);
+    EXPECT_TRUE(keys.contains(7));
+    EXPECT_FALSE(keys.contains(8));
+    EXPECT_EQ(keys.cryptor(7)->getKey().getData()[15], 0xFF);
+    EXPECT_EQ(keys.cryptor(7)->keyId(), 7);
+    EXPECT_THROW(keys.cryptor(8), std::runtime_error);
+    EXPECT_THROW(keys.addKey(7, SeedKey()), std::invalid_argument);
+
+    // Параллельные обращения: каждое расписание разворачивается ровно один раз
+    const KeyManager::KeyId ids[] = {0, 7, 65535};
+    std::vector<std::string> ciphers(3);
+    for (size_t i = 0; i < 3; ++i) {
+        ciphers[i] = keys.cryptor(ids[i])->encryptChunked("site " + std::to_string(ids[i]));
+    }
+    std::vector<std::thread> workers;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&, t] {
+            for (int n = 0; n < 200; ++n) {
+                const size_t i = static_cast<size_t>(t + n) % 3;
+                const auto cryptor = keys.cryptorFor(std::as_bytes(std::span(ciphers[i].data(), SeedCryptor::HEADER_SIZE)));
+                if (cryptor->decrypt(ciphers[i]) != "site " + std::to_string(ids[i])) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(keys.expanded(), 3u);
+
+    // Некорректные строки и повторы ID
+    for (const char* line : {"1 0011", "x 000102030405060708090a0b0c0d0e0f", "70000 000102030405060708090a0b0c0d0e0f",
+                             "1 000102030405060708090a0b0c0d0e0g", "0 000102030405060708090a0b0c0d0e0f"}) {
+        std::ofstream(path) << line << "\n";
+        KeyManager broken;
+        broken.addKey(0, SeedKey());
+        EXPECT_THROW(broken.loadKeyring(path), std::runtime_error) << line;
+    }
+    std::remove(path.c_str());
+    KeyManager missing;
+    EXPECT_THROW(missing.loadKeyring(path), std::runtime_error);
+}
+
+// ============================================================================
+// Тесты для генератора Drbg
+// ============================================================================
+
+// Тест: блочная функция ChaCha20 совпадает с вектором RFC 8439 (раздел 2.3.2)
+TEST(DrbgTest, ChaCha20BlockMatchesRfc8439) {
+    std::array<std::uint32_t, 8> key;
+    for (std::uint32_t i = 0; i < 8; ++i) {
+        key[i] = (i * 4) | (i * 4 + 1) << 8 | (i * 4 + 2) << 16 | (i * 4 + 3) << 24;
+    }
+    const std::array<std::uint32_t, 3> nonce = {0x09000000, 0x4a000000, 0x00000000};
+    std::array<unsigned char, 64> block;
+    Drbg::chacha20Block(key, 1, nonce, block.data());
+    const std::array<unsigned char, 64> expected = {
+        0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+        0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+        0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+        0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e,
+    };
+    EXPECT_EQ(block, expected);
+}
+
+// Тест: выдачи не повторяются ни подряд, ни между потоками, байты распределены равномерно
+TEST(DrbgTest, OutputsDifferAcrossCallsAndThreads) {
+    const auto first = Drbg::bytes<32>();
+    const auto second = Drbg::bytes<32>();
+    EXPECT_NE(first, second);
+
+    std::array<unsigned char, 32> other{};
+    std::thread([&] { other = Drbg::bytes<32>(); }).join();
+    EXPECT_NE(other, first);
+    EXPECT_NE(other, second);
+
+    // Запрос больше пачки пополнения
+    std::vector<unsigned char> bulk(Drbg::REFILL_SIZE * 64 + 7);
+    Drbg::fill(std::as_writable_bytes(std::span(bulk)));
+    std::array<size_t, 256> histogram{};
+    for (const unsigned char byte : bulk) {
+        ++histogram[byte];
+    }
+    const double mean = static_cast<double>(bulk.size()) / 256;
+    for (const size_t count : histogram) {
+        EXPECT_GT(count, mean * 0.6);
+        EXPECT_LT(count, mean * 1.4);
+    }
+}
+
+// Тест: после fork() дочерний процесс не повторяет байты родителя
+TEST(DrbgTest, ForkedChildDoesNotRepeatParent) {
+    Drbg::bytes<1>(); // состояние засеяно до fork
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        const auto bytes = Drbg::bytes<16>();
+        const bool written = write(fds[1], bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+        _exit(written ? 0 : 1);
+    }
+    close(fds[1]);
+    const auto parent = Drbg::bytes<16>();
+    std::array<unsigned char, 16> fromChild{};
+    EXPECT_EQ(read(fds[0], fromChild.data(), fromChild.size()), static_cast<ssize_t>(fromChild.size()));
+    close(fds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_NE(parent, fromChild);
+}
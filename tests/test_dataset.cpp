@@ -1,9 +1,23 @@
 #include "Dataset.h"
 #include "DatasetValue.h"
+#include "SeriesSet.h"
 #include <gtest/gtest.h>
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    /**
+     * Дата day-го дня 2019 года в формате YYYY-MM-DD.
+     */
+    std::string formatISO(const int day) {
+        char buf[FORMATTED_DATE_LENGTH];
+        return std::string(buf, formatDateISO(daysFromCivil(2019, 1, 1) + day, buf));
+    }
+}
 
 // Тест добавления строки и доступа к rows
 TEST(DatasetTest, AddRowAndGetRows) {
@@ -44,11 +58,12 @@ TEST(DatasetTest, FromCSV) {
     // проверим дату
     time_t t = r.getDate();
     ASSERT_NE(t, time_t(0));
+    // дата хранится как полночь по UTC, независимо от локального часового пояса
     std::tm tm{};
 #ifdef _POSIX_VERSION
-    localtime_r(&t, &tm);
+    gmtime_r(&t, &tm);
 #else
-    std::tm *ptm = std::localtime(&t);
+    std::tm *ptm = std::gmtime(&t);
     ASSERT_NE(ptm, nullptr);
     tm = *ptm;
 #endif
@@ -60,6 +75,59 @@ TEST(DatasetTest, FromCSV) {
     std::remove(fname);
 }
 
+// Строка с некорректным числом пропускается, а не превращается в нули
+TEST(DatasetTest, FromCSVSkipsInvalidNumbers) {
+    const char *fname = "tmp_dataset_invalid.csv";
+    std::ofstream ofs(fname);
+    ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+    ofs << "1,Mon,1,12/28/2020,100,200,10,20\n";
+    ofs << "2,Tue,2,12/29/2020,n/a,200,10,20\n";
+    ofs << "3,Wed,3,12/30/2020,\"1,300\",200,,20\n";
+    ofs << "4,Thu,4,12/31/2020,\"1,400\",200,10,20\n";
+    ofs.close();
+
+    Dataset ds;
+    ds.fromCSV(fname);
+
+    const auto &rows = ds.getRows();
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0].getPageLoads(), 100);
+    EXPECT_EQ(rows[1].getDay(), "Thu");
+    EXPECT_EQ(rows[1].getPageLoads(), 1400);
+
+    std::remove(fname);
+}
+
+// Строка с нераспознанной датой пропускается, а не получает дату 1970-01-01
+TEST(DatasetTest, FromCSVSkipsInvalidDates) {
+    const char *fname = "tmp_dataset_invalid_date.csv";
+    std::ofstream ofs(fname);
+    ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+    ofs << "1,Mon,1,12/28/2020,100,200,10,20\n";
+    ofs << "2,Tue,2,bad,200,200,10,20\n";
+    ofs << "3,Wed,3,,300,200,10,20\n";
+    ofs << "4,Thu,4,2020-12-31,400,200,10,20\n";
+    ofs.close();
+
+    Dataset ds;
+    ds.fromCSV(fname);
+    ASSERT_EQ(ds.size(), 2u);
+    EXPECT_EQ(ds.getRow(0).getPageLoads(), 100);
+    EXPECT_EQ(ds.getRow(1).getPageLoads(), 400);
+    EXPECT_EQ(ds.getRow(1).getDate(), daysToTimeT(daysFromCivil(2020, 12, 31)));
+    EXPECT_TRUE(ds.isSortedByDate());
+
+    // Дата не загружается, но задан фильтр: строка с плохой датой тоже отбрасывается
+    CSVLoadOptions options;
+    options.columns = CSVLoadOptions::columnBit(DatasetColumn::PageLoads);
+    options.from = daysToTimeT(daysFromCivil(2020, 1, 1));
+    Dataset filtered;
+    filtered.fromCSV(fname, options);
+    EXPECT_EQ(filtered.size(), 2u);
+
+    std::remove(fname);
+}
+
 // Тест очистки строк
 TEST(DatasetTest, ClearRows) {
     Dataset ds;
@@ -82,6 +150,680 @@ TEST(DatasetTest, OutputOperator) {
     EXPECT_NE(s.find("pageLoads=10"), std::string::npos);
 }
 
+// Тест сохранения и загрузки бинарного снимка
+TEST(DatasetTest, SnapshotRoundTrip) {
+    const char *fname = "tmp_dataset_snapshot.bin";
+    Dataset ds;
+    ds.addRow(DatasetValue("Friday", 6, std::string("10/3/2014"), 3005, 2097, 1856, 241));
+    ds.addRow(DatasetValue("Saturday", 7, std::string("10/4/2014"), 2054, 1436, 1274, 162));
+    ds.addRow(DatasetValue("Sunday", 1, std::string("10/5/2014"), 2060, 1413, 1227, 186));
+    ASSERT_TRUE(ds.saveSnapshot(fname));
+
+    Dataset loaded;
+    ASSERT_TRUE(loaded.loadSnapshot(fname));
+    ASSERT_EQ(loaded.size(), ds.size());
+    for (size_t i = 0; i < ds.size(); ++i) {
+        const auto &a = ds.getRows()[i];
+        const auto &b = loaded.getRows()[i];
+        EXPECT_EQ(a.getDay(), b.getDay());
+        EXPECT_EQ(a.getDayOfWeek(), b.getDayOfWeek());
+        EXPECT_EQ(a.getDate(), b.getDate());
+        EXPECT_EQ(a.getPageLoads(), b.getPageLoads());
+        EXPECT_EQ(a.getUniqueVisitors(), b.getUniqueVisitors());
+        EXPECT_EQ(a.getFirstTimeVisitors(), b.getFirstTimeVisitors());
+        EXPECT_EQ(a.getReturningVisitors(), b.getReturningVisitors());
+    }
+
+    std::remove(fname);
+}
+
+// Тест обнаружения повреждённого снимка по контрольной сумме
+TEST(DatasetTest, SnapshotChecksumMismatch) {
+    const char *fname = "tmp_dataset_snapshot_corrupt.bin";
+    Dataset ds;
+    ds.addRow(DatasetValue("Mon", 1, time_t(0), 1, 2, 3, 4));
+    ASSERT_TRUE(ds.saveSnapshot(fname));
+
+    {
+        std::fstream f(fname, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-1, std::ios::end);
+        f.put('\x7f');
+    }
+
+    Dataset loaded;
+    loaded.addRow(DatasetValue("Tue", 2, time_t(0), 5, 5, 5, 5));
+    EXPECT_FALSE(loaded.loadSnapshot(fname));
+    EXPECT_EQ(loaded.size(), 1u);
+    EXPECT_EQ(loaded.getRow(0).getDay(), "Tue");
+
+    std::remove(fname);
+}
+
+// Тест: число строк из заголовка (не покрыт контрольной суммой) проверяется до выделения памяти
+TEST(DatasetTest, SnapshotRejectsCorruptRowCount) {
+    const char *fname = "tmp_dataset_snapshot_rows.bin";
+    Dataset ds;
+    ds.addRow(DatasetValue("Mon", 1, time_t(0), 1, 2, 3, 4));
+    ds.addRow(DatasetValue("Tue", 2, time_t(86400), 5, 6, 7, 8));
+    ASSERT_TRUE(ds.saveSnapshot(fname));
+
+    for (const uint64_t rowCount : {uint64_t{3}, uint64_t{1} << 40, ~uint64_t{0}}) {
+        {
+            std::fstream f(fname, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(16);
+            f.write(reinterpret_cast<const char *>(&rowCount), sizeof(rowCount));
+        }
+        Dataset loaded;
+        EXPECT_FALSE(loaded.loadSnapshot(fname)) << rowCount;
+        EXPECT_EQ(loaded.size(), 0u);
+    }
+
+    std::remove(fname);
+}
+
+// Тест кэширования CSV снимком и его перестроения при изменении CSV
+TEST(DatasetTest, FromCSVCachedRebuildsOnChange) {
+    const char *csv = "tmp_dataset_cached.csv";
+    const char *snap = "tmp_dataset_cached.snap";
+    std::remove(snap);
+    {
+        std::ofstream ofs(csv);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Mon,1,12/31/2020,\"1,100\",200,10,20\n";
+    }
+
+    Dataset first;
+    EXPECT_FALSE(first.fromCSVCached(csv, snap));
+    ASSERT_EQ(first.size(), 1u);
+
+    Dataset second;
+    EXPECT_TRUE(second.fromCSVCached(csv, snap));
+    ASSERT_EQ(second.size(), 1u);
+    EXPECT_EQ(second.getRow(0).getPageLoads(), 1100);
+
+    // CSV перезаписан (а не дописан) — снимок перестраивается из CSV
+    {
+        std::ofstream ofs(csv);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Mon,1,12/31/2020,\"2,200\",200,10,20\n";
+        ofs << "2,Tue,2,01/01/2021,300,400,30,40\n";
+    }
+
+    Dataset third;
+    EXPECT_FALSE(third.fromCSVCached(csv, snap));
+    ASSERT_EQ(third.size(), 2u);
+    EXPECT_EQ(third.getRow(0).getPageLoads(), 2200);
+
+    std::remove(csv);
+    std::remove(snap);
+}
+
+// Тест инкрементального дочитывания дописанного CSV
+TEST(DatasetTest, AppendFromCSVReadsOnlyNewRows) {
+    const char *fname = "tmp_dataset_append.csv";
+    {
+        std::ofstream ofs(fname);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Mon,1,12/28/2020,100,200,10,20\n";
+        ofs << "2,Tue,2,12/29/2020,\"1,100\",210,11,21\n";
+    }
+
+    Dataset ds;
+    CSVCursor cursor;
+    auto result = ds.appendFromCSV(fname, cursor);
+    EXPECT_EQ(result.rowsAppended, 2u);
+    EXPECT_FALSE(result.reloaded);
+    const uint64_t firstOffset = cursor.offset;
+
+    // Недописанная строка без перевода строки не принимается
+    {
+        std::ofstream ofs(fname, std::ios::app);
+        ofs << "3,Wed,3,12/30/2020,300";
+    }
+    result = ds.appendFromCSV(fname, cursor);
+    EXPECT_EQ(result.rowsAppended, 0u);
+    EXPECT_EQ(cursor.offset, firstOffset);
+
+    {
+        std::ofstream ofs(fname, std::ios::app);
+        ofs << ",310,12,22\n4,Thu,4,12/31/2020,400,410,13,23\n";
+    }
+    result = ds.appendFromCSV(fname, cursor);
+    EXPECT_EQ(result.rowsAppended, 2u);
+    ASSERT_EQ(ds.size(), 4u);
+    EXPECT_EQ(ds.getRow(1).getPageLoads(), 1100);
+    EXPECT_EQ(ds.getRow(2).getPageLoads(), 300);
+    EXPECT_EQ(ds.getRow(3).getReturningVisitors(), 23);
+
+    // Строка дописывается в два приёма: после первой записи в ней уже есть все поля,
+    // но последнее число оборвано ("12" вместо "1234") — она ждёт перевода строки
+    {
+        std::ofstream ofs(fname, std::ios::app);
+        ofs << "5,Fri,5,01/01/2021,500,510,14,12";
+    }
+    const uint64_t beforeTail = cursor.offset;
+    result = ds.appendFromCSV(fname, cursor);
+    EXPECT_EQ(result.rowsAppended, 0u);
+    EXPECT_EQ(cursor.offset, beforeTail);
+    {
+        std::ofstream ofs(fname, std::ios::app);
+        ofs << "34\n";
+    }
+    result = ds.appendFromCSV(fname, cursor);
+    EXPECT_EQ(result.rowsAppended, 1u);
+    ASSERT_EQ(ds.size(), 5u);
+    EXPECT_EQ(ds.getRow(4).getReturningVisitors(), 1234);
+
+    // Разовая загрузка принимает последнюю строку без перевода строки
+    {
+        std::ofstream ofs(fname, std::ios::app);
+        ofs << "6,Sat,6,01/02/2021,600,610,15,25";
+    }
+    Dataset once;
+    once.fromCSV(fname);
+    ASSERT_EQ(once.size(), 6u);
+    EXPECT_EQ(once.getRow(5).getReturningVisitors(), 25);
+
+    // Перезапись файла обнаруживается по контрольной сумме хвоста
+    {
+        std::ofstream ofs(fname);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Fri,5,01/01/2021,7,7,7,7\n";
+        ofs << "2,Sat,6,01/02/2021,8,8,8,8\n";
+        ofs << "3,Sun,7,01/03/2021,9,9,9,9\n";
+        ofs << "4,Mon,1,01/04/2021,1,1,1,1\n";
+        ofs << "5,Tue,2,01/05/2021,2,2,2,2\n";
+    }
+    result = ds.appendFromCSV(fname, cursor);
+    EXPECT_TRUE(result.reloaded);
+    ASSERT_EQ(ds.size(), 5u);
+    EXPECT_EQ(ds.getRow(0).getDay(), "Fri");
+
+    std::remove(fname);
+}
+
+// Тест обновления снимка по дописанному CSV без полного перечитывания
+TEST(DatasetTest, FromCSVCachedAppendsIncrementally) {
+    const char *csv = "tmp_dataset_cached_inc.csv";
+    const char *snap = "tmp_dataset_cached_inc.snap";
+    std::remove(snap);
+    {
+        std::ofstream ofs(csv);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Mon,1,12/31/2020,100,200,10,20\n";
+    }
+    Dataset first;
+    CSVCursor cursor;
+    EXPECT_FALSE(first.fromCSVCached(csv, snap, &cursor));
+    EXPECT_GT(cursor.offset, 0u);
+
+    {
+        std::ofstream ofs(csv, std::ios::app);
+        ofs << "2,Tue,2,01/01/2021,300,400,30,40\n";
+    }
+    Dataset second;
+    EXPECT_TRUE(second.fromCSVCached(csv, snap, &cursor));
+    ASSERT_EQ(second.size(), 2u);
+    EXPECT_EQ(second.getRow(1).getPageLoads(), 300);
+
+    Dataset third;
+    EXPECT_TRUE(third.fromCSVCached(csv, snap));
+    EXPECT_EQ(third.size(), 2u);
+
+    std::remove(csv);
+    std::remove(snap);
+}
+
+// Тест загрузки только нужных столбцов и строк из диапазона дат
+TEST(DatasetTest, FromCSVWithProjectionAndDateRange) {
+    const char *fname = "tmp_dataset_projection.csv";
+    {
+        std::ofstream ofs(fname);
+        ofs << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+        ofs << "1,Mon,1,12/28/2020,\"1,100\",200,10,20\n";
+        ofs << "2,Tue,2,12/29/2020,\"1,200\",210,11,21\n";
+        ofs << "3,Wed,3,12/30/2020,\"1,300\",220,12,22\n";
+        ofs << "4,Thu,4,12/31/2020,\"1,400\",230,13,23\n";
+    }
+
+    CSVLoadOptions options;
+    options.columns = CSVLoadOptions::columnBit(DatasetColumn::Date) | CSVLoadOptions::columnBit(DatasetColumn::PageLoads);
+    options.from = parseDateString("12/29/2020");
+    options.to = parseDateString("2020-12-30");
+
+    Dataset ds;
+    ds.fromCSV(fname, options);
+    ASSERT_EQ(ds.size(), 2u);
+    EXPECT_EQ(ds.getRow(0).getPageLoads(), 1200);
+    EXPECT_EQ(ds.getRow(1).getPageLoads(), 1300);
+    EXPECT_EQ(ds.getRow(0).getDate(), parseDateString("12/29/2020"));
+    // Невыбранные столбцы не разбираются
+    EXPECT_EQ(ds.getRow(0).getDay(), "");
+    EXPECT_EQ(ds.getRow(0).getUniqueVisitors(), 0);
+    EXPECT_EQ(ds.getRow(0).getReturningVisitors(), 0);
+
+    std::remove(fname);
+}
+
+// Тест среза по диапазону дат двоичным поиском
+TEST(DatasetTest, SliceByDate) {
+    Dataset ds;
+    for (int d = 1; d <= 10; ++d) {
+        ds.addRow(DatasetValue("Day", d % 7, daysToTimeT(18000 + d), d, d, d, d));
+    }
+
+    const auto slice = ds.sliceByDate(daysToTimeT(18003), daysToTimeT(18006));
+    ASSERT_EQ(slice.size(), 4u);
+    EXPECT_EQ(slice.front().getPageLoads(), 3);
+    EXPECT_EQ(slice.back().getPageLoads(), 6);
+    EXPECT_EQ(slice.data(), ds.getRows().data() + 2);
+
+    EXPECT_TRUE(ds.sliceByDate(daysToTimeT(19000), daysToTimeT(19001)).empty());
+    EXPECT_TRUE(ds.sliceByDate(daysToTimeT(18006), daysToTimeT(18003)).empty());
+
+    ds.retainDateRange(daysToTimeT(18009), daysToTimeT(20000));
+    ASSERT_EQ(ds.size(), 2u);
+    EXPECT_EQ(ds.getRow(0).getPageLoads(), 9);
+}
+
+// Тест слияния нескольких файлов: повторы на стыках, неупорядоченный файл, пропуски
+TEST(DatasetTest, FromCSVFilesMergesShards) {
+    const char *header = "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+    const std::vector<std::string> files = {"tmp_shard_1.csv", "tmp_shard_2.csv", "tmp_shard_3.csv"};
+    {
+        std::ofstream a(files[0]);
+        a << header << "1,Wed,4,01/01/2020,100,1,1,0\n" << "2,Thu,5,01/02/2020,200,1,1,0\n" << "3,Fri,6,01/03/2020,300,1,1,0\n";
+        std::ofstream b(files[1]);
+        // Перекрывается с первым файлом по 01/03, строки не по порядку
+        b << header << "2,Sat,7,01/04/2020,400,1,1,0\n" << "1,Fri,6,01/03/2020,333,1,1,0\n";
+        std::ofstream c(files[2]);
+        // После 01/04 пропущены 01/05–01/07
+        c << header << "1,Wed,4,01/08/2020,800,1,1,0\n" << "2,Thu,5,01/09/2020,900,1,1,0\n";
+    }
+    std::vector<std::string> withMissing = files;
+    withMissing.push_back("no_such_shard.csv");
+
+    for (const auto policy : {DuplicatePolicy::KeepFirst, DuplicatePolicy::KeepLast}) {
+        CSVMergeOptions options;
+        options.duplicates = policy;
+        options.threads = 2;
+        Dataset ds;
+        const auto result = ds.fromCSVFiles(withMissing, options);
+
+        ASSERT_EQ(ds.size(), 6u);
+        EXPECT_EQ(result.rows, 6u);
+        EXPECT_EQ(result.duplicates, 1u);
+        ASSERT_EQ(result.failed.size(), 1u);
+        EXPECT_EQ(result.failed[0], "no_such_shard.csv");
+        EXPECT_EQ(ds.getRow(2).getPageLoads(), policy == DuplicatePolicy::KeepFirst ? 300 : 333);
+        EXPECT_EQ(ds.getRow(3).getPageLoads(), 400);
+        EXPECT_EQ(ds.getRow(5).getPageLoads(), 900);
+        for (size_t i = 1; i < ds.size(); ++i) {
+            EXPECT_LT(ds.getRow(i - 1).getDate(), ds.getRow(i).getDate());
+        }
+
+        ASSERT_EQ(result.gaps.size(), 1u);
+        EXPECT_EQ(result.gaps[0].from, parseDateString("01/05/2020"));
+        EXPECT_EQ(result.gaps[0].to, parseDateString("01/07/2020"));
+        EXPECT_EQ(result.gaps[0].missing, 3u);
+    }
+
+    for (const auto &f : files) std::remove(f.c_str());
+}
+
+// Тест поиска и заполнения пропусков линейной интерполяцией
+TEST(DatasetTest, FillGapsLinear) {
+    Dataset ds;
+    const int64_t start = daysFromCivil(2020, 1, 5); // воскресенье
+    ds.addRow(DatasetValue("Sunday", 1, daysToTimeT(start), 100, 10, 8, 2));
+    ds.addRow(DatasetValue("Monday", 2, daysToTimeT(start + 1), 200, 20, 16, 4));
+    ds.addRow(DatasetValue("Thursday", 5, daysToTimeT(start + 4), 500, 50, 40, 10));
+
+    const auto gaps = ds.findGaps();
+    ASSERT_EQ(gaps.size(), 1u);
+    EXPECT_EQ(gaps[0].from, daysToTimeT(start + 2));
+    EXPECT_EQ(gaps[0].to, daysToTimeT(start + 3));
+    EXPECT_EQ(gaps[0].missing, 2u);
+
+    const auto result = ds.fillGaps(ImputeMethod::Linear);
+    EXPECT_EQ(result.filled, 2u);
+    ASSERT_EQ(result.gaps.size(), 1u);
+    EXPECT_EQ(result.gaps[0].from, gaps[0].from);
+    ASSERT_EQ(ds.size(), 5u);
+    EXPECT_EQ(ds.getRow(2).getDay(), "Tuesday");
+    EXPECT_EQ(ds.getRow(2).getDayOfWeek(), 3);
+    EXPECT_EQ(ds.getRow(2).getDate(), daysToTimeT(start + 2));
+    EXPECT_EQ(ds.getRow(2).getPageLoads(), 300);
+    EXPECT_EQ(ds.getRow(3).getPageLoads(), 400);
+    EXPECT_EQ(ds.getRow(3).getReturningVisitors(), 8);
+    EXPECT_EQ(ds.getRow(4).getPageLoads(), 500);
+    EXPECT_TRUE(ds.findGaps().empty());
+    EXPECT_TRUE(ds.isSortedByDate());
+
+    // Повторный вызов ничего не меняет
+    EXPECT_EQ(ds.fillGaps().filled, 0u);
+    EXPECT_EQ(ds.size(), 5u);
+}
+
+// Тест заполнения пропусков значением того же дня предыдущего сезона
+TEST(DatasetTest, FillGapsSeasonalNaive) {
+    Dataset ds;
+    for (int d = 0; d < 14; ++d) {
+        if (d == 9 || d == 10) continue;
+        ds.addRow(DatasetValue("", 0, daysToTimeT(18000 + d), 1000 + d, d, 0, 0));
+    }
+    // Пропуск в начале, раньше полного сезона, заполняется линейно
+    Dataset early;
+    early.addRow(DatasetValue("", 0, daysToTimeT(18000), 10, 0, 0, 0));
+    early.addRow(DatasetValue("", 0, daysToTimeT(18002), 30, 0, 0, 0));
+
+    const auto result = ds.fillGaps(ImputeMethod::SeasonalNaive, 7);
+    EXPECT_EQ(result.filled, 2u);
+    ASSERT_EQ(ds.size(), 14u);
+    EXPECT_EQ(ds.getRow(9).getPageLoads(), 1002);
+    EXPECT_EQ(ds.getRow(10).getPageLoads(), 1003);
+    EXPECT_EQ(ds.getRow(9).getDay(), "");
+
+    EXPECT_EQ(early.fillGaps(ImputeMethod::SeasonalNaive, 7).filled, 1u);
+    EXPECT_EQ(early.getRow(1).getPageLoads(), 20);
+}
+
+// Нулевая дата посреди ряда не порождает выдуманных записей от 1970 года
+TEST(DatasetTest, FillGapsRejectsUnsortedDates) {
+    Dataset ds;
+    const int64_t start = daysFromCivil(2020, 1, 5);
+    for (int d = 0; d < 10; ++d) {
+        ds.addRow(DatasetValue("", 0, d == 4 ? time_t(0) : daysToTimeT(start + d), 100 + d, 0, 0, 0));
+    }
+    ds.addRow(DatasetValue("", 0, daysToTimeT(start + 12), 112, 0, 0, 0));
+    EXPECT_FALSE(ds.isSortedByDate());
+    EXPECT_TRUE(ds.findGaps().empty());
+
+    const auto result = ds.fillGaps(ImputeMethod::Linear);
+    EXPECT_TRUE(result.unsorted);
+    EXPECT_EQ(result.filled, 0u);
+    EXPECT_TRUE(result.gaps.empty());
+    EXPECT_EQ(ds.size(), 11u);
+    EXPECT_EQ(ds.getRow(4).getDate(), time_t(0));
+}
+
+// Тест потокового чтения: строки разрываются границами маленьких буферов, результат совпадает с чтением файла
+TEST(DatasetTest, AppendFromStreamMatchesFile) {
+    std::ostringstream csv;
+    csv << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\r\n";
+    for (int i = 0; i < 200; ++i) {
+        csv << i + 1 << ",Mon,2,\"" << formatISO(i) << "\"," << 1000 + i << "," << i << ",1,2\r\n";
+    }
+    csv << "201,Mon,2,2019-05-20,7,7,7,7"; // последняя строка без перевода строки
+    const string content = csv.str();
+
+    const char *fname = "tmp_stream_test.csv";
+    {
+        std::ofstream ofs(fname, std::ios::binary);
+        ofs << content;
+    }
+    Dataset expected;
+    expected.fromCSV(fname);
+    std::remove(fname);
+    ASSERT_EQ(expected.size(), 201u);
+
+    for (const size_t bufferSize : {size_t(1), size_t(7), size_t(64), content.size() + 1}) {
+        size_t offset = 0;
+        Dataset ds;
+        // Источник отдаёт данные порциями по 5 байт, как канал с короткими чтениями
+        const auto result = ds.appendFromStream([&](char *buffer, const size_t capacity) -> ptrdiff_t {
+            const size_t n = min({capacity, content.size() - offset, size_t(5)});
+            std::copy_n(content.data() + offset, n, buffer);
+            offset += n;
+            return static_cast<ptrdiff_t>(n);
+        }, {}, bufferSize);
+
+        EXPECT_FALSE(result.readError);
+        EXPECT_EQ(result.rowsAppended, 201u) << "bufferSize = " << bufferSize;
+        ASSERT_EQ(ds.size(), expected.size());
+        for (size_t i = 0; i < ds.size(); ++i) {
+            EXPECT_EQ(ds.getRow(i).getDate(), expected.getRow(i).getDate());
+            EXPECT_EQ(ds.getRow(i).getPageLoads(), expected.getRow(i).getPageLoads());
+        }
+    }
+}
+
+// Тест чтения из канала и ошибки источника
+TEST(DatasetTest, AppendFromFDReadsPipe) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::thread writer([fd = fds[1]] {
+        const string content = "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n"
+                               "1,Mon,2,01/02/2017,10,1,1,0\n"
+                               "2,Tue,3,01/03/2017,20,2,1,1\n";
+        for (const char c : content) {
+            ASSERT_EQ(write(fd, &c, 1), 1);
+        }
+        close(fd);
+    });
+    Dataset ds;
+    const auto result = ds.appendFromFD(fds[0]);
+    writer.join();
+    close(fds[0]);
+    EXPECT_FALSE(result.readError);
+    ASSERT_EQ(ds.size(), 2u);
+    EXPECT_EQ(ds.getRow(1).getPageLoads(), 20);
+
+    Dataset failed;
+    bool first = true;
+    const auto broken = failed.appendFromStream([&](char *buffer, const size_t capacity) -> ptrdiff_t {
+        if (!first) return -1;
+        first = false;
+        const string_view head = "h\n1,Mon,2,01/02/2017,10,1,1,0\n";
+        const size_t n = min(capacity, head.size());
+        std::copy_n(head.data(), n, buffer);
+        return static_cast<ptrdiff_t>(n);
+    });
+    EXPECT_TRUE(broken.readError);
+    EXPECT_EQ(broken.rowsAppended, 1u);
+}
+
+// Тест загрузки из зашифрованного файла во всех режимах и обнаружения подмены
+TEST(DatasetTest, AppendFromEncryptedMatchesPlain) {
+    std::ostringstream csv;
+    csv << "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+    for (int i = 0; i < 5000; ++i) {
+        csv << i + 1 << ",Mon,2,\"" << formatISO(i % 365) << "\"," << 1000 + i << "," << i << ",1,2\n";
+    }
+    const string content = csv.str();
+    const char *plainName = "tmp_encrypted_plain.csv";
+    {
+        std::ofstream ofs(plainName, std::ios::binary);
+        ofs << content;
+    }
+    Dataset expected;
+    expected.fromCSV(plainName);
+    std::remove(plainName);
+
+    SeedCryptor cryptor(SeedKey::generateRandom());
+    const char *fname = "tmp_encrypted_test.bin";
+    for (const CipherMode mode : {CipherMode::CBC, CipherMode::CTR, CipherMode::Chunked}) {
+        {
+            std::istringstream in(content);
+            std::ofstream out(fname, std::ios::binary);
+            cryptor.encryptStream(in, out, mode);
+        }
+        Dataset ds;
+        const auto result = ds.appendFromEncrypted(fname, cryptor);
+        EXPECT_FALSE(result.readError) << result.error;
+        ASSERT_EQ(ds.size(), expected.size());
+        for (size_t i = 0; i < ds.size(); i += 97) {
+            EXPECT_EQ(ds.getRow(i).getDate(), expected.getRow(i).getDate());
+            EXPECT_EQ(ds.getRow(i).getPageLoads(), expected.getRow(i).getPageLoads());
+        }
+    }
+
+    // Подмена байта в последней порции формата с порциями
+    {
+        std::fstream file(fname, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(SeedCryptor::CHUNKED_HEADER_SIZE + content.size() - 10));
+        file.put('\x5a');
+    }
+    Dataset tampered;
+    const auto broken = tampered.appendFromEncrypted(fname, cryptor);
+    std::remove(fname);
+    EXPECT_TRUE(broken.readError);
+    EXPECT_FALSE(broken.error.empty());
+}
+
+// Тест: диапазон дат из файла с порциями читается по покрывающим его порциям
+TEST(DatasetTest, AppendDateRangeFromEncryptedReadsCoveringChunks) {
+    const string header = "row,day,dayOfWeek,date,pageLoads,uniqueVisitors,firstTimeVisitors,returningVisitors\n";
+    std::ostringstream csv;
+    csv << header;
+    for (int i = 0; i < 3000; ++i) {
+        csv << i + 1 << ",Mon,2," << formatISO(i) << "," << 1000 + i << "," << i << ",1,2\n";
+    }
+    const string content = csv.str();
+    const char *plainName = "tmp_encrypted_range.csv";
+    const char *fname = "tmp_encrypted_range.bin";
+    const SeedCryptor cryptor(SeedKey::generateRandom());
+    const size_t chunk = 512;
+    const auto writeEncrypted = [&](const string &text) {
+        std::ofstream(plainName, std::ios::binary) << text;
+        std::ofstream(fname, std::ios::binary) << cryptor.encryptChunked(text, chunk);
+    };
+    const auto day = [](const int i) { return daysToTimeT(daysFromCivil(2019, 1, 1) + i); };
+    writeEncrypted(content);
+
+    for (const auto &[from, to] : {std::pair{0, 5}, {1000, 1100}, {2990, 5000}, {-10, 2}}) {
+        CSVLoadOptions options;
+        options.from = day(from);
+        options.to = day(to);
+        Dataset expected;
+        expected.fromCSV(plainName, options);
+        Dataset ds;
+        const auto result = ds.appendDateRangeFromEncrypted(fname, cryptor, options);
+        EXPECT_FALSE(result.readError) << result.error;
+        ASSERT_EQ(ds.size(), expected.size()) << from;
+        for (size_t i = 0; i < ds.size(); ++i) {
+            EXPECT_EQ(ds.getRow(i).getDate(), expected.getRow(i).getDate());
+            EXPECT_EQ(ds.getRow(i).getPageLoads(), expected.getRow(i).getPageLoads());
+        }
+    }
+
+    // Порции вне диапазона не расшифровываются: их подмена не мешает чтению диапазона
+    {
+        std::fstream file(fname, std::ios::binary | std::ios::in | std::ios::out);
+        for (const size_t damaged : {size_t{1}, content.size() / chunk - 2}) {
+            file.seekp(static_cast<std::streamoff>(SeedCryptor::CHUNKED_HEADER_SIZE + damaged * chunk + 7));
+            file.put('\x5a');
+        }
+    }
+    CSVLoadOptions middle;
+    middle.from = day(1000);
+    middle.to = day(1010);
+    Dataset ranged;
+    const auto result = ranged.appendDateRangeFromEncrypted(fname, cryptor, middle);
+    EXPECT_FALSE(result.readError) << result.error;
+    EXPECT_EQ(ranged.size(), 11u);
+    Dataset whole;
+    EXPECT_TRUE(whole.appendFromEncrypted(fname, cryptor, middle).readError);
+
+    // Даты не по порядку: файл читается целиком
+    std::ostringstream shuffled;
+    shuffled << header;
+    for (int i = 2999; i >= 0; --i) {
+        shuffled << i + 1 << ",Mon,2," << formatISO(i) << "," << 1000 + i << "," << i << ",1,2\n";
+    }
+    writeEncrypted(shuffled.str());
+    Dataset reversed;
+    EXPECT_FALSE(reversed.appendDateRangeFromEncrypted(fname, cryptor, middle).readError);
+    EXPECT_EQ(reversed.size(), 11u);
+
+    std::remove(plainName);
+    std::remove(fname);
+}
+
+// Тест чтения длинного формата: группировка по (сайт, метрика), сортировка по дате, повторы
+TEST(SeriesSetTest, FromLongCSV) {
+    const char *fname = "tmp_long_format.csv";
+    {
+        std::ofstream ofs(fname);
+        ofs << "site_id,date,metric,value\n";
+        ofs << "b,2020-01-02,visits,20\n";
+        ofs << "a,2020-01-03,loads,\"1,300\"\n";
+        ofs << "a,2020-01-01,loads,100\n";
+        ofs << "b,2020-01-01,visits,10\n";
+        ofs << "a,2020-01-02,loads,200\n";
+        ofs << "broken line\n";
+        ofs << "\"b\",\"2020-01-03\",\"visits\",30\n"; // строковые столбцы в кавычках — тот же ряд b/visits
+        ofs << "a,2020-01-02,loads,250\n";
+        ofs << "a,01/01/2020,visits,7"; // без перевода строки в конце
+    }
+
+    for (const unsigned threads : {1u, 4u}) {
+        SeriesSet set;
+        const auto result = set.fromLongCSV(fname, threads);
+        EXPECT_TRUE(result.opened);
+        EXPECT_EQ(result.rows, 8u);
+        EXPECT_EQ(result.malformed, 1u);
+        EXPECT_EQ(result.duplicates, 1u);
+        ASSERT_EQ(set.size(), 3u);
+
+        const auto loads = set[0];
+        EXPECT_EQ(loads.site, "a");
+        EXPECT_EQ(loads.metric, "loads");
+        ASSERT_EQ(loads.values.size(), 3u);
+        EXPECT_EQ(loads.values[0], 100);
+        EXPECT_EQ(loads.values[1], 250);
+        EXPECT_EQ(loads.values[2], 1300);
+        EXPECT_EQ(loads.dates[0], parseDateString("2020-01-01"));
+        EXPECT_EQ(loads.dates[2], parseDateString("2020-01-03"));
+
+        // Ряды лежат в общем буфере подряд
+        EXPECT_EQ(set[1].values.data(), loads.values.data() + loads.values.size());
+        EXPECT_EQ(set[1].metric, "visits");
+
+        ASSERT_TRUE(set.find("b", "visits").has_value());
+        EXPECT_EQ(*set.find("b", "visits"), 2u);
+        EXPECT_EQ(set[2].site, "b");
+        ASSERT_EQ(set[2].values.size(), 3u);
+        EXPECT_EQ(set[2].values[1], 20);
+        EXPECT_EQ(set[2].values[2], 30);
+        EXPECT_FALSE(set.find("b", "loads").has_value());
+        EXPECT_FALSE(set.find("\"b\"", "\"visits\"").has_value());
+    }
+
+    SeriesSet missing;
+    EXPECT_FALSE(missing.fromLongCSV("no_such_file.csv").opened);
+    std::remove(fname);
+}
+
+// Большой файл разбирается параллельно так же, как в одном потоке
+TEST(SeriesSetTest, ParallelMatchesSequential) {
+    const char *fname = "tmp_long_format_big.csv";
+    {
+        std::ofstream ofs(fname);
+        ofs << "site_id,date,metric,value\n";
+        for (int d = 400; d > 0; --d) {
+            for (int site = 0; site < 50; ++site) {
+                ofs << "site" << site << ',' << formatISO(d) << ",loads," << d * 10 + site << '\n';
+                ofs << "site" << site << ',' << formatISO(d) << ",visits," << d + site << '\n';
+            }
+        }
+    }
+
+    SeriesSet sequential, parallel;
+    sequential.fromLongCSV(fname, 1);
+    parallel.fromLongCSV(fname, 8);
+    ASSERT_EQ(sequential.size(), 100u);
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+        EXPECT_EQ(parallel[i].site, sequential[i].site);
+        EXPECT_EQ(parallel[i].metric, sequential[i].metric);
+        ASSERT_TRUE(std::ranges::equal(parallel[i].values, sequential[i].values));
+        ASSERT_TRUE(std::ranges::equal(parallel[i].dates, sequential[i].dates));
+        ASSERT_TRUE(std::ranges::is_sorted(parallel[i].dates));
+    }
+    std::remove(fname);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
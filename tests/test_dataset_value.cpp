@@ -11,17 +11,33 @@ TEST(DatasetValueTest, ParseNumberStrings) {
     EXPECT_EQ(dv.getReturningVisitors(), 200);
 }
 
+// Строковый конструктор сообщает о первом некорректном поле и обнуляет его
+TEST(DatasetValueTest, StringConstructorReportsStatus) {
+    ParseStatus status = ParseStatus::Empty;
+    DatasetValue ok("Mon", 1, time_t(0), std::string("1,234"), std::string("5"), std::string("6"), std::string("7"), &status);
+    EXPECT_EQ(status, ParseStatus::Ok);
+
+    DatasetValue dv("Mon", 1, std::string("12/31/2020"), std::string("1,234"), std::string("abc"), std::string(""),
+                    std::string("200"), &status);
+    EXPECT_EQ(status, ParseStatus::InvalidCharacter);
+    EXPECT_EQ(dv.getPageLoads(), 1234);
+    EXPECT_EQ(dv.getUniqueVisitors(), 0);
+    EXPECT_EQ(dv.getFirstTimeVisitors(), 0);
+    EXPECT_EQ(dv.getReturningVisitors(), 200);
+}
+
 // Проверка парсинга даты из строки
 TEST(DatasetValueTest, ParseDateString) {
     // 2020-12-31
     DatasetValue dv("Thu", 4, std::string("12/31/2020"), 10, 20, 5, 5);
     time_t t = dv.getDate();
     ASSERT_NE(t, time_t(0));
+    // дата хранится как полночь по UTC, независимо от локального часового пояса
     std::tm tm{};
 #ifdef _POSIX_VERSION
-    localtime_r(&t, &tm);
+    gmtime_r(&t, &tm);
 #else
-    std::tm *ptm = std::localtime(&t);
+    std::tm *ptm = std::gmtime(&t);
     ASSERT_NE(ptm, nullptr);
     tm = *ptm;
 #endif
@@ -48,6 +64,17 @@ TEST(DatasetValueTest, GettersSetters) {
     EXPECT_EQ(dv.getReturningVisitors(), 88);
 }
 
+// Проверка строковых сеттеров: код результата и сохранение значения при ошибке
+TEST(DatasetValueTest, StringSettersReportStatus) {
+    DatasetValue dv("Wed", 3, time_t(0), 1, 2, 3, 4);
+    EXPECT_EQ(dv.setPageLoads(std::string("\"3,005\"")), ParseStatus::Ok);
+    EXPECT_EQ(dv.getPageLoads(), 3005);
+    EXPECT_EQ(dv.setUniqueVisitors(std::string("n/a")), ParseStatus::InvalidCharacter);
+    EXPECT_EQ(dv.getUniqueVisitors(), 2);
+    EXPECT_EQ(dv.setReturningVisitors(std::string("")), ParseStatus::Empty);
+    EXPECT_EQ(dv.getReturningVisitors(), 4);
+}
+
 // Проверка оператора вывода
 TEST(DatasetValueTest, OutputOperator) {
     DatasetValue dv("Sun", 0, std::string("01/02/2003"), 10, 20, 30, 40);
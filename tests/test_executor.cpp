@@ -0,0 +1,87 @@
+/**
+ * @file test_executor.cpp
+ * @brief Модульные тесты для исполнителя задач с кражей работы
+ */
+
+#include "executor.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+// Тест: каждый индекс обрабатывается ровно один раз при любом числе потоков
+TEST(ExecutorTest, ParallelForVisitsEveryIndexOnce) {
+    for (const unsigned threads : {1u, 2u, 4u}) {
+        Executor executor(threads);
+        EXPECT_EQ(executor.concurrency(), threads);
+        std::vector<std::atomic<int>> visits(1000);
+        parallelFor(0, visits.size(), [&](const size_t i) { visits[i].fetch_add(1); }, 7, executor);
+        for (const auto &count : visits) {
+            ASSERT_EQ(count.load(), 1);
+        }
+    }
+}
+
+// Тест: вложенные параллельные участки не блокируют пул из двух потоков
+TEST(ExecutorTest, NestedParallelForCompletes) {
+    Executor executor(2);
+    std::atomic<size_t> total{0};
+    parallelFor(0, 8, [&](size_t) {
+        parallelFor(0, 100, [&](const size_t j) { total.fetch_add(j); }, 10, executor);
+    }, 1, executor);
+    EXPECT_EQ(total.load(), 8u * 4950u);
+}
+
+// Тест: свёртка идёт в порядке участков, выбор минимума с меньшим индексом детерминирован
+TEST(ExecutorTest, ParallelReduceIsOrdered) {
+    std::vector<int> values(500);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<int>((i * 37) % 11);
+
+    using Best = std::pair<int, size_t>;
+    const auto run = [&](Executor &executor) {
+        return parallelReduce(
+            0, values.size(), Best{1000, 0},
+            [&](const size_t first, const size_t last) {
+                Best best{1000, 0};
+                for (size_t i = first; i < last; ++i) {
+                    if (values[i] < best.first) best = {values[i], i};
+                }
+                return best;
+            },
+            [](const Best &a, const Best &b) { return b.first < a.first ? b : a; },
+            16, executor);
+    };
+
+    Executor single(1);
+    Executor pool(4);
+    const Best expected = run(single);
+    EXPECT_EQ(expected.first, 0);
+    EXPECT_EQ(expected.second, 0u);
+    for (int repeat = 0; repeat < 20; ++repeat) {
+        EXPECT_EQ(run(pool), expected);
+    }
+
+    const auto sum = parallelReduce(0, 1001, size_t(0),
+        [](const size_t first, const size_t last) {
+            size_t s = 0;
+            for (size_t i = first; i < last; ++i) s += i;
+            return s;
+        },
+        [](const size_t a, const size_t b) { return a + b; }, 0, pool);
+    EXPECT_EQ(sum, 500500u);
+}
+
+// Тест: исключение из задачи выбрасывается в ожидающем потоке, остальные задачи выполняются
+TEST(ExecutorTest, ExceptionPropagates) {
+    Executor executor(3);
+    std::atomic<int> completed{0};
+    EXPECT_THROW(parallelFor(0, 10, [&](const size_t i) {
+        if (i == 3) throw std::runtime_error("task failed");
+        completed.fetch_add(1);
+    }, 1, executor), std::runtime_error);
+    EXPECT_EQ(completed.load(), 9);
+
+    TaskGroup group(executor);
+    group.run([] {});
+    EXPECT_NO_THROW(group.wait());
+}
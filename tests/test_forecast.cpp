@@ -0,0 +1,66 @@
+/**
+ * @file test_forecast.cpp
+ * @brief Модульные тесты для функций прогнозирования
+ */
+
+#include "forecast.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace {
+    /**
+     * @brief Синтетический ряд с недельной сезонностью и трендом
+     */
+    vector<int> makeSeries(const size_t n) {
+        vector<int> y;
+        for (size_t i = 0; i < n; ++i) {
+            const double season = 1.0 + 0.3 * std::sin(2.0 * M_PI * static_cast<double>(i % 7) / 7.0);
+            y.push_back(static_cast<int>((1000.0 + 3.0 * static_cast<double>(i)) * season) + static_cast<int>(i * 37 % 50));
+        }
+        return y;
+    }
+}
+
+/**
+ * @brief Онлайн-модель даёт тот же прогноз, что и exponentialSmoothing
+ */
+TEST(HoltWintersModelTest, MatchesExponentialSmoothing) {
+    const auto y = makeSeries(120);
+    const SmoothingOdds odds{0.3, 0.1, 0.2, 0.0};
+
+    HoltWintersModel model(odds, 7);
+    ASSERT_TRUE(model.fit(y));
+    EXPECT_EQ(model.observations(), y.size());
+    EXPECT_EQ(model.forecast(30), exponentialSmoothing(y, odds.alpha, odds.beta, odds.gamma, 7, 30));
+}
+
+/**
+ * @brief Дообучение через update эквивалентно обучению на полном ряде
+ */
+TEST(HoltWintersModelTest, UpdateMatchesRefit) {
+    const auto y = makeSeries(100);
+    const SmoothingOdds odds{0.5, 0.2, 0.4, 0.0};
+
+    const vector<int> head(y.begin(), y.begin() + 60);
+    HoltWintersModel model(odds, 7);
+    ASSERT_TRUE(model.fit(head));
+    for (size_t i = head.size(); i < y.size(); ++i) {
+        model.update(y[i]);
+    }
+
+    EXPECT_EQ(model.forecast(14), exponentialSmoothing(y, odds.alpha, odds.beta, odds.gamma, 7, 14));
+}
+
+/**
+ * @brief Обучение на слишком коротком ряде не выполняется
+ */
+TEST(HoltWintersModelTest, FitRequiresTwoSeasons) {
+    HoltWintersModel model(SmoothingOdds{0.3, 0.1, 0.2, 0.0}, 7);
+    EXPECT_FALSE(model.fit(makeSeries(13)));
+    EXPECT_TRUE(model.fit(makeSeries(14)));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
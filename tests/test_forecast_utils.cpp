@@ -0,0 +1,389 @@
+/**
+ * @file test_forecast_utils.cpp
+ * @brief Модульные тесты для вспомогательных функций forecast_utils
+ */
+
+#include "forecast_utils.h"
+#include "arena.h"
+#include "output_file.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Тесты работы с датами
+// ============================================================================
+
+/**
+ * @brief Проверка преобразования календарной даты в дни с начала эпохи и обратно
+ */
+TEST(DateUtilsTest, DaysFromCivilRoundTrip) {
+    EXPECT_EQ(daysFromCivil(1970, 1, 1), 0);
+    EXPECT_EQ(daysFromCivil(2000, 3, 1), 11017);
+    EXPECT_EQ(daysFromCivil(1969, 12, 31), -1);
+
+    for (int64_t d = -800000; d <= 800000; d += 997) {
+        int y = 0, m = 0, dd = 0;
+        civilFromDays(d, y, m, dd);
+        EXPECT_EQ(daysFromCivil(y, m, dd), d);
+    }
+}
+
+/**
+ * @brief Проверка разбора дат формата "M/D/YYYY"
+ */
+TEST(DateUtilsTest, ParseDateMDY) {
+    int64_t days = 0;
+    ASSERT_TRUE(parseDateMDY("12/31/2020", days));
+    EXPECT_EQ(days, daysFromCivil(2020, 12, 31));
+
+    ASSERT_TRUE(parseDateMDY("10/3/2014", days));
+    EXPECT_EQ(days, daysFromCivil(2014, 10, 3));
+
+    ASSERT_TRUE(parseDateMDY("\"2/29/2016\"\r", days));
+    EXPECT_EQ(days, daysFromCivil(2016, 2, 29));
+
+    EXPECT_FALSE(parseDateMDY("", days));
+    EXPECT_FALSE(parseDateMDY("13/01/2020", days));
+    EXPECT_FALSE(parseDateMDY("12/31/20", days));
+    EXPECT_FALSE(parseDateMDY("12/31/2020x", days));
+}
+
+/**
+ * @brief Проверка разбора дат формата ISO-8601
+ */
+TEST(DateUtilsTest, ParseDateISO) {
+    int64_t days = 0;
+    ASSERT_TRUE(parseDateISO("2020-12-31", days));
+    EXPECT_EQ(days, daysFromCivil(2020, 12, 31));
+
+    ASSERT_TRUE(parseDateISO("2014-10-03T12:30:00Z", days));
+    EXPECT_EQ(days, daysFromCivil(2014, 10, 3));
+
+    EXPECT_FALSE(parseDateISO("2020-1-31", days));
+    EXPECT_FALSE(parseDateISO("2020/12/31", days));
+}
+
+/**
+ * @brief Проверка форматирования дат
+ */
+TEST(DateUtilsTest, FormatDate) {
+    char buf[FORMATTED_DATE_LENGTH];
+    const int64_t days = daysFromCivil(2014, 10, 3);
+
+    EXPECT_EQ(std::string(buf, formatDateMDY(days, buf)), "10/03/2014");
+    EXPECT_EQ(std::string(buf, formatDateISO(days, buf)), "2014-10-03");
+}
+
+/**
+ * @brief parseDateString возвращает полночь UTC и 0 при ошибке
+ */
+TEST(DateUtilsTest, ParseDateString) {
+    EXPECT_EQ(parseDateString("01/02/1970"), time_t(SECONDS_PER_DAY));
+    EXPECT_EQ(parseDateString("1970-01-02"), time_t(SECONDS_PER_DAY));
+    EXPECT_EQ(parseDateString("not a date"), time_t(0));
+}
+
+/**
+ * @brief nextDayTimeT всегда возвращает полночь следующего дня
+ */
+TEST(DateUtilsTest, NextDayTimeT) {
+    const time_t t = parseDateString("03/08/2020");
+    EXPECT_EQ(nextDayTimeT(t), parseDateString("03/09/2020"));
+    EXPECT_EQ(nextDayTimeT(t + 3600), parseDateString("03/09/2020"));
+    EXPECT_EQ(nextDayTimeT(parseDateString("12/31/2020")), parseDateString("01/01/2021"));
+}
+
+// ============================================================================
+// Тесты разбора чисел
+// ============================================================================
+
+/**
+ * @brief Разбор чисел с разделителями тысяч и кавычками
+ */
+TEST(NumberUtilsTest, ParseNumberWithSeparators) {
+    int64_t v = 0;
+    EXPECT_EQ(parseNumber("\"1,234\"", v), ParseStatus::Ok);
+    EXPECT_EQ(v, 1234);
+    EXPECT_EQ(parseNumber("  -12,345,678\r", v), ParseStatus::Ok);
+    EXPECT_EQ(v, -12345678);
+    EXPECT_EQ(parseNumber("9,223,372,036,854,775,807", v), ParseStatus::Ok);
+    EXPECT_EQ(v, INT64_MAX);
+    EXPECT_EQ(parseNumber("-9223372036854775808", v), ParseStatus::Ok);
+    EXPECT_EQ(v, INT64_MIN);
+}
+
+/**
+ * @brief Ошибки разбора возвращаются кодом, значение не изменяется
+ */
+TEST(NumberUtilsTest, ParseNumberErrors) {
+    int64_t v = 42;
+    EXPECT_EQ(parseNumber("", v), ParseStatus::Empty);
+    EXPECT_EQ(parseNumber("\",\"", v), ParseStatus::Empty);
+    EXPECT_EQ(parseNumber("12a", v), ParseStatus::InvalidCharacter);
+    EXPECT_EQ(parseNumber("9223372036854775808", v), ParseStatus::OutOfRange);
+    EXPECT_EQ(v, 42);
+
+    int narrow = 7;
+    EXPECT_EQ(parseNumber("3,000,000,000", narrow), ParseStatus::OutOfRange);
+    EXPECT_EQ(narrow, 7);
+    EXPECT_EQ(parseNumberString("abc"), 0);
+    EXPECT_EQ(parseNumberString("2,097"), 2097);
+}
+
+// ============================================================================
+// Тесты арены временной памяти
+// ============================================================================
+
+/**
+ * @brief Учёт источника, из которого арена берёт блоки
+ */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t outstanding = 0;
+
+protected:
+    void *do_allocate(const size_t bytes, const size_t alignment) override {
+        ++allocations;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, const size_t bytes, const size_t alignment) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource &other) const noexcept override { return this == &other; }
+};
+
+/**
+ * @brief Выравнивание, пиковое заполнение и возврат блоков
+ */
+TEST(ArenaTest, AllocatesAlignedAndTracksHighWater) {
+    CountingResource upstream;
+    {
+        Arena arena({}, 256, &upstream);
+        void *a = arena.allocate(3, 1);
+        void *b = arena.allocate(16, 16);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0u);
+        EXPECT_NE(a, b);
+        void *big = arena.allocate(1000, 8); // больше блока — отдельный блок
+        EXPECT_NE(big, nullptr);
+        EXPECT_EQ(upstream.allocations, 2u);
+        EXPECT_GE(arena.highWater(), 1019u);
+        EXPECT_EQ(arena.allocations(), 3u);
+
+        const size_t peak = arena.highWater();
+        arena.reset();
+        EXPECT_EQ(arena.used(), 0u);
+        EXPECT_EQ(arena.highWater(), peak);
+
+        // После reset блоки объединены: та же работа не обращается к upstream
+        const size_t before = upstream.allocations;
+        void *a2 = arena.allocate(3, 1);
+        void *b2 = arena.allocate(16, 16);
+        void *big2 = arena.allocate(1000, 8);
+        ASSERT_NE(a2, nullptr);
+        ASSERT_NE(b2, nullptr);
+        ASSERT_NE(big2, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(b2) % 16, 0u);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(big2) % 8, 0u);
+        EXPECT_NE(a2, b2);
+        EXPECT_NE(b2, big2);
+        EXPECT_NE(a2, big2);
+        EXPECT_EQ(upstream.allocations, before);
+
+        arena.release();
+        EXPECT_EQ(upstream.outstanding, 0u);
+        EXPECT_EQ(arena.reserved(), 0u);
+    }
+    EXPECT_EQ(upstream.outstanding, 0u);
+}
+
+/**
+ * @brief ArenaScope задаёт текущую арену потока и восстанавливает предыдущую
+ */
+TEST(ArenaTest, ScopeAndReports) {
+    clearArenaReports();
+    EXPECT_EQ(currentArena(), nullptr);
+    EXPECT_EQ(scratchResource(), std::pmr::get_default_resource());
+    {
+        Arena outer("test.outer");
+        ArenaScope outerScope(outer);
+        {
+            Arena inner("test.inner");
+            ArenaScope innerScope(inner);
+            EXPECT_EQ(currentArena(), &inner);
+            std::pmr::vector<int> values(scratchResource());
+            values.assign(100, 1);
+        }
+        EXPECT_EQ(currentArena(), &outer);
+    }
+    EXPECT_EQ(currentArena(), nullptr);
+
+    const auto reports = arenaReports();
+    ASSERT_EQ(reports.size(), 2u);
+    EXPECT_EQ(reports[0].name, "test.inner");
+    EXPECT_EQ(reports[0].instances, 1u);
+    EXPECT_EQ(reports[0].allocations, 1u);
+    EXPECT_GE(reports[0].highWater, 100 * sizeof(int));
+    EXPECT_EQ(reports[1].name, "test.outer");
+    EXPECT_EQ(reports[1].allocations, 0u);
+}
+
+// ============================================================================
+// Тесты вывода
+// ============================================================================
+
+/**
+ * @brief Форматирование чисел и дат в буфер
+ */
+TEST(OutputTest, BufferFormatsNumbersAndDates) {
+    OutputBuffer buffer(16);
+    buffer.append("Day").append(',').appendInt(-42).append(',').appendInt(INT64_MAX).append(',')
+          .appendDateMDY(daysFromCivil(2020, 8, 20)).append(',').appendDateISO(daysFromCivil(2019, 1, 5));
+    EXPECT_EQ(buffer.view(), "Day,-42,9223372036854775807,08/20/2020,2019-01-05");
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+}
+
+/**
+ * @brief Файл появляется только после commit, без commit прежнее содержимое сохраняется
+ */
+TEST(OutputTest, AtomicFileReplacesOnlyOnCommit) {
+    const std::string path = "tmp_output_test.csv";
+    const auto read = [&] {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        return content.str();
+    };
+    {
+        std::ofstream(path) << "old\n";
+    }
+    {
+        AtomicOutputFile file(path);
+        ASSERT_TRUE(file.good());
+        EXPECT_TRUE(file.write("partial\n"));
+        // Без commit временный файл удаляется
+    }
+    EXPECT_EQ(read(), "old\n");
+    const auto leftovers = [&] {
+        size_t count = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(".")) {
+            if (entry.path().filename().string().starts_with(path + ".")) ++count;
+        }
+        return count;
+    };
+    EXPECT_EQ(leftovers(), 0u);
+
+    std::vector<std::string> parts;
+    std::string expected;
+    for (int i = 0; i < 3000; ++i) {
+        parts.push_back(std::to_string(i) + (i % 7 == 0 ? "" : ",") + "\n");
+        expected += parts.back();
+    }
+    std::vector<std::string_view> views(parts.begin(), parts.end());
+    views.emplace_back(); // пустые буферы пропускаются
+    {
+        AtomicOutputFile file(path);
+        EXPECT_TRUE(file.write(views));
+        EXPECT_TRUE(file.commit());
+    }
+    EXPECT_EQ(read(), expected);
+    EXPECT_EQ(leftovers(), 0u);
+    // Временный файл создаётся с правами 0600, итоговый должен читаться всеми
+    EXPECT_EQ(std::filesystem::status(path).permissions() & std::filesystem::perms::others_read,
+              std::filesystem::perms::others_read);
+
+    AtomicOutputFile missing("no_such_dir/forecast.csv");
+    EXPECT_FALSE(missing.good());
+    EXPECT_FALSE(missing.commit());
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Поток поверх AtomicOutputFile: шифротекст encryptStream появляется только после commit
+ */
+TEST(OutputTest, AtomicStreamBufWritesThroughOstream) {
+    const std::string path = "tmp_output_stream.bin";
+    const SeedCryptor cryptor(SeedKey::generateRandom());
+    std::string plain;
+    for (int i = 0; i < 20000; ++i) plain += std::to_string(i) + "\n";
+    {
+        AtomicOutputFile file(path);
+        ASSERT_TRUE(file.good());
+        {
+            AtomicOutputStreamBuf buf(file, 64);
+            std::ostream out(&buf);
+            std::istringstream in(plain);
+            cryptor.encryptStream(in, out, CipherMode::CTR);
+            out << 'x';
+            out.flush();
+            EXPECT_TRUE(out.good());
+        }
+        EXPECT_FALSE(std::ifstream(path).good());
+        EXPECT_TRUE(file.commit());
+    }
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string cipher = content.str();
+    ASSERT_FALSE(cipher.empty());
+    EXPECT_EQ(cipher.back(), 'x');
+    cipher.pop_back();
+    EXPECT_EQ(cryptor.decrypt(cipher), plain);
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Зашифрованные файлы пишутся из нескольких потоков с общим криптором и расшифровываются
+ */
+TEST(OutputTest, EncryptedFilesWrittenConcurrently) {
+    const SeedCryptor cryptor(SeedKey::generateRandom());
+    const CipherMode modes[] = {CipherMode::Chunked, CipherMode::CTR, CipherMode::CBC, CipherMode::Chunked};
+    std::vector<std::string> expected(std::size(modes));
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < std::size(modes); ++w) {
+        writers.emplace_back([&, w] {
+            const std::string path = "tmp_encrypted_output_" + std::to_string(w) + ".csv";
+            AtomicOutputFile file(path, &cryptor, modes[w]);
+            ASSERT_TRUE(file.good());
+            OutputBuffer buffer(64);
+            // Порции разного размера, суммарно больше одной порции формата Chunked
+            for (int i = 0; i < 40000; ++i) {
+                buffer.appendInt(static_cast<int64_t>(w)).append(',').appendInt(i).append('\n');
+                if (i % 997 == 0) {
+                    expected[w] += buffer.view();
+                    ASSERT_TRUE(file.write(buffer.view()));
+                    buffer.clear();
+                }
+            }
+            expected[w] += buffer.view();
+            ASSERT_TRUE(file.write(buffer.view()));
+            ASSERT_TRUE(file.commit());
+        });
+    }
+    for (auto &writer : writers) writer.join();
+
+    SeedCryptor reader(cryptor.getKey());
+    for (size_t w = 0; w < std::size(modes); ++w) {
+        const std::string path = "tmp_encrypted_output_" + std::to_string(w) + ".csv";
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream plain;
+        reader.decryptStream(in, plain);
+        EXPECT_EQ(plain.str(), expected[w]) << "writer " << w;
+        std::remove(path.c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
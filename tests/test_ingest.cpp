@@ -0,0 +1,244 @@
+/**
+ * @file test_ingest.cpp
+ * @brief Модульные тесты для разбора журналов доступа и HyperLogLog
+ */
+
+#include "access_log.h"
+#include "sketch.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+    /**
+     * @brief Строка журнала в формате combined
+     */
+    std::string logLine(const std::string &host, const std::string &time, const std::string &request,
+                        const int status, const std::string &agent = "Mozilla/5.0") {
+        return host + " - - [" + time + "] \"" + request + "\" " + std::to_string(status) +
+               " 512 \"-\" \"" + agent + "\"";
+    }
+}
+
+// Оценка HyperLogLog в пределах нескольких стандартных ошибок
+TEST(HyperLogLogTest, EstimatesCardinality) {
+    for (const int n : {10, 1000, 100000}) {
+        HyperLogLog hll;
+        for (int i = 0; i < n; ++i) {
+            hll.add("visitor-" + std::to_string(i));
+            hll.add("visitor-" + std::to_string(i)); // повтор не меняет оценку
+        }
+        EXPECT_NEAR(static_cast<double>(hll.estimate()), n, n * 0.05 + 1) << "n = " << n;
+    }
+}
+
+// Объединение скетчей эквивалентно подсчёту по объединению множеств
+TEST(HyperLogLogTest, MergeMatchesUnion) {
+    HyperLogLog a, b, both;
+    for (int i = 0; i < 3000; ++i) {
+        const std::string item = std::to_string(i);
+        (i < 2000 ? a : b).add(item);
+        both.add(item);
+    }
+    ASSERT_TRUE(a.merge(b));
+    EXPECT_EQ(a.estimate(), both.estimate());
+
+    HyperLogLog other(10);
+    EXPECT_FALSE(a.merge(other));
+}
+
+// Разбор строки в формате combined
+TEST(AccessLogTest, ParsesCombinedLine) {
+    const std::string line = logLine("10.0.0.1", "10/Oct/2000:13:55:36 -0700", "GET /index.html?x=1 HTTP/1.1", 200, "curl/8.0");
+    AccessLogRecord record;
+    ASSERT_TRUE(parseAccessLogLine(line, false, record));
+    EXPECT_EQ(record.host, "10.0.0.1");
+    EXPECT_EQ(record.method, "GET");
+    EXPECT_EQ(record.path, "/index.html?x=1");
+    EXPECT_EQ(record.status, 200);
+    EXPECT_EQ(record.userAgent, "curl/8.0");
+    EXPECT_EQ(record.timestamp, 971186136);
+
+    ASSERT_TRUE(parseAccessLogLine(line, true, record));
+    EXPECT_EQ(record.timestamp, 971186136 + 7 * 3600);
+
+    // Формат common: без referer и agent
+    ASSERT_TRUE(parseAccessLogLine("10.0.0.1 - - [10/Oct/2000:13:55:36 +0000] \"GET / HTTP/1.0\" 304 -", false, record));
+    EXPECT_EQ(record.status, 304);
+    EXPECT_TRUE(record.userAgent.empty());
+
+    EXPECT_FALSE(parseAccessLogLine("garbage", false, record));
+    EXPECT_FALSE(parseAccessLogLine("10.0.0.1 - - [10/Foo/2000:13:55:36 +0000] \"GET / HTTP/1.0\" 200 1", false, record));
+}
+
+// Дневные интервалы: загрузки, уникальные посетители, фильтр статики и ошибок, пропуски
+TEST(AccessLogTest, BuildsDailyDataset) {
+    const char *fname = "tmp_access_test.log";
+    {
+        std::ofstream ofs(fname);
+        for (int i = 0; i < 30; ++i) {
+            ofs << logLine("10.0.0." + std::to_string(i % 10), "14/Sep/2014:08:00:00 +0000", "GET /page HTTP/1.1", 200) << '\n';
+        }
+        ofs << logLine("10.0.0.1", "14/Sep/2014:09:00:00 +0000", "GET /style.css HTTP/1.1", 200) << '\n';
+        ofs << logLine("10.0.0.1", "14/Sep/2014:09:00:00 +0000", "POST /form HTTP/1.1", 200) << '\n';
+        ofs << logLine("10.0.0.1", "14/Sep/2014:09:00:00 +0000", "GET /missing HTTP/1.1", 404) << '\n';
+        ofs << "not a log line\n";
+        // 15 сентября без запросов, 16 сентября — без перевода строки в конце файла
+        ofs << logLine("10.0.0.1", "16/Sep/2014:23:59:59 +0000", "GET / HTTP/1.1", 200);
+    }
+
+    AccessLogIngester ingester;
+    ASSERT_TRUE(ingester.ingestFile(fname));
+    EXPECT_EQ(ingester.stats().lines, 35u);
+    EXPECT_EQ(ingester.stats().malformed, 1u);
+    EXPECT_EQ(ingester.stats().pageLoads, 31u);
+
+    const Dataset ds = ingester.toDataset();
+    ASSERT_EQ(ds.size(), 3u);
+    const auto &rows = ds.getRows();
+    EXPECT_EQ(rows[0].getDay(), "Sunday");
+    EXPECT_EQ(rows[0].getDayOfWeek(), 1);
+    EXPECT_EQ(rows[0].getDate(), 1410652800);
+    EXPECT_EQ(rows[0].getPageLoads(), 30);
+    EXPECT_EQ(rows[0].getUniqueVisitors(), 10);
+    EXPECT_EQ(rows[1].getDay(), "Monday");
+    EXPECT_EQ(rows[1].getPageLoads(), 0);
+    EXPECT_EQ(rows[2].getPageLoads(), 1);
+    EXPECT_EQ(rows[2].getUniqueVisitors(), 1);
+
+    std::remove(fname);
+}
+
+// Часовые интервалы и закрытие старых интервалов при ограничении памяти
+TEST(AccessLogTest, HourlyBucketsAndLateLines) {
+    AccessLogOptions options;
+    options.bucket = LogBucket::Hour;
+    options.maxOpenBuckets = 2;
+    AccessLogIngester ingester(options);
+
+    ingester.ingestLine(logLine("a", "14/Sep/2014:00:10:00 +0000", "GET / HTTP/1.1", 200));
+    ingester.ingestLine(logLine("b", "14/Sep/2014:01:10:00 +0000", "GET / HTTP/1.1", 200));
+    ingester.ingestLine(logLine("c", "14/Sep/2014:03:10:00 +0000", "GET / HTTP/1.1", 200));
+    // Интервал 00:00 уже закрыт: загрузка учитывается, посетитель — нет
+    ingester.ingestLine(logLine("d", "14/Sep/2014:00:20:00 +0000", "GET / HTTP/1.1", 200));
+    EXPECT_EQ(ingester.stats().late, 1u);
+
+    const Dataset ds = ingester.toDataset();
+    ASSERT_EQ(ds.size(), 4u);
+    const auto &rows = ds.getRows();
+    EXPECT_EQ(rows[0].getDate(), 1410652800);
+    EXPECT_EQ(rows[1].getDate(), 1410652800 + 3600);
+    EXPECT_EQ(rows[0].getPageLoads(), 2);
+    EXPECT_EQ(rows[0].getUniqueVisitors(), 1);
+    EXPECT_EQ(rows[2].getPageLoads(), 0);
+    EXPECT_EQ(rows[3].getUniqueVisitors(), 1);
+}
+
+// Строка с ошибочным годом не растягивает ряд и учитывается как выброс
+TEST(AccessLogTest, DropsOutlierTimestamps) {
+    AccessLogIngester ingester;
+    ingester.ingestLine(logLine("a", "14/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+    ingester.ingestLine(logLine("b", "01/Jan/9999:00:00:00 +0000", "GET / HTTP/1.1", 200));
+    ingester.ingestLine(logLine("c", "15/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+    ingester.ingestLine(logLine("d", "16/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+
+    size_t outliers = 0;
+    const Dataset ds = ingester.toDataset(&outliers);
+    EXPECT_EQ(outliers, 1u);
+    ASSERT_EQ(ds.size(), 3u);
+    EXPECT_EQ(ds.getRows()[0].getDate(), 1410652800);
+    EXPECT_EQ(ds.getRows()[2].getDate(), 1410652800 + 2 * 86400);
+}
+
+// Фильтр Блума: нет ложноотрицательных ответов, доля ложных срабатываний не выше заданной
+TEST(ScalableBloomFilterTest, GrowsAndKeepsErrorRate) {
+    ScalableBloomFilter filter(1000, 0.01);
+    size_t inserted = 0;
+    for (uint64_t i = 0; i < 20000; ++i) {
+        // Ложное срабатывание при вставке нового элемента тоже возможно
+        inserted += filter.insert(hashBytes("in-" + std::to_string(i)));
+    }
+    EXPECT_GT(filter.layerCount(), 1u);
+    EXPECT_GE(inserted, 19800u);
+    EXPECT_EQ(filter.size(), inserted);
+
+    for (uint64_t i = 0; i < 20000; ++i) {
+        ASSERT_TRUE(filter.contains(hashBytes("in-" + std::to_string(i))));
+        EXPECT_FALSE(filter.insert(hashBytes("in-" + std::to_string(i))));
+    }
+    size_t falsePositives = 0;
+    for (uint64_t i = 0; i < 20000; ++i) {
+        falsePositives += filter.contains(hashBytes("out-" + std::to_string(i)));
+    }
+    EXPECT_LE(falsePositives, 200u);
+}
+
+// Сохранение и загрузка фильтра через mmap; повреждённый файл не загружается
+TEST(ScalableBloomFilterTest, SaveAndLoad) {
+    const char *fname = "tmp_visitors.bloom";
+    {
+        ScalableBloomFilter filter(100, 0.001);
+        for (int i = 0; i < 500; ++i) filter.insert(hashBytes(std::to_string(i)));
+        ASSERT_TRUE(filter.save(fname));
+    }
+
+    ScalableBloomFilter loaded;
+    ASSERT_TRUE(loaded.load(fname));
+    EXPECT_EQ(loaded.size(), 500u);
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_TRUE(loaded.contains(hashBytes(std::to_string(i))));
+    }
+    // Дополнение загруженного фильтра и повторное сохранение поверх отображённого файла
+    EXPECT_TRUE(loaded.insert(hashBytes("new")));
+    ASSERT_TRUE(loaded.save(fname));
+    ScalableBloomFilter reloaded;
+    ASSERT_TRUE(reloaded.load(fname));
+    EXPECT_TRUE(reloaded.contains(hashBytes("new")));
+    EXPECT_EQ(reloaded.size(), 501u);
+
+    {
+        std::fstream f(fname, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(48);
+        f.put('\x7f');
+    }
+    ScalableBloomFilter corrupted;
+    EXPECT_FALSE(corrupted.load(fname));
+    EXPECT_EQ(corrupted.size(), 0u);
+    std::remove(fname);
+}
+
+// Разделение на новых и вернувшихся посетителей между двумя запусками
+TEST(AccessLogTest, ClassifiesFirstTimeAndReturningVisitors) {
+    ScalableBloomFilter filter;
+    {
+        AccessLogIngester ingester;
+        ingester.setVisitorFilter(&filter);
+        for (int i = 0; i < 20; ++i) {
+            ingester.ingestLine(logLine("10.0.0." + std::to_string(i), "14/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+        }
+        // Те же 20 посетителей на следующий день и ещё 5 новых
+        for (int i = 0; i < 25; ++i) {
+            ingester.ingestLine(logLine("10.0.0." + std::to_string(i), "15/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+            ingester.ingestLine(logLine("10.0.0." + std::to_string(i), "15/Sep/2014:09:00:00 +0000", "GET /a HTTP/1.1", 200));
+        }
+        const Dataset ds = ingester.toDataset();
+        ASSERT_EQ(ds.size(), 2u);
+        EXPECT_EQ(ds.getRows()[0].getFirstTimeVisitors(), 20);
+        EXPECT_EQ(ds.getRows()[0].getReturningVisitors(), 0);
+        EXPECT_EQ(ds.getRows()[1].getUniqueVisitors(), 25);
+        EXPECT_EQ(ds.getRows()[1].getFirstTimeVisitors(), 5);
+        EXPECT_EQ(ds.getRows()[1].getReturningVisitors(), 20);
+    }
+
+    // Следующий запуск с тем же фильтром: все посетители уже встречались
+    AccessLogIngester ingester;
+    ingester.setVisitorFilter(&filter);
+    for (int i = 0; i < 10; ++i) {
+        ingester.ingestLine(logLine("10.0.0." + std::to_string(i), "16/Sep/2014:08:00:00 +0000", "GET / HTTP/1.1", 200));
+    }
+    const Dataset ds = ingester.toDataset();
+    ASSERT_EQ(ds.size(), 1u);
+    EXPECT_EQ(ds.getRows()[0].getFirstTimeVisitors(), 0);
+    EXPECT_EQ(ds.getRows()[0].getReturningVisitors(), 10);
+}